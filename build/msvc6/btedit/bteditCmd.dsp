@@ -91,6 +91,14 @@ SOURCE=..\..\..\src\btree\addkey.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\..\src\btree\addrecs.c
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\..\src\btree\bloom.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\..\src\btree\block.c
 # End Source File
 # Begin Source File
@@ -107,6 +115,22 @@ SOURCE=..\..\..\src\btree\btrec.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\..\src\btree\bulkload.c
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\..\src\btree\compress.c
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\..\src\btree\cursor.c
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\..\src\btree\fdcache.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\..\src\stdlib\dirs.c
 # End Source File
 # Begin Source File
@@ -135,6 +159,10 @@ SOURCE=..\..\..\src\btree\index.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\..\src\btree\mapcache.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\..\src\arch\mswin\intlshim.c
 # End Source File
 # Begin Source File
@@ -163,6 +191,22 @@ SOURCE=..\..\..\src\btree\opnbtree.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\..\src\btree\pagefile.c
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\..\src\btree\shared.c
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\..\src\btree\snapshot.c
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\..\src\btree\stats.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\..\src\stdlib\path.c
 # End Source File
 # Begin Source File
@@ -191,6 +235,10 @@ SOURCE=..\..\..\src\btree\utils.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\..\src\btree\wal.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\..\src\arch\vsnprintf.c
 # End Source File
 # Begin Source File
@@ -92,6 +92,14 @@ SOURCE=..\..\..\src\btree\addkey.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\..\src\btree\addrecs.c
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\..\src\btree\bloom.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\..\src\interp\alloc.c
 # End Source File
 # Begin Source File
@@ -124,6 +132,22 @@ SOURCE=..\..\..\src\btree\btrec.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\..\src\btree\bulkload.c
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\..\src\btree\compress.c
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\..\src\btree\cursor.c
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\..\src\btree\fdcache.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\..\src\interp\builtin.c
 # End Source File
 # Begin Source File
@@ -252,6 +276,10 @@ SOURCE=..\..\..\src\btree\index.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\..\src\btree\mapcache.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\..\src\gedlib\indiseq.c
 # End Source File
 # Begin Source File
@@ -376,6 +404,10 @@ SOURCE=..\..\..\src\gedlib\node.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\..\src\gedlib\nodebin.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\..\src\gedlib\nodechk.c
 # End Source File
 # Begin Source File
@@ -396,6 +428,22 @@ SOURCE=..\..\..\src\btree\opnbtree.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\..\src\btree\pagefile.c
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\..\src\btree\shared.c
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\..\src\btree\snapshot.c
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\..\src\btree\stats.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\..\src\stdlib\path.c
 # End Source File
 # Begin Source File
@@ -552,6 +600,10 @@ SOURCE=..\..\..\src\btree\utils.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\..\src\btree\wal.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\..\src\gedlib\valid.c
 # End Source File
 # Begin Source File
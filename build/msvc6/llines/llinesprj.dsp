@@ -97,6 +97,14 @@ SOURCE=..\..\..\src\btree\addkey.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\..\src\btree\addrecs.c
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\..\src\btree\bloom.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\..\src\liflines\advedit.c
 # End Source File
 # Begin Source File
@@ -149,6 +157,22 @@ SOURCE=..\..\..\src\btree\btrec.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\..\src\btree\bulkload.c
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\..\src\btree\compress.c
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\..\src\btree\cursor.c
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\..\src\btree\fdcache.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\..\src\interp\builtin.c
 # End Source File
 # Begin Source File
@@ -309,6 +333,10 @@ SOURCE=..\..\..\src\btree\index.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\..\src\btree\mapcache.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\..\src\gedlib\indiseq.c
 # End Source File
 # Begin Source File
@@ -469,6 +497,10 @@ SOURCE=..\..\..\src\gedlib\node.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\..\src\gedlib\nodebin.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\..\src\gedlib\nodechk.c
 # End Source File
 # Begin Source File
@@ -493,6 +525,22 @@ SOURCE=..\..\..\src\btree\opnbtree.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\..\src\btree\pagefile.c
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\..\src\btree\shared.c
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\..\src\btree\snapshot.c
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\..\src\btree\stats.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\..\src\stdlib\path.c
 # End Source File
 # Begin Source File
@@ -673,6 +721,10 @@ SOURCE=..\..\..\src\btree\utils.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\..\src\btree\wal.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\..\src\liflines\valgdcom.c
 # End Source File
 # Begin Source File
@@ -341,6 +341,67 @@ LocaleDir:=%llroot%\locale
 #NewDbProps=codeset=UTF-8
 # Default is none
 
+# Create new databases as one paged file, instead of a
+# directory tree of many small files (see btpack to convert)
+#NewDbPaged=1
+# Default is 0
+
+# Size (in KB) of btree index & block headers of new databases:
+# 4, 8, 16, 32 or 64 (larger headers hold more keys, so lookups
+# pass through fewer index levels). All databases open at once
+# must have the same size.
+#NewDbPageKB=16
+# Default is 4
+
+# How the person, family & other record caches choose what to drop:
+# 2Q keeps records read only once (eg, by a report looping over
+# every person, or an export) from pushing out those in use, while
+# LRU simply drops the least recently used record
+#CachePolicy=LRU
+# Default is 2Q
+
+# Memory (in MB) for the person, family & other record caches together;
+# each cache gets a share that follows how often it has to read records
+#CacheMemoryMB=256
+# Default is 32
+# Set to 0 to limit each cache to a number of records instead; the -c
+# option of llines & llexec does so too, with the numbers it gives
+
+# Number of database (btree) files to keep open at once
+#BtreeFileCache=100
+# Default is 32
+# Set to 0 to open & close files on every access (old behavior)
+
+# Memory (in KB) for caching btree index & block headers
+#BtreeCacheKB=16384
+# Default is 1024
+# Each index or block header takes 4KB (see NewDbPageKB), so a large value keeps
+# the whole index of a large database in memory
+
+# Memory (in KB) for filters that let lookups of missing records
+# skip reading the block header where each would be
+#BtreeFilterKB=4096
+# Default is 1024, which covers about 4000 blocks (up to 1000000 records)
+# Set to 0 to turn the filters off
+
+# Compress database records (each data block is compressed when
+# a record is next written to it; both kinds are always readable)
+#BtreeCompress=1
+# Default is 0
+
+# Write database records in a binary encoding, which is quicker to read
+# in (both kinds are always readable; dbverify -R rewrites all records
+# in the encoding this chooses, eg, as text for tools such as btedit)
+#BinaryRecords=1
+# Default is 0
+
+# Log counters of database I/O (cache hits & misses, files opened,
+# bytes read & written, splits) to this file, every so many records
+# looked up or written, and when the database is closed
+#BtreeStatsLog=btstats.log
+#BtreeStatsEvery=100000
+# Default is no log; default interval is 10000
+
 ifdef(`WINDOWS',
 # (Windows) Set codepage to use when reading from console
 #ConsoleCodepage=1250
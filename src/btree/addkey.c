@@ -91,7 +91,10 @@ addkey (BTREE btree, FKEY ikey, RKEY rkey, FKEY fkey)
 
    /* If index is now full split it */
 	if (nkeys(index) >= NOENTS - 1) {
+		/* caching newdex may drop index from cache, so keep its parent */
+		FKEY parent = ixparent(index);
 		INDEX newdex = crtindex(btree);
+		btcount(btree, c_indexsplits, 1);
 		SHORT n = NOENTS/2 - 1;
 		nkeys(newdex) = nkeys(index) - n - 1;
 		nkeys(index) = n;
@@ -103,7 +106,7 @@ addkey (BTREE btree, FKEY ikey, RKEY rkey, FKEY fkey)
 		putindex(btree, newdex);
 
    /* Special case -- split requires new master index */
-		if (ixself(index) == ixself(bmaster(btree))) {
+		if (ikey == ixself(bmaster(btree))) {
 			INDEX master = crtindex(btree);
 			nkeys(master) = 1;
 			fkeys(master, 0) = ikey;
@@ -112,7 +115,7 @@ addkey (BTREE btree, FKEY ikey, RKEY rkey, FKEY fkey)
 			newmaster(btree, master);
 			writeindex(btree, master);
 		} else	
-			addkey(btree, ixparent(index), rkeys(newdex, 0),
+			addkey(btree, parent, rkeys(newdex, 0),
 				ixself(newdex));
 	} else
 		putindex(btree, index);
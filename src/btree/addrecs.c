@@ -0,0 +1,285 @@
+/*
+   Copyright (c) 2026 The LifeLines developers
+   "The MIT license"
+   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+/*=============================================================
+ * addrecs.c -- Add many (sorted) records to BTREE at once
+ *  Each data block touched is rebuilt in memory and rewritten
+ *  only once, however many of the new records land in it.
+ *  Used to checkpoint the write-ahead log (see wal.c).
+ *   Created: 2026/10
+ *===========================================================*/
+
+#include "sys_inc.h"
+#include "llstdlib.h"
+#include "btreei.h"
+
+/*********************************************
+ * local types
+ *********************************************/
+
+/* data block being rebuilt in memory */
+typedef struct {
+	BLOCK     l_hdr;   /* copy of original header (NULL if none loaded) */
+	STRING    l_old;   /* original record data of block (unpacked) */
+	INT       l_n;     /* number of records */
+	INT       l_max;   /* allocated size of arrays below */
+	RKEY     *l_rkeys; /* record keys, in order */
+	INT      *l_lens;  /* record lengths */
+	CNSTRING *l_recs;  /* record data (in l_old, or caller's) */
+} LEAFIMAGE;
+
+/* records put in each block when rebuilt block must be split */
+#define FILLRECS ((NORECS-1)*3/4)
+
+/*********************************************
+ * local function prototypes
+ *********************************************/
+
+/* alphabetical */
+static void addtoimage(LEAFIMAGE *img, ADDREC *rec);
+static void flushimage(BTREE btree, LEAFIMAGE *img);
+static void loadimage(BTREE btree, BLOCK block, LEAFIMAGE *img);
+static void writeimagefile(BTREE btree, LEAFIMAGE *img, BLOCK blk, INT first, INT count);
+
+/*********************************************
+ * local & exported function definitions
+ * body of module
+ *********************************************/
+
+/*=================================
+ * addrecords -- Add array of records to BTREE
+ *  btree:  [in] btree to add records to
+ *  recs:   [in] records to add, sorted by key (cmpkeys), no duplicates
+ *  n:      [in] number of records
+ * Record data is not retained (caller still owns it)
+ *===============================*/
+void
+addrecords (BTREE btree, ADDREC *recs, INT n)
+{
+	LEAFIMAGE img;
+	BLOCK block;
+	INT i;
+
+	/* first records in btree are built bottom-up instead */
+	if (emptybtree(btree)) {
+		bulkrecords(btree, recs, n);
+		return;
+	}
+	snapbegin(btree);
+	img.l_hdr = NULL;
+	for (i = 0; i < n; ++i) {
+		/* walk from master every time, as flushing may split blocks */
+		block = findleaf(btree, recs[i].a_rkey);
+		if (img.l_hdr && ixself(img.l_hdr) != ixself(block)) {
+			flushimage(btree, &img);
+			/* flushing adds to index cache, which may have freed block */
+			block = findleaf(btree, recs[i].a_rkey);
+		}
+		if (!img.l_hdr)
+			loadimage(btree, block, &img);
+		addtoimage(&img, &recs[i]);
+	}
+	if (img.l_hdr)
+		flushimage(btree, &img);
+	snapend(btree);
+}
+/*=================================
+ * loadimage -- Read data block into memory for rebuilding
+ *  btree:  [in]  btree
+ *  block:  [in]  header of block (from findleaf)
+ *  img:    [out] image to fill in
+ *===============================*/
+static void
+loadimage (BTREE btree, BLOCK block, LEAFIMAGE *img)
+{
+	INT i, n = nkeys(block), off = 0;
+	STRING packed;
+	img->l_hdr = allocblock();
+	memcpy(img->l_hdr, block, PAGELEN);
+	img->l_old = readblockdata(btree, block);
+	img->l_n = n;
+	img->l_max = n + NORECS;
+	img->l_rkeys = (RKEY *) stdalloc(img->l_max * sizeof(RKEY));
+	img->l_lens = (INT *) stdalloc(img->l_max * sizeof(INT));
+	img->l_recs = (CNSTRING *) stdalloc(img->l_max * sizeof(CNSTRING));
+	for (i = 0; i < n; ++i) {
+		img->l_rkeys[i] = rkeys(block, i);
+		img->l_lens[i] = lens(block, i);
+		img->l_recs[i] = img->l_old + offs(block, i);
+	}
+	if (ixtype(block) != BTPACKTYPE)
+		return;
+	/* unpack records of compressed block, one after another */
+	packed = img->l_old;
+	for (i = 0; i < n; ++i)
+		off += unpackedlen(packed + offs(block, i), lens(block, i));
+	img->l_old = (STRING) stdalloc(off + 1);
+	for (i = off = 0; i < n; ++i) {
+		unpackrecord(packed + offs(block, i), lens(block, i), img->l_old + off);
+		img->l_lens[i] = unpackedlen(packed + offs(block, i), lens(block, i));
+		img->l_recs[i] = img->l_old + off;
+		off += img->l_lens[i];
+	}
+	stdfree(packed);
+}
+/*=================================
+ * addtoimage -- Add (or replace) one record in block image
+ *===============================*/
+static void
+addtoimage (LEAFIMAGE *img, ADDREC *rec)
+{
+	INT lo = 0, hi = img->l_n - 1, i;
+	while (lo <= hi) {
+		INT md = (lo + hi)/2;
+		INT rel = cmpkeys(&rec->a_rkey, &img->l_rkeys[md]);
+		if (rel < 0)
+			hi = md - 1;
+		else if (rel > 0)
+			lo = md + 1;
+		else {
+			/* replace older version */
+			img->l_recs[md] = rec->a_rec;
+			img->l_lens[md] = rec->a_len;
+			return;
+		}
+	}
+	if (img->l_n == img->l_max) {
+		INT nmax = 2*img->l_max;
+		RKEY *rk = (RKEY *) stdalloc(nmax * sizeof(RKEY));
+		INT *ln = (INT *) stdalloc(nmax * sizeof(INT));
+		CNSTRING *rc = (CNSTRING *) stdalloc(nmax * sizeof(CNSTRING));
+		memcpy(rk, img->l_rkeys, img->l_n * sizeof(RKEY));
+		memcpy(ln, img->l_lens, img->l_n * sizeof(INT));
+		memcpy(rc, img->l_recs, img->l_n * sizeof(CNSTRING));
+		stdfree(img->l_rkeys);
+		stdfree(img->l_lens);
+		stdfree(img->l_recs);
+		img->l_rkeys = rk;
+		img->l_lens = ln;
+		img->l_recs = rc;
+		img->l_max = nmax;
+	}
+	for (i = img->l_n; i > lo; --i) {
+		img->l_rkeys[i] = img->l_rkeys[i-1];
+		img->l_lens[i] = img->l_lens[i-1];
+		img->l_recs[i] = img->l_recs[i-1];
+	}
+	img->l_rkeys[lo] = rec->a_rkey;
+	img->l_lens[lo] = rec->a_len;
+	img->l_recs[lo] = rec->a_rec;
+	++img->l_n;
+}
+/*=================================
+ * flushimage -- Write rebuilt block back to database
+ *  Splits it into as many blocks as needed, and adds
+ *  any new blocks to the parent index
+ *  btree:  [in] btree
+ *  img:    [in] image of block (released here)
+ *===============================*/
+static void
+flushimage (BTREE btree, LEAFIMAGE *img)
+{
+	INT m = img->l_n, nblocks, per, c, first;
+	FKEY parent = ixparent(img->l_hdr);
+	FKEY *newfkeys;
+	RKEY *newrkeys;
+	BLOCK old, blk;
+
+	nblocks = (m <= NORECS-1) ? 1 : (m + FILLRECS - 1)/FILLRECS;
+	per = (m + nblocks - 1)/nblocks;
+	newfkeys = (FKEY *) stdalloc(nblocks * sizeof(FKEY));
+	newrkeys = (RKEY *) stdalloc(nblocks * sizeof(RKEY));
+	btcount(btree, c_blocksplits, nblocks - 1);
+
+	for (c = 0, first = 0; c < nblocks; ++c, first += per) {
+		if (c == 0) {
+			blk = allocblock();
+			ixself(blk) = ixself(img->l_hdr);
+		} else
+			blk = crtblock(btree);
+		ixparent(blk) = parent;
+		writeimagefile(btree, img, blk, first, (first + per > m) ? m - first : per);
+		newfkeys[c] = ixself(blk);
+		newrkeys[c] = rkeys(blk, 0);
+		if (c == 0) {
+			/* header cached for original block is replaced (& freed) */
+			old = (BLOCK) getindex(btree, ixself(blk));
+			putheader(btree, blk);
+			stdfree(old);
+		} else
+			putheader(btree, blk);
+	}
+
+/* add index of each new data block to its parent (may cause more splitting) */
+	for (c = 1; c < nblocks; ++c) {
+		/* lands on previous block, as new one is not yet indexed */
+		blk = findleaf(btree, newrkeys[c]);
+		addkey(btree, ixparent(blk), newrkeys[c], newfkeys[c]);
+	}
+
+	stdfree(newfkeys);
+	stdfree(newrkeys);
+	stdfree(img->l_hdr);
+	stdfree(img->l_old);
+	stdfree(img->l_rkeys);
+	stdfree(img->l_lens);
+	stdfree(img->l_recs);
+	img->l_hdr = NULL;
+}
+/*=================================
+ * writeimagefile -- Write some records of image as one block file
+ *  btree:  [in] btree
+ *  img:    [in] block image
+ *  blk:    [in/out] header of block to write (keys filled in here)
+ *  first:  [in] first record of image to put in block
+ *  count:  [in] number of records to put in block
+ * File is forced to disk before it replaces the original
+ * Block is written compressed if btree is set to (bpack)
+ *===============================*/
+static void
+writeimagefile (BTREE btree, LEAFIMAGE *img, BLOCK blk, INT first, INT count)
+{
+	char scratch0[MAXPATHLEN], scratch1[MAXPATHLEN];
+	FILE *fp;
+	INT i, off = 0;
+	STRING *packed = NULL;
+
+	ixtype(blk) = bpack(btree) ? BTPACKTYPE : BTBLOCKTYPE;
+	if (bpack(btree))
+		packed = (STRING *) stdalloc(count * sizeof(STRING));
+	for (i = 0; i < count; ++i) {
+		rkeys(blk, i) = img->l_rkeys[first+i];
+		lens(blk, i) = img->l_lens[first+i];
+		if (packed)
+			packed[i] = packrecord(img->l_recs[first+i], lens(blk, i), &lens(blk, i));
+		offs(blk, i) = off;
+		off += lens(blk, i);
+	}
+	nkeys(blk) = count;
+
+	sprintf(scratch0, "%s/tmp1", bbasedir(btree));
+	if (!(fp = fopen(scratch0, LLWRITEBINARY LLFILETEMP LLFILERANDOM))) {
+		char msg[sizeof(scratch0)+64];
+		sprintf(msg, "Failed to open temp blockfile: %s", scratch0);
+		FATAL2(msg);
+	}
+	CHECKED_fwrite(blk, PAGELEN, 1, fp, scratch0);
+	for (i = 0; i < count; ++i) {
+		if (lens(blk, i))
+			CHECKED_fwrite(packed ? packed[i] : img->l_recs[first+i]
+				, lens(blk, i), 1, fp, scratch0);
+	}
+	if (packed) {
+		for (i = 0; i < count; ++i)
+			stdfree(packed[i]);
+		stdfree(packed);
+	}
+	syncfile(fp, scratch0);
+	CHECKED_fclose(fp, scratch0);
+	sprintf(scratch1, "%s/%s", bbasedir(btree), fkey2path(ixself(blk)));
+	movefiles(btree, ixself(blk), scratch0, scratch1);
+}
@@ -36,7 +36,7 @@
 BLOCK
 allocblock (void)
 {
-	BLOCK block = (BLOCK) stdalloc(BUFLEN);
+	BLOCK block = (BLOCK) stdalloc(PAGELEN);
 	ixtype(block) = BTBLOCKTYPE;
 	ixself(block) = 0;
 	ixparent(block) = 0;
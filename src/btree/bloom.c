@@ -0,0 +1,202 @@
+/*
+   Copyright (c) 2026 The LifeLines developers
+   "The MIT license"
+   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+/*=============================================================
+ * bloom.c -- Bloom filters of keys of BTREE data blocks
+ *  A filter is built from each data block header as it enters
+ *  the index cache (see cacheindex), & kept after the header
+ *  itself is dropped, as it is 16 times smaller. A lookup of
+ *  a key that is not in the btree can then stop at the index
+ *  above the block, without reading the block header.
+ *  Filters live in a table of slots, each holding the filter
+ *  of one block (chosen by FKEY); a block whose slot is taken
+ *  by another just has no filter until its header is reread.
+ *  Filters are not stored in the database.
+ *   Created: 2026/10
+ *===========================================================*/
+
+#include "sys_inc.h"
+#include "llstdlib.h"
+#include "btreei.h"
+
+/*********************************************
+ * local types
+ *********************************************/
+
+/* bits set for each key (about 2% false positives if full) */
+#define BFHASHES 6
+/* FKEY of empty slot (FKEYs are never negative) */
+#define BFNONE ((FKEY)-1)
+
+struct tag_bloomset {
+	INT    bs_nslots; /* size of table */
+	INT    bs_bytes;  /* bytes of each filter: 8 bits per key of full block */
+	FKEY  *bs_fkeys;  /* block of each filter (or BFNONE) */
+	unsigned char *bs_bits; /* filters themselves */
+};
+
+/*********************************************
+ * local function prototypes
+ *********************************************/
+
+/* alphabetical */
+static void keyhashes(const RKEY *rkey, unsigned int *h1, unsigned int *h2);
+static INT slotof(BLOOMSET bs, FKEY fkey);
+
+/*********************************************
+ * local & exported function definitions
+ * body of module
+ *********************************************/
+
+/*=================================
+ * initfilters -- Create (empty) filter table of btree
+ *  btree: [IN]  btree handle
+ *  bytes: [IN]  memory budget (0 for no filters)
+ * Filters are sized for blocks of current page length (NORECS)
+ *===============================*/
+void
+initfilters (BTREE btree, INT bytes)
+{
+	BLOOMSET bs;
+	INT i, n, len = (NORECS + 8)/8*8;
+	bfilters(btree) = NULL;
+	n = bytes/(len + (INT)sizeof(FKEY));
+	if (n <= 0) return;
+	bs = (BLOOMSET) stdalloc(sizeof(*bs));
+	bs->bs_nslots = n;
+	bs->bs_bytes = len;
+	bs->bs_fkeys = (FKEY *) stdalloc(n*sizeof(FKEY));
+	bs->bs_bits = (unsigned char *) stdalloc(n*len);
+	for (i = 0; i < n; ++i)
+		bs->bs_fkeys[i] = BFNONE;
+	bfilters(btree) = bs;
+}
+/*=================================
+ * freefilters -- Free filter table of btree
+ *===============================*/
+void
+freefilters (BTREE btree)
+{
+	BLOOMSET bs = bfilters(btree);
+	if (!bs) return;
+	stdfree(bs->bs_fkeys);
+	stdfree(bs->bs_bits);
+	stdfree(bs);
+	bfilters(btree) = NULL;
+}
+/*=================================
+ * bt_setfiltersize -- Change memory budget of block filters
+ *  btree: [IN]  btree handle
+ *  bytes: [IN]  new budget (0 to turn filters off)
+ * Called by client after open, eg, from BtreeFilterKB option.
+ * Current filters are dropped, to be rebuilt as headers are read
+ *===============================*/
+void
+bt_setfiltersize (BTREE btree, INT bytes)
+{
+	freefilters(btree);
+	initfilters(btree, bytes);
+}
+/*=================================
+ * addfilter -- Build filter of data block
+ *  btree: [IN]  btree handle
+ *  block: [IN]  header of data block (as now on disk)
+ * Replaces any older filter of the same block
+ *===============================*/
+void
+addfilter (BTREE btree, BLOCK block)
+{
+	BLOOMSET bs = bfilters(btree);
+	unsigned char *bits;
+	unsigned int h1, h2, bit, nbits;
+	INT i, j, slot;
+
+	if (!bs) return;
+	slot = slotof(bs, ixself(block));
+	bs->bs_fkeys[slot] = ixself(block);
+	bits = bs->bs_bits + slot*bs->bs_bytes;
+	nbits = bs->bs_bytes*8;
+	memset(bits, 0, bs->bs_bytes);
+	for (i = 0; i < nkeys(block); ++i) {
+		keyhashes(&rkeys(block, i), &h1, &h2);
+		for (j = 0; j < BFHASHES; ++j, h1 += h2) {
+			bit = h1 % nbits;
+			bits[bit >> 3] |= 1 << (bit & 7);
+		}
+	}
+}
+/*=================================
+ * dropfilter -- Forget filter of block (eg, as it is removed)
+ *===============================*/
+void
+dropfilter (BTREE btree, FKEY fkey)
+{
+	BLOOMSET bs = bfilters(btree);
+	INT slot;
+	if (!bs) return;
+	slot = slotof(bs, fkey);
+	if (bs->bs_fkeys[slot] == fkey)
+		bs->bs_fkeys[slot] = BFNONE;
+}
+/*=================================
+ * notinblock -- Is key certainly not in file ?
+ *  btree: [IN]  btree handle
+ *  fkey:  [IN]  child file (index or data block) to search next
+ *  rkey:  [IN]  key sought
+ * returns TRUE only if fkey is a data block with a filter,
+ *  & the filter does not have rkey; FALSE means look in file
+ *===============================*/
+BOOLEAN
+notinblock (BTREE btree, FKEY fkey, const RKEY *rkey)
+{
+	BLOOMSET bs = bfilters(btree);
+	unsigned char *bits;
+	unsigned int h1, h2, bit, nbits;
+	INT j, slot;
+
+	if (!bs) return FALSE;
+	slot = slotof(bs, fkey);
+	if (bs->bs_fkeys[slot] != fkey) return FALSE;
+	bits = bs->bs_bits + slot*bs->bs_bytes;
+	nbits = bs->bs_bytes*8;
+	keyhashes(rkey, &h1, &h2);
+	for (j = 0; j < BFHASHES; ++j, h1 += h2) {
+		bit = h1 % nbits;
+		if (!(bits[bit >> 3] & (1 << (bit & 7))))
+			return TRUE;
+	}
+	return FALSE;
+}
+/*=================================
+ * keyhashes -- Two hashes of key (FNV-1a), for double hashing
+ *===============================*/
+static void
+keyhashes (const RKEY *rkey, unsigned int *h1, unsigned int *h2)
+{
+	unsigned int a = 2166136261u, b = 5381;
+	INT i;
+	for (i = 0; i < RKEYLEN; ++i) {
+		unsigned char c = (unsigned char)rkey->r_rkey[i];
+		a = (a ^ c) * 16777619u;
+		b = (b * 33) ^ c;
+	}
+	*h1 = a;
+	/* odd, so that successive bits differ */
+	*h2 = (b ^ (a >> 16)) | 1;
+}
+/*=================================
+ * slotof -- Slot of table for block
+ *===============================*/
+static INT
+slotof (BLOOMSET bs, FKEY fkey)
+{
+	/* mix both halves, as FKEYs fill a triangle (see nextfkey) */
+	unsigned int h = (unsigned int)fkey;
+	h = (h ^ (h >> 16)) * 0x45d9f3bu;
+	h ^= h >> 16;
+	return (INT)(h % (unsigned int)bs->bs_nslots);
+}
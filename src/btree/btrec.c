@@ -42,9 +42,19 @@
  *********************************************/
 
 /* alphabetical */
+static void addrecord(BTREE btree, RKEY rkey, RAWRECORD rec, INT len);
+static BOOLEAN appendrecord(BTREE btree, BLOCK old, RKEY rkey, CNSTRING rec, INT len, SHORT lo, BOOLEAN found);
 static void check_offset(BLOCK block, RKEY rkey, INT i);
+static void copyrecord(BTREE btree, FKEY fkey, FILE *fpsrc, int fdsrc, INT off, INT len, FILE *fpdest);
 static void filecopy(FILE*fpsrc, INT len, FILE*fpdest);
-static void movefiles(STRING, STRING);
+static u_int64_t keyval(const RKEY *rkey);
+static RAWRECORD readstored(BTREE btree, BLOCK block, INT i, INT *plen);
+
+/*********************************************
+ * external variables
+ *********************************************/
+
+extern int opt_finnish; /* keys in Finnish order (see ll_strncmp) */
 
 /*********************************************
  * local function definitions
@@ -85,26 +95,19 @@ check_offset (BLOCK block, RKEY rkey, INT i)
 }
 
 /*=================================
- * bt_addrecord -- Add record to BTREE
- *  btree:  [in] btree to add record to
- *  rkey:   [in] key of record (eg, "     I67")
- *  record: [in] record data to add
- *  len:    [in] record length
+ * findleaf -- Find data block that does/should hold record
+ *  btree:  [in] btree (must be writeable)
+ *  rkey:   [in] key of record
+ * maintains "lazy" parent chaining on the way down,
+ *  so ixparent of returned block is correct
+ * returns block header (owned by index cache)
  *===============================*/
-BOOLEAN
-bt_addrecord (BTREE btree, RKEY rkey, RAWRECORD rec, INT len)
+BLOCK
+findleaf (BTREE btree, RKEY rkey)
 {
 	INDEX index;
-	BLOCK old, newb, xtra;
-	FKEY nfkey, last = 0, parent;
-	SHORT i, j, k, l, n, lo, hi;
-	BOOLEAN found = FALSE;
-	INT off = 0;
-	FILE *fo=NULL, *ft1=NULL, *ft2=NULL;
-	char scratch0[MAXPATHLEN], scratch1[MAXPATHLEN], scratch2[MAXPATHLEN];
-	char *p = rec;
+	FKEY nfkey, last = 0;
 
-/* search for data block that does/should hold record */
 	ASSERT(bwrite(btree));
 	ASSERT(index = bmaster(btree));
 	while (ixtype(index) == BTINDEXTYPE) {
@@ -116,18 +119,55 @@ bt_addrecord (BTREE btree, RKEY rkey, RAWRECORD rec, INT len)
 			writeindex(btree, index);
 		}
 		last = ixself(index);
-		n = nkeys(index);
-		nfkey = fkeys(index, 0);
-		for (i = 1; i <= n; i++) {
-			if (cmpkeys(&rkey, &rkeys(index, i)) < 0)
-				break;
-			nfkey = fkeys(index, i);
-		}
+		nfkey = fkeys(index, childslot(index, &rkey));
 		index = getindex(btree, nfkey);
 	}
 /* have block that may hold older version of record */
 	ixparent(index) = last;
-	old = (BLOCK) index;
+	return (BLOCK) index;
+}
+/*=================================
+ * bt_addrecord -- Add record to BTREE
+ *  btree:  [in] btree to add record to
+ *  rkey:   [in] key of record (eg, "     I67")
+ *  record: [in] record data to add
+ *  len:    [in] record length
+ *===============================*/
+BOOLEAN
+bt_addrecord (BTREE btree, RKEY rkey, RAWRECORD rec, INT len)
+{
+	btcount(btree, c_adds, 1);
+	tickcounters(btree);
+
+/* batched updates go to the write-ahead log instead */
+	if (waladdrecord(btree, rkey, rec, len))
+		return TRUE;
+
+	snapbegin(btree);
+	addrecord(btree, rkey, rec, len);
+	snapend(btree);
+	return TRUE;
+}
+/*=================================
+ * addrecord -- Write record into its data block
+ *  (see bt_addrecord)
+ *===============================*/
+static void
+addrecord (BTREE btree, RKEY rkey, RAWRECORD rec, INT len)
+{
+	BLOCK old, newb, xtra;
+	FKEY nfkey, parent;
+	SHORT i, j, k, l, n, lo, hi;
+	BOOLEAN found = FALSE;
+	INT off = 0;
+	FILE *fo=NULL, *ft1=NULL, *ft2=NULL;
+	int fdo; /* cached descriptor of original block, or -1 */
+	char scratch0[MAXPATHLEN], scratch1[MAXPATHLEN], scratch2[MAXPATHLEN];
+	char *p = rec;
+	STRING packed = NULL; /* record as stored in compressed block */
+
+/* search for data block that does/should hold record */
+	old = findleaf(btree, rkey);
 	if (!(nkeys(old) < NORECS)) {
 		char msg[256];
 		sprintf(msg, "Corrupt block (rkey=%s): nkeys (%d) exceeds maximum (%d)"
@@ -135,6 +175,22 @@ bt_addrecord (BTREE btree, RKEY rkey, RAWRECORD rec, INT len)
 		FATAL2(msg);
 	}
 
+/* block in other format is rebuilt, in format now wanted */
+	if (ixtype(old) != (bpack(btree) ? BTPACKTYPE : BTBLOCKTYPE)) {
+		ADDREC one;
+		one.a_rkey = rkey;
+		one.a_rec = rec;
+		one.a_len = len;
+		addrecords(btree, &one, 1);
+		return;
+	}
+
+/* compressed block stores record packed */
+	if (ixtype(old) == BTPACKTYPE) {
+		packed = packrecord(rec, len, &len);
+		rec = packed;
+	}
+
 /* see if block has earlier version of record */
 	lo = 0;
 	hi = nkeys(old) - 1;
@@ -153,6 +209,13 @@ bt_addrecord (BTREE btree, RKEY rkey, RAWRECORD rec, INT len)
 		}
 	}
 
+/* most updates just append record to block file */
+	if ((found || nkeys(old) < NORECS - 1)
+		&& appendrecord(btree, old, rkey, rec, len, lo, found)) {
+		if (packed) stdfree(packed);
+		return;
+	}
+
 /* construct header for updated data block */
 	newb = allocblock();
 	ixtype(newb) = ixtype(old);
@@ -195,7 +258,9 @@ bt_addrecord (BTREE btree, RKEY rkey, RAWRECORD rec, INT len)
 
 /* must rewrite data block with new record; open original and new */
 	sprintf(scratch0, "%s/%s", bbasedir(btree), fkey2path(ixself(old)));
-	if (!(fo = fopen(scratch0, LLREADBINARY LLFILERANDOM))) {
+	fdo = getfilefd(btree, ixself(old), FALSE);
+	if (fdo < 0 && !bpagefile(btree)
+		&& !(fo = fopen(scratch0, LLREADBINARY LLFILERANDOM))) {
 		char msg[sizeof(scratch0)+64];
 		sprintf(msg, "Corrupt db (rkey=%s) -- failed to open blockfile: %s"
 			, rkey2str(rkey), scratch0);
@@ -213,12 +278,10 @@ bt_addrecord (BTREE btree, RKEY rkey, RAWRECORD rec, INT len)
 	if (!found && n == NORECS - 1) goto splitting;
 
 /* no split; write new header and preceding records to temp file */
-	ASSERT(fwrite(newb, BUFLEN, 1, ft1) == 1);
+	ASSERT(fwrite(newb, PAGELEN, 1, ft1) == 1);
 	putheader(btree, newb);
 	for (i = 0; i < lo; i++) {
-		if (fseek(fo, (long)(offs(old, i) + BUFLEN), 0))
-			FATAL();
-		filecopy(fo, lens(old, i), ft1);
+		copyrecord(btree, ixself(old), fo, fdo, offs(old, i) + PAGELEN, lens(old, i), ft1);
 	}
 
 /* write new record to temp file */
@@ -235,27 +298,28 @@ bt_addrecord (BTREE btree, RKEY rkey, RAWRECORD rec, INT len)
 /* write rest of records to temp file */
 	if (found) i++;
 	for ( ; i < n; i++) {
-		if (fseek(fo, (long)(offs(old, i)+BUFLEN), 0)) FATAL();
-		filecopy(fo, lens(old, i), ft1);
+		copyrecord(btree, ixself(old), fo, fdo, offs(old, i) + PAGELEN, lens(old, i), ft1);
 	}
 
 /* make changes permanent in database */
 	CHECKED_fclose(ft1, scratch1);
-	fclose(fo); /* was opened read-only */
+	if (fo) fclose(fo); /* was opened read-only */
 	sprintf(scratch0, "%s/tmp1", bbasedir(btree));
 	sprintf(scratch1, "%s/%s", bbasedir(btree), fkey2path(ixself(old)));
 	stdfree(old);
-	movefiles(scratch0, scratch1);
-	return TRUE;	/* return point for non-splitting case */
+	movefiles(btree, ixself(newb), scratch0, scratch1);
+	if (packed) stdfree(packed);
+	return;	/* return point for non-splitting case */
 
 /* data block must be split for new record; open second temp file */
 splitting:
+	btcount(btree, c_blocksplits, 1);
 	sprintf(scratch2, "%s/tmp2", bbasedir(btree));
 	ASSERT(ft2 = fopen(scratch2, LLWRITEBINARY LLFILETEMP LLFILERANDOM));
 
 /* write header and 1st half of records; don't worry where new record goes */
 	nkeys(newb) = n/2;	/* temporary */
-	ASSERT(fwrite(newb, BUFLEN, 1, ft1) == 1);
+	ASSERT(fwrite(newb, PAGELEN, 1, ft1) == 1);
 	putheader(btree, newb);
 	for (i = j = 0; j < n/2; j++) {
 		if (j == lo) {
@@ -268,9 +332,7 @@ splitting:
 			if (len && fwrite(p, len, 1, ft1) != 1)
 				FATAL();
 		} else {
-			if (fseek(fo, (long)(offs(old, i) + BUFLEN), 0))
-				FATAL();
-			filecopy(fo, lens(old, i), ft1);
+			copyrecord(btree, ixself(old), fo, fdo, offs(old, i) + PAGELEN, lens(old, i), ft1);
 			i++;
 		}
 	}
@@ -279,6 +341,7 @@ splitting:
 	nfkey = ixself(newb);
 	parent = ixparent(newb);
 	xtra = crtblock(btree);
+	ixtype(xtra) = ixtype(newb);
 	ixparent(xtra) = parent;
 	off = 0;
 	for (k = 0, l = n/2; k < n - n/2 + 1; k++, l++) {
@@ -288,7 +351,7 @@ splitting:
 		off += lens(newb, l);
 	}
 	nkeys(xtra) = n - n/2 + 1;
-	ASSERT(fwrite(xtra, BUFLEN, 1, ft2) == 1);
+	ASSERT(fwrite(xtra, PAGELEN, 1, ft2) == 1);
 	putheader(btree, xtra);
 
 /* write second half of records to second temp file */
@@ -303,29 +366,133 @@ splitting:
 			if (len && fwrite(p, len, 1, ft2) != 1)
 				FATAL();
 		} else {
-			if (fseek(fo, (long)(offs(old, i) + BUFLEN), 0))
-				FATAL();
-			filecopy(fo, lens(old, i), ft2);
+			copyrecord(btree, ixself(old), fo, fdo, offs(old, i) + PAGELEN, lens(old, i), ft2);
 			i++;
 		}
 	}
 
 /* make changes permanent in database */
-	fclose(fo); /* was opened read-only */
+	if (fo) fclose(fo); /* was opened read-only */
 	CHECKED_fclose(ft1, scratch1);
 	CHECKED_fclose(ft2, scratch2);
 	stdfree(old);
 	sprintf(scratch1, "%s/tmp1", bbasedir(btree));
 	sprintf(scratch2, "%s/%s", bbasedir(btree), fkey2path(nfkey));
-	movefiles(scratch1, scratch2);
+	movefiles(btree, nfkey, scratch1, scratch2);
 	sprintf(scratch1, "%s/tmp2", bbasedir(btree));
 	sprintf(scratch2, "%s/%s", bbasedir(btree), fkey2path(ixself(xtra)));
-	movefiles(scratch1, scratch2);
+	movefiles(btree, ixself(xtra), scratch1, scratch2);
 
 /* add index of new data block to its parent (may cause more splitting) */
 	addkey(btree, parent, rkeys(xtra, 0), ixself(xtra));
+	if (packed) stdfree(packed);
+}
+/*======================================================
+ * appendrecord -- Add record by appending it to block file
+ *  Only the header is rewritten (in place); any older version
+ *  of the record is left as dead space in the file, until the
+ *  block is next rewritten (which compacts it)
+ *  btree: [IN]  btree
+ *  old:   [IN]  cached header of block (freed if this succeeds)
+ *  rkey:  [IN]  key of record
+ *  rec:   [IN]  record data
+ *  len:   [IN]  record length
+ *  lo:    [IN]  position of record in block
+ *  found: [IN]  does record replace the one at lo ?
+ * returns FALSE if block must be rewritten instead, ie, if too
+ *  much of it would be dead (BTMAXDEADPCT) or it is not open
+ *====================================================*/
+static BOOLEAN
+appendrecord (BTREE btree, BLOCK old, RKEY rkey, CNSTRING rec, INT len, SHORT lo, BOOLEAN found)
+{
+	INT end = 0, live = 0, dead, i, n = nkeys(old);
+	BLOCK newb;
+	PAGEFILE pf = bpagefile(btree);
+	int fd = -1;
+
+/* offsets need not be in order, so find end of data & dead space */
+	for (i = 0; i < n; i++) {
+		if (offs(old, i) + lens(old, i) > end)
+			end = offs(old, i) + lens(old, i);
+		live += lens(old, i);
+	}
+	dead = end - live;
+	if (found)
+		dead += lens(old, lo);
+	if (dead > (end + len)/100*BTMAXDEADPCT)
+		return FALSE;
+	if (!pf && (fd = getfilefd(btree, ixself(old), FALSE)) < 0)
+		return FALSE;
+	if (!pf)
+		keepversion(btree, ixself(old), TRUE);
+
+/* header is same but for the one entry */
+	newb = allocblock();
+	memcpy(newb, old, PAGELEN);
+	if (!found) {
+		for (i = n; i > lo; i--) {
+			rkeys(newb, i) = rkeys(newb, i-1);
+			offs(newb, i) = offs(newb, i-1);
+			lens(newb, i) = lens(newb, i-1);
+		}
+		rkeys(newb, lo) = rkey;
+		nkeys(newb) = n + 1;
+	}
+	offs(newb, lo) = end;
+	lens(newb, lo) = len;
+
+/* data goes down first, so header never points past end of file */
+	if (pf) {
+		if (len)
+			writepages(pf, ixself(old), rec, len, PAGELEN + end);
+		writepages(pf, ixself(old), newb, PAGELEN, 0);
+	} else if ((len && !writefilefd(fd, rec, len, PAGELEN + end))
+		|| !writefilefd(fd, newb, PAGELEN, 0)) {
+		char msg[256];
+		sprintf(msg, "Failed to append record (rkey=%s) to blockfile: %s"
+			, rkey2str(rkey), fkey2path(ixself(old)));
+		FATAL2(msg);
+	}
+	btcount(btree, c_byteswritten, len + PAGELEN);
+	putheader(btree, newb);
+	stdfree(old);
 	return TRUE;
 }
+/*======================================================
+ * copyrecord -- Copy record from original block file to temp file
+ *  btree:  [IN]  btree
+ *  fkey:   [IN]  original block (read from paged file if neither
+ *                 fpsrc nor fdsrc is given)
+ *  fpsrc:  [IN]  original block file (if opened with stdio)
+ *  fdsrc:  [IN]  cached descriptor of original (or -1)
+ *  off:    [IN]  offset of record in original
+ *  len:    [IN]  length of record
+ *  fpdest: [IN]  destination (temp) file
+ *====================================================*/
+static void
+copyrecord (BTREE btree, FKEY fkey, FILE *fpsrc, int fdsrc, INT off, INT len, FILE *fpdest)
+{
+	char buffer[BUFLEN];
+	INT blklen;
+	btcount(btree, c_bytesread, len);
+	if (fpsrc) {
+		if (fseek(fpsrc, (long)off, 0))
+			FATAL();
+		filecopy(fpsrc, len, fpdest);
+		return;
+	}
+	while (len) {
+		blklen = (len > BUFLEN) ? BUFLEN : len;
+		if (fdsrc >= 0) {
+			ASSERT(readfilefd(fdsrc, buffer, blklen, off));
+		} else {
+			ASSERT(readpages(bpagefile(btree), fkey, buffer, blklen, off));
+		}
+		ASSERT(fwrite(buffer, blklen, 1, fpdest) == 1);
+		off += blklen;
+		len -= blklen;
+	}
+}
 /*======================================================
  * filecopy -- Copy record from one data file to another
  * Copy from source file (already opened) to destination
@@ -346,31 +513,177 @@ filecopy (FILE* fpsrc, INT len, FILE* fpdest)
 		len -= blklen;
 	}
 }
+/*==================================
+ * readblockdata -- Read all record data of a data block
+ *  btree:  [in]  btree
+ *  block:  [in]  header of block
+ * returns new buffer (caller frees), with room for
+ *  a terminating zero after the data
+ *===============================*/
+STRING
+readblockdata (BTREE btree, BLOCK block)
+{
+	char scratch[MAXPATHLEN];
+	INT i, total = 0;
+	STRING data;
+	CNSTRING mapped;
+	INT maplen;
+	FILE *fp;
+	int fd;
+
+	for (i = 0; i < nkeys(block); ++i) {
+		if (offs(block, i) + lens(block, i) > total)
+			total = offs(block, i) + lens(block, i);
+	}
+	data = (STRING) stdalloc(total + 1);
+	if (!total)
+		return data;
+	btcount(btree, c_bytesread, total);
+	if (bshared(btree)) {
+		if (sharedread(btree, ixself(block), data, total, PAGELEN))
+			return data;
+	} else if (bpagefile(btree)) {
+		if (readpages(bpagefile(btree), ixself(block), data, total, PAGELEN))
+			return data;
+	} else if ((mapped = getmappedfile(btree, ixself(block), &maplen)) != NULL) {
+		if (PAGELEN + total <= maplen) {
+			memcpy(data, mapped + PAGELEN, total);
+			return data;
+		}
+	} else if ((fd = getfilefd(btree, ixself(block), FALSE)) >= 0) {
+		if (readfilefd(fd, data, total, PAGELEN))
+			return data;
+	} else {
+		sprintf(scratch, "%s/%s", bbasedir(btree), fkey2path(ixself(block)));
+		fp = fopen(scratch, LLREADBINARY LLFILERANDOM);
+		if (snapfile(btree, ixself(block), scratch, sizeof(scratch))) {
+			if (fp) fclose(fp);
+			fp = fopen(scratch, LLREADBINARY LLFILERANDOM);
+		}
+		if (fp != NULL) {
+			BOOLEAN ok;
+			btcount(btree, c_opens, 1);
+			ok = !fseek(fp, (long)PAGELEN, 0)
+				&& fread(data, total, 1, fp) == 1;
+			fclose(fp); /* readonly */
+			if (ok)
+				return data;
+		}
+	}
+	sprintf(scratch, "Corrupt db -- failed to read %ld bytes from blockfile: %s"
+		, (long)total, fkey2path(ixself(block)));
+	FATAL2(scratch);
+	return NULL;
+}
 /*==================================
  * readrec -- read record from block
  *  btree: [in]  database pointer
  *  block: [in]  block of data from disk (leaf of btree)
  *  i:     [in]  index in leaf block desired
  *  plen:  [out] length of returned data
+ * unpacks record of compressed block
  *================================*/
 RAWRECORD
 readrec (BTREE btree, BLOCK block, INT i, INT *plen)
+{
+	RAWRECORD packed, rawrec;
+	INT len;
+
+	packed = readstored(btree, block, i, &len);
+	btcount(btree, c_readrecs, 1);
+	btcount(btree, c_bytesread, len);
+	if (ixtype(block) != BTPACKTYPE || !packed) {
+		*plen = len;
+		return packed;
+	}
+	*plen = unpackedlen(packed, len);
+	rawrec = (RAWRECORD) stdalloc(*plen + 1);
+	unpackrecord(packed, len, rawrec);
+	rawrec[*plen] = 0;
+	stdfree(packed);
+	return rawrec;
+}
+/*==================================
+ * readstored -- read record from block, as stored
+ *  btree: [in]  database pointer
+ *  block: [in]  block of data from disk (leaf of btree)
+ *  i:     [in]  index in leaf block desired
+ *  plen:  [out] length of returned data
+ *================================*/
+static RAWRECORD
+readstored (BTREE btree, BLOCK block, INT i, INT *plen)
 {
 	char scratch[MAXPATHLEN];
 	FILE *fd=NULL;
 	RAWRECORD rawrec;
 	INT len;
-
+	CNSTRING mapped;
+	INT maplen;
+	PAGEFILE pf = bpagefile(btree);
+	int fdi = -1;
+
+	if (!bshared(btree)
+		&& (mapped = getmappedfile(btree, ixself(block), &maplen)) != NULL) {
+		/* readonly btree -- copy record straight out of mapped file */
+		if ((len = lens(block, i)) == 0) {
+			*plen = 0;
+			return NULL;
+		}
+		if (len < 0 || offs(block, i) < 0
+			|| offs(block, i) + PAGELEN + len > maplen) {
+			char msg[sizeof(scratch)+64];
+			sprintf(msg, "Bad offset (%ld) or len (%ld) for blockfile (rkey=%s)"
+				, offs(block, i), len, rkey2str(rkeys(block, i)));
+			FATAL2(msg);
+		}
+		rawrec = (RAWRECORD) stdalloc(len + 1);
+		memcpy(rawrec, mapped + PAGELEN + offs(block, i), len);
+		rawrec[len] = 0;
+		*plen = len;
+		return rawrec;
+	}
+	if (bshared(btree) || pf
+		|| (fdi = getfilefd(btree, ixself(block), FALSE)) >= 0) {
+		if ((len = lens(block, i)) == 0) {
+			*plen = 0;
+			return NULL;
+		}
+		if (len < 0) {
+			char msg[sizeof(scratch)+64];
+			sprintf(msg, "Bad len (%ld) for blockfile (rkey=%s)"
+				, len, rkey2str(rkeys(block, i)));
+			FATAL2(msg);
+		}
+		rawrec = (RAWRECORD) stdalloc(len + 1);
+		if (!(bshared(btree)
+			? sharedread(btree, ixself(block), rawrec, len, offs(block, i) + PAGELEN)
+			: pf ? readpages(pf, ixself(block), rawrec, len, offs(block, i) + PAGELEN)
+			: readfilefd(fdi, rawrec, len, offs(block, i) + PAGELEN))) {
+			char msg[sizeof(scratch)+64];
+			sprintf(msg, "Read for %ld bytes failed for blockfile (rkey=%s)"
+				, len, rkey2str(rkeys(block, i)));
+			FATAL2(msg);
+		}
+		rawrec[len] = 0;
+		*plen = len;
+		return rawrec;
+	}
 	snprintf(scratch, sizeof(scratch)
 		, "%s%c%s"
 		, bbasedir(btree), LLCHRDIRSEPARATOR, fkey2path(ixself(block)));
-	if (!(fd = fopen(scratch, LLREADBINARY LLFILERANDOM))) {
+	fd = fopen(scratch, LLREADBINARY LLFILERANDOM);
+	if (snapfile(btree, ixself(block), scratch, sizeof(scratch))) {
+		if (fd) fclose(fd);
+		fd = fopen(scratch, LLREADBINARY LLFILERANDOM);
+	}
+	if (!fd) {
 		char msg[sizeof(scratch)+64];
 		sprintf(msg, _("Failed (errno=%d) to open blockfile (rkey=%s): %s")
 			, errno, rkey2str(rkeys(block, i)), scratch);
 		FATAL2(msg);
 	}
-	if (fseek(fd, (long)(offs(block, i) + BUFLEN), 0)) {
+	btcount(btree, c_opens, 1);
+	if (fseek(fd, (long)(offs(block, i) + PAGELEN), 0)) {
 		char msg[sizeof(scratch)+64];
 		sprintf(msg, "Seek to offset (%ld) failed for blockfile (rkey=%s)"
 			, offs(block,i), rkey2str(rkeys(block, i)));
@@ -410,28 +723,32 @@ RAWRECORD
 bt_getrecord (BTREE btree, const RKEY * rkey, INT *plen)
 {
 	INDEX index;
-	SHORT i, n, lo, hi;
+	SHORT lo, hi;
 	FKEY nfkey;
 	BLOCK block;
 	BOOLEAN found = FALSE;
 	RAWRECORD rawrec;
+	INT copy[BTMAXPAGELEN/sizeof(INT)]; /* header, if btree is shared */
 
 #ifdef DEBUG
 	llwprintf("GETRECORD: rkey: %s\n", rkey2str(*rkey));
 #endif
 	*plen = 0;
 	ASSERT(index = bmaster(btree));
+	btcount(btree, c_gets, 1);
+	tickcounters(btree);
+
+/* records not yet checkpointed are in the write-ahead log */
+	if (walgetrecord(btree, rkey, &rawrec, plen))
+		goto have_record;
 
 /* search for data block that does/should hold record */
 	while (ixtype(index) == BTINDEXTYPE) {
-		n = nkeys(index);
-		nfkey = fkeys(index, 0);
-		for (i = 1; i <= n; i++) {
-			if (cmpkeys(rkey, &rkeys(index, i)) < 0)
-				break;
-			nfkey = fkeys(index, i);
-		}
-		index = getindex(btree, nfkey);
+		nfkey = fkeys(index, childslot(index, rkey));
+		/* filter of data block may show record is not there */
+		if (notinblock(btree, nfkey, rkey))
+			return NULL;
+		index = viewindex(btree, nfkey, (INDEX)copy);
 		/* should never revisit the master node */
 		if (ixself(index) == ixself(bmaster(btree))) {
 			char msg[400];
@@ -461,20 +778,38 @@ bt_getrecord (BTREE btree, const RKEY * rkey, INT *plen)
 	if (!found) return NULL;
 
 	rawrec = readrec(btree, block, lo, plen);
+have_record:
 	if (rawrec && !strcmp(rawrec, "DELE\n")) {
 		stdfree(rawrec);
 		rawrec=NULL;
+		*plen = 0;
 	}
 	return rawrec;
 }
 /*=======================================
  * movefiles -- Move first file to second
+ *  btree:     [in] database pointer
+ *  fkey:      [in] btree file being replaced (to_file)
+ * (in a paged btree, from_file is copied into the paged file instead)
  * failure handled with FATAL2 macro, which exits
  *=====================================*/
-static void
-movefiles (STRING from_file, STRING to_file)
+void
+movefiles (BTREE btree, FKEY fkey, STRING from_file, STRING to_file)
 {
 	INT rtn;
+	struct stat sbuf;
+	btcount(btree, c_moves, 1);
+	if (!stat(from_file, &sbuf)) {
+		btcount(btree, c_byteswritten, (long)sbuf.st_size);
+	}
+	if (bpagefile(btree)) {
+		importpages(bpagefile(btree), fkey, from_file);
+		return;
+	}
+	keepversion(btree, fkey, FALSE);
+	/* cached descriptors & mappings refer to the file being replaced */
+	closefilefd(btree, fkey);
+	unmapfile(btree, fkey);
 	unlink(to_file);
 	rtn = rename(from_file, to_file);
 	if (rtn) {
@@ -485,6 +820,28 @@ movefiles (STRING from_file, STRING to_file)
 		FATAL2(temp);
 	}
 }
+/*=======================================
+ * removefile -- Remove index or block file of btree
+ *  btree:     [in] database pointer
+ *  fkey:      [in] btree file no longer used (its cached header
+ *             is dropped too)
+ *=====================================*/
+void
+removefile (BTREE btree, FKEY fkey)
+{
+	char scratch[MAXPATHLEN];
+	uncacheindex(btree, fkey);
+	dropfilter(btree, fkey);
+	if (bpagefile(btree)) {
+		removepages(bpagefile(btree), fkey);
+		return;
+	}
+	keepversion(btree, fkey, FALSE);
+	closefilefd(btree, fkey);
+	unmapfile(btree, fkey);
+	sprintf(scratch, "%s/%s", bbasedir(btree), fkey2path(fkey));
+	unlink(scratch);
+}
 /*====================================================
  * isrecord -- See if there is a record with given key
  *==================================================*/
@@ -493,21 +850,23 @@ isrecord (BTREE btree,
           RKEY rkey)
 {
 	INDEX index;
-	SHORT i, n, lo, hi;
+	SHORT lo, hi;
 	FKEY nfkey;
 	BLOCK block;
+	INT copy[BTMAXPAGELEN/sizeof(INT)]; /* header, if btree is shared */
+
+	btcount(btree, c_gets, 1);
+	tickcounters(btree);
+	if (walgetrecord(btree, &rkey, NULL, NULL))
+		return TRUE;
 
 /* search for data block that does/should hold record */
 	ASSERT(index = bmaster(btree));
 	while (ixtype(index) == BTINDEXTYPE) {
-		n = nkeys(index);
-		nfkey = fkeys(index, 0);
-		for (i = 1; i <= n; i++) {
-			if (cmpkeys(&rkey, &rkeys(index, i)) < 0)
-				break;
-			nfkey = fkeys(index, i);
-		}
-		index = getindex(btree, nfkey);
+		nfkey = fkeys(index, childslot(index, &rkey));
+		if (notinblock(btree, nfkey, &rkey))
+			return FALSE;
+		index = viewindex(btree, nfkey, (INDEX)copy);
 	}
 
 /* Found block that may hold record - search for key */
@@ -528,11 +887,65 @@ isrecord (BTREE btree,
 }
 /*====================================================
  * cmpkeys -- Compare two keys of btree
+ *  Keys are compared as big-endian 64 bit numbers, which
+ *  orders them as strncmp does (keys hold no NULs), but
+ *  without a call or loop per byte
  *==================================================*/
 INT
 cmpkeys (const RKEY * rk1, const RKEY * rk2)
 {
-	INT rel = ll_strncmp(rk1->r_rkey, rk2->r_rkey, 8);
-	return rel;
+	u_int64_t v1, v2;
+	if (opt_finnish)
+		return ll_strncmp(rk1->r_rkey, rk2->r_rkey, RKEYLEN);
+	v1 = keyval(rk1);
+	v2 = keyval(rk2);
+	return (v1 > v2) - (v1 < v2);
+}
+/*====================================================
+ * childslot -- Find entry of index to descend to for key
+ *  index: [IN]  index (not data block)
+ *  rkey:  [IN]  key sought
+ * returns i such that fkeys(index, i) covers rkey, ie, the
+ *  number of keys 1..nkeys of index not above rkey
+ * Binary search whose only branch is the loop itself (the
+ *  comparison becomes a conditional move), so that a full
+ *  index takes some 9 steps & no mispredictions
+ *==================================================*/
+INT
+childslot (INDEX index, const RKEY *rkey)
+{
+	const RKEY *base = &rkeys(index, 1);
+	u_int64_t val;
+	INT lo = 0, len = nkeys(index), half;
+
+	if (opt_finnish) {
+		for (lo = 0; lo < len; ++lo) {
+			if (cmpkeys(rkey, &base[lo]) < 0)
+				break;
+		}
+		return lo;
+	}
+	val = keyval(rkey);
+	/* answer is in lo..lo+len; keys above it are all > rkey */
+	while (len > 1) {
+		half = len/2;
+		lo += (keyval(&base[lo + half - 1]) <= val) ? half : 0;
+		len -= half;
+	}
+	if (len == 1 && keyval(&base[lo]) <= val)
+		++lo;
+	return lo;
+}
+/*====================================================
+ * keyval -- Key as big-endian number (see cmpkeys)
+ *==================================================*/
+static u_int64_t
+keyval (const RKEY *rkey)
+{
+	const unsigned char *p = (const unsigned char *)rkey->r_rkey;
+	return ((u_int64_t)p[0] << 56) | ((u_int64_t)p[1] << 48)
+		| ((u_int64_t)p[2] << 40) | ((u_int64_t)p[3] << 32)
+		| ((u_int64_t)p[4] << 24) | ((u_int64_t)p[5] << 16)
+		| ((u_int64_t)p[6] << 8) | (u_int64_t)p[7];
 }
 
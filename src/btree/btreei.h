@@ -6,28 +6,157 @@
 
 #include "btree.h"
 
+/* max depth of index levels (NOENTS^8 blocks is plenty) */
+#define BTMAXLEVELS 8
+/* default memory budget of index cache (see bt_setcachesize) */
+#define BTINDEXCACHEBYTES (256*BUFLEN)
+/* rewrite (compact) data block instead of appending to it once
+ more than this percentage of its record data would be dead */
+#define BTMAXDEADPCT 50
+/* name of write-ahead log file in database directory */
+#define BTWALFILE "wal"
+/* checkpoint batch early when this much record data is pending (or logged) */
+#define BTWALMAXBYTES (8*1024*1024)
+/* name of single paged file of paged btree in database directory */
+#define BTPAGEFILE "pages"
+/* max number of files mapped at once by readonly btrees */
+#define BTMAPCACHESIZE 64
+/* default max number of files held open (see bt_setfilecache) */
+#define BTFDCACHESIZE 32
+/* default number of records between log entries of counters
+ (see bt_setstatslog) */
+#define BTSTATSEVERY 10000
+/* default memory budget of data block filters (see bt_setfiltersize);
+ each takes about 1/16 of a header, so this covers some 4000 blocks */
+#define BTFILTERBYTES (1024*1024)
+/* name of directory of snapshot readers & versions kept for them */
+#define BTSNAPDIR "snap"
+/* seconds a snapshot reader waits for an operation of the writer */
+#define BTSNAPWAIT 30
+
 /* addkey.c */ 
 void addkey(BTREE, FKEY, RKEY, FKEY);
 
+/* addrecs.c */
+/* one record for addrecords */
+typedef struct {
+	RKEY      a_rkey; /* key of record */
+	CNSTRING  a_rec;  /* data of record */
+	INT       a_len;  /* length of data */
+} ADDREC;
+void addrecords(BTREE, ADDREC *recs, INT n);
+
+/* bloom.c */
+void addfilter(BTREE, BLOCK);
+void dropfilter(BTREE, FKEY);
+void freefilters(BTREE);
+void initfilters(BTREE, INT bytes);
+BOOLEAN notinblock(BTREE, FKEY, const RKEY *rkey);
+
+/* bulkload.c */
+void bulkrecords(BTREE, ADDREC *recs, INT n);
+BOOLEAN emptybtree(BTREE);
+
+/* compress.c */
+STRING packrecord(CNSTRING rec, INT len, INT *plen);
+INT unpackedlen(CNSTRING data, INT len);
+void unpackrecord(CNSTRING data, INT len, STRING out);
+
 /* block.c */
 BLOCK crtblock(BTREE);
 BLOCK allocblock(void);
 
 /* btree.c */
+INT childslot(INDEX index, const RKEY *rkey);
+BLOCK findleaf(BTREE btree, RKEY rkey);
+void movefiles(BTREE btree, FKEY fkey, STRING from_file, STRING to_file);
+void removefile(BTREE btree, FKEY fkey);
+STRING readblockdata(BTREE btree, BLOCK block);
 RAWRECORD readrec(BTREE btree, BLOCK block, INT i, INT *plen);
 
+/* fdcache.c */
+int cachedfd(FDCACHE, BTREE, FKEY, BOOLEAN create);
+void closefilefd(BTREE, FKEY);
+void dropfdcache(FDCACHE);
+void freefdcache(BTREE);
+int getfilefd(BTREE, FKEY, BOOLEAN create);
+void initfdcache(BTREE, INT);
+FDCACHE newfdcache(INT n);
+BOOLEAN readfilefd(int fd, void *buf, INT len, INT off);
+void syncfilefds(BTREE);
+BOOLEAN writefilefd(int fd, const void *buf, INT len, INT off);
+
 /* index.c */
+INT cachebytes(INDEXCACHE);
+BOOLEAN copyfromcache(INDEXCACHE, FKEY, INDEX out);
+void copytocache(INDEXCACHE, INDEX);
 INDEX crtindex(BTREE);
+void dropcache(INDEXCACHE);
 void freecache(BTREE);
 INDEX getindex(BTREE, FKEY);
-void initcache(BTREE, INT);
+void initcache(BTREE, INT bytes);
+INDEXCACHE newcache(INT bytes);
+INDEX pinindex(BTREE, FKEY);
 void putheader(BTREE, BLOCK);
 void putindex(BTREE, INDEX);
+void uncacheindex(BTREE, FKEY);
+void unpinindex(BTREE, FKEY);
 void writeindex(BTREE, INDEX);
 
+/* mapcache.c */
+void freemapcache(BTREE);
+CNSTRING getmappedfile(BTREE, FKEY, INT *plen);
+void initmapcache(BTREE, INT);
+void unmapfile(BTREE, FKEY);
+
+/* pagefile.c */
+void closepagefile(PAGEFILE);
+void importpages(PAGEFILE, FKEY, STRING file);
+PAGEFILE openpagefile(STRING path, BOOLEAN write, BOOLEAN create);
+BOOLEAN readpages(PAGEFILE, FKEY, void *buf, INT len, INT off);
+void removepages(PAGEFILE, FKEY);
+void syncpagefile(PAGEFILE);
+void writepages(PAGEFILE, FKEY, const void *buf, INT len, INT off);
+
+/* shared.c */
+void freeshared(BTREE);
+BOOLEAN sharedread(BTREE, FKEY, void *buf, INT len, INT off);
+INDEX sharedindex(BTREE, FKEY, INDEX out);
+INDEX viewindex(BTREE, FKEY, INDEX copy);
+
+/* snapshot.c */
+BOOLEAN insnapshot(BTREE);
+void keepversion(BTREE, FKEY, BOOLEAN inplace);
+BOOLEAN snapattach(BTREE, FKEY *pmkey, INT *lldberr);
+void snapbegin(BTREE);
+void snapclose(BTREE);
+void snapend(BTREE);
+BOOLEAN snapfile(BTREE, FKEY, STRING path, INT len);
+void snapopen(BTREE);
+BOOLEAN snapreaders(BTREE);
+
+/* stats.c */
+/* add n to counter f of btree b (unless shared, when threads race) */
+#define btcount(b, f, n) if (!bshared(b)) (b)->b_counters.f += (n)
+void logcounters(BTREE, CNSTRING why);
+void tickcounters(BTREE);
+
 /* utils.c */
+STRING fkeypath(FKEY, STRING path);
 void newmaster(BTREE, INDEX);
 FKEY path2fkey(STRING);
 void nextfkey(BTREE);
+void setpagelen(INT pagelen);
+void syncfile(FILE *fp, STRING filename);
+BOOLEAN validpagelen(INT pagelen);
+
+/* wal.c */
+BOOLEAN waladdrecord(BTREE, RKEY, CNSTRING rec, INT len);
+void walcheckpoint(BTREE);
+void walclose(BTREE);
+BOOLEAN walgetrecord(BTREE, const RKEY *, RAWRECORD *prec, INT *plen);
+BOOLEAN walinbatch(BTREE);
+void walopen(BTREE);
+ADDREC *walpending(BTREE, const RKEY *lo, const RKEY *hi, INT *pn);
 
 #endif /* _BTREE_PRIV_H */
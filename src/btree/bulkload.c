@@ -0,0 +1,360 @@
+/*
+   Copyright (c) 2026 The LifeLines developers
+   "The MIT license"
+   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+/*=============================================================
+ * bulkload.c -- Build BTREE bottom-up from a stream of records
+ *  Only for an empty btree. Records, in key order, are put
+ *  into full data blocks, each block file being written once,
+ *  and the index levels are filled in above them as blocks
+ *  complete, so no block or index is ever split.
+ *  The first records checkpointed into a btree are written
+ *  this way (see addrecords).
+ *  The result is an ordinary btree (see bt_openbtree).
+ *  A btree can also be compacted by rebuilding it this way
+ *  from its own records (see bt_compactbtree).
+ *   Created: 2026/10
+ *===========================================================*/
+
+#include "sys_inc.h"
+#include "llstdlib.h"
+#include "btreei.h"
+
+/*********************************************
+ * local types
+ *********************************************/
+
+typedef struct tag_bulkload *BULKLOAD;
+
+struct tag_bulkload {
+	BTREE    bl_btree;     /* btree being built */
+	BLOCK    bl_leaf;      /* header of data block being filled */
+	FILE    *bl_leaffp;    /* file of data block being filled */
+	INT      bl_leafoff;   /* record data written to it so far */
+	INDEX    bl_index[BTMAXLEVELS]; /* index being filled at each level */
+	INT      bl_nlevels;   /* levels of index started */
+	BOOLEAN  bl_any;       /* any record written ? */
+	RKEY     bl_last;      /* key of last record written */
+};
+
+/*********************************************
+ * local function prototypes
+ *********************************************/
+
+/* alphabetical */
+static void buildrecord(BULKLOAD bl, RKEY rkey, CNSTRING rec, INT len);
+static void droptree(BTREE btree, INDEX index);
+static void finishleaf(BULKLOAD bl);
+static void finishtree(BULKLOAD bl);
+static void freebulk(BULKLOAD bl);
+static void leafpath(BULKLOAD bl, STRING path, INT len);
+static BULKLOAD newbulk(BTREE btree);
+static void pushkey(BULKLOAD bl, INT level, RKEY rkey, FKEY fkey);
+static void startleaf(BULKLOAD bl);
+
+/*********************************************
+ * local & exported function definitions
+ * body of module
+ *********************************************/
+
+/*=================================
+ * bulkrecords -- Build empty btree from sorted records
+ *  btree:  [in] writeable btree, with no records yet
+ *  recs:   [in] records, sorted by key (cmpkeys), no duplicates
+ *  n:      [in] number of records
+ * Used by addrecords for the first records put into a btree
+ *===============================*/
+void
+bulkrecords (BTREE btree, ADDREC *recs, INT n)
+{
+	BULKLOAD bl = newbulk(btree);
+	INT i;
+	for (i = 0; i < n; ++i)
+		buildrecord(bl, recs[i].a_rkey, recs[i].a_rec, recs[i].a_len);
+	finishtree(bl);
+	freebulk(bl);
+}
+/*=================================
+ * bt_compactbtree -- Rebuild whole btree from its records
+ *  btree:  [in] writeable btree
+ *  keep:   [in] called for each record; returns FALSE to drop it
+ *               (NULL to keep all)
+ *  param:  [in] passed to keep
+ * returns number of records dropped, or -1 if btree is not writeable
+ *  or a batch is open (whose records must not be written yet)
+ * Blocks & indices are rebuilt full, in new files, & the new master
+ *  index replaces the old one only once they are all on disk, so if
+ *  this does not complete, the old tree is still whole. The old
+ *  files are then removed.
+ * If no record is kept, the btree is left as it was.
+ *===============================*/
+INT
+bt_compactbtree (BTREE btree, TRAV_RECORD_FUNC_BYKEY keep, void *param)
+{
+	BULKLOAD bl;
+	BTCURSOR cursor;
+	RKEY rkey, none;
+	STRING rec;
+	INT len, dropped = 0;
+
+	if (!bwrite(btree) || walinbatch(btree))
+		return -1;
+	memset(&none, 0, sizeof(none));
+	bl = newbulk(btree);
+	/* records come in key order, so go straight into blocks */
+	cursor = bt_cursor_open(btree, none, none);
+	while (bt_cursor_next(cursor, &rkey, &rec, &len)) {
+		if (keep && !(*keep)(rkey, rec, len, param)) {
+			++dropped;
+			continue;
+		}
+		buildrecord(bl, rkey, rec, len);
+	}
+	bt_cursor_close(cursor);
+	finishtree(bl);
+	if (!bl->bl_any)
+		dropped = 0;
+	freebulk(bl);
+	return dropped;
+}
+/*=================================
+ * emptybtree -- Does btree hold no records at all ?
+ *  (ie, is it just as initbtree made it)
+ *===============================*/
+BOOLEAN
+emptybtree (BTREE btree)
+{
+	INDEX master = bmaster(btree);
+	BLOCK block;
+	if (nkeys(master)) return FALSE;
+	block = (BLOCK) getindex(btree, fkeys(master, 0));
+	return ixtype(block) != BTINDEXTYPE && !nkeys(block);
+}
+/*=================================
+ * newbulk -- Create bulk load state
+ *===============================*/
+static BULKLOAD
+newbulk (BTREE btree)
+{
+	BULKLOAD bl = (BULKLOAD) stdalloc(sizeof(*bl));
+	memset(bl, 0, sizeof(*bl));
+	bl->bl_btree = btree;
+	return bl;
+}
+/*=================================
+ * freebulk -- Free bulk load state
+ *===============================*/
+static void
+freebulk (BULKLOAD bl)
+{
+	stdfree(bl);
+}
+/*=================================
+ * leafpath -- Name of file data block being filled is written to
+ *  (in a paged btree, a temp file copied in by finishleaf)
+ *===============================*/
+static void
+leafpath (BULKLOAD bl, STRING path, INT len)
+{
+	BTREE btree = bl->bl_btree;
+	if (bpagefile(btree))
+		snprintf(path, len, "%s%ctmp1", bbasedir(btree), LLCHRDIRSEPARATOR);
+	else
+		snprintf(path, len, "%s%c%s", bbasedir(btree)
+			, LLCHRDIRSEPARATOR, fkey2path(ixself(bl->bl_leaf)));
+}
+/*=================================
+ * buildrecord -- Append next record to btree being built
+ *  Records must come in strictly increasing key order
+ *===============================*/
+static void
+buildrecord (BULKLOAD bl, RKEY rkey, CNSTRING rec, INT len)
+{
+	char scratch[MAXPATHLEN];
+	BLOCK leaf;
+	INT i;
+	STRING packed = NULL;
+
+	if (bl->bl_any && cmpkeys(&bl->bl_last, &rkey) >= 0) {
+		sprintf(scratch, "Bulk btree records out of order at rkey=%s"
+			, rkey2str(rkey));
+		FATAL2(scratch);
+	}
+	bl->bl_any = TRUE;
+	bl->bl_last = rkey;
+	/* blocks are filled to the same limit bt_addrecord splits at */
+	if (bl->bl_leaf && nkeys(bl->bl_leaf) == NORECS-1)
+		finishleaf(bl);
+	if (!bl->bl_leaf)
+		startleaf(bl);
+	leaf = bl->bl_leaf;
+	if (ixtype(leaf) == BTPACKTYPE) {
+		packed = packrecord(rec, len, &len);
+		rec = packed;
+	}
+	i = nkeys(leaf)++;
+	rkeys(leaf, i) = rkey;
+	offs(leaf, i) = bl->bl_leafoff;
+	lens(leaf, i) = len;
+	if (len) {
+		leafpath(bl, scratch, sizeof(scratch));
+		CHECKED_fwrite(rec, len, 1, bl->bl_leaffp, scratch);
+	}
+	bl->bl_leafoff += len;
+	if (packed)
+		stdfree(packed);
+}
+/*=================================
+ * startleaf -- Start new data block file
+ *  Header is written again when block is full
+ *  Block is compressed if btree is set to (bpack)
+ *===============================*/
+static void
+startleaf (BULKLOAD bl)
+{
+	char scratch[MAXPATHLEN];
+	BLOCK leaf = crtblock(bl->bl_btree);
+
+	if (bpack(bl->bl_btree))
+		ixtype(leaf) = BTPACKTYPE;
+	bl->bl_leaf = leaf;
+	leafpath(bl, scratch, sizeof(scratch));
+	if (!(bl->bl_leaffp = fopen(scratch, LLWRITEBINARY LLFILERANDOM))) {
+		char msg[sizeof(scratch)+64];
+		sprintf(msg, "Failed to open new blockfile: %s", scratch);
+		FATAL2(msg);
+	}
+	CHECKED_fwrite(leaf, PAGELEN, 1, bl->bl_leaffp, scratch);
+	bl->bl_leafoff = 0;
+}
+/*=================================
+ * finishleaf -- Complete data block being filled
+ *  Its key goes into lowest index level, and its
+ *  header is written & handed to the index cache
+ *===============================*/
+static void
+finishleaf (BULKLOAD bl)
+{
+	char scratch[MAXPATHLEN];
+	BLOCK leaf = bl->bl_leaf;
+
+	pushkey(bl, 0, rkeys(leaf, 0), ixself(leaf));
+	ixparent(leaf) = ixself(bl->bl_index[0]);
+	leafpath(bl, scratch, sizeof(scratch));
+	if (fseek(bl->bl_leaffp, 0L, 0)) {
+		char msg[sizeof(scratch)+64];
+		sprintf(msg, "Failed to seek in new blockfile: %s", scratch);
+		FATAL2(msg);
+	}
+	CHECKED_fwrite(leaf, PAGELEN, 1, bl->bl_leaffp, scratch);
+	btcount(bl->bl_btree, c_byteswritten, PAGELEN + bl->bl_leafoff);
+	if (bpagefile(bl->bl_btree)) {
+		/* paged file is synced once, by finishtree */
+		CHECKED_fclose(bl->bl_leaffp, scratch);
+		importpages(bpagefile(bl->bl_btree), ixself(leaf), scratch);
+	} else {
+		syncfile(bl->bl_leaffp, scratch);
+		CHECKED_fclose(bl->bl_leaffp, scratch);
+	}
+	putheader(bl->bl_btree, leaf);
+	bl->bl_leaf = NULL;
+	bl->bl_leaffp = NULL;
+}
+/*=================================
+ * pushkey -- Add entry to index being filled at level
+ *  bl:     [in] bulk load
+ *  level:  [in] index level (0 is just above data blocks)
+ *  rkey:   [in] first key under new entry
+ *  fkey:   [in] index or block of new entry
+ * A full index is first pushed into the level above (so that
+ * its parent is known) & written out
+ *===============================*/
+static void
+pushkey (BULKLOAD bl, INT level, RKEY rkey, FKEY fkey)
+{
+	BTREE btree = bl->bl_btree;
+	INDEX index = bl->bl_index[level];
+	INT n;
+
+	/* indices are filled to the same limit addkey splits at */
+	if (index && nkeys(index) == NOENTS-2) {
+		pushkey(bl, level+1, rkeys(index, 0), ixself(index));
+		ixparent(index) = ixself(bl->bl_index[level+1]);
+		putindex(btree, index);
+		index = bl->bl_index[level] = NULL;
+	}
+	if (!index) {
+		ASSERT(level < BTMAXLEVELS);
+		index = bl->bl_index[level] = crtindex(btree);
+		if (level >= bl->bl_nlevels)
+			bl->bl_nlevels = level+1;
+		/* first key kept in unused slot 0, for pushing index up */
+		rkeys(index, 0) = rkey;
+		fkeys(index, 0) = fkey;
+		return;
+	}
+	n = ++nkeys(index);
+	rkeys(index, n) = rkey;
+	fkeys(index, n) = fkey;
+}
+/*=================================
+ * finishtree -- Complete all levels & install new master index
+ *  The files of the original btree are then removed
+ *===============================*/
+static void
+finishtree (BULKLOAD bl)
+{
+	BTREE btree = bl->bl_btree;
+	INDEX old = bmaster(btree), root, index;
+	INT level;
+
+	if (bl->bl_leaf)
+		finishleaf(bl);
+	if (!bl->bl_nlevels)
+		return; /* no records, so nothing to do */
+	/* bl_nlevels may grow as indices are pushed up */
+	for (level = 0; level < bl->bl_nlevels - 1; ++level) {
+		index = bl->bl_index[level];
+		pushkey(bl, level+1, rkeys(index, 0), ixself(index));
+		ixparent(index) = ixself(bl->bl_index[level+1]);
+		putindex(btree, index);
+		bl->bl_index[level] = NULL;
+	}
+	root = bl->bl_index[bl->bl_nlevels - 1];
+	bl->bl_index[bl->bl_nlevels - 1] = NULL;
+	ixparent(root) = 0;
+	/* snapshot readers go on with the original tree */
+	snapbegin(btree);
+	writeindex(btree, root);
+	/* everything below new master must be on disk before it is used */
+	syncfilefds(btree);
+	newmaster(btree, root);
+	syncfile(bkfp(btree), bbasedir(btree));
+
+	/* drop the original tree (just empty master & block, if new) */
+	droptree(btree, old);
+	snapend(btree);
+	stdfree(old);
+}
+/*=================================
+ * droptree -- Remove files of index & of everything below it
+ *  index:  [in] index or block no longer in btree (not freed)
+ * Reads below it skip the index cache, as they are dropped
+ *===============================*/
+static void
+droptree (BTREE btree, INDEX index)
+{
+	INDEX child;
+	INT i;
+	if (ixtype(index) == BTINDEXTYPE) {
+		for (i = 0; i <= nkeys(index); i++) {
+			child = readindex(btree, fkeys(index, i), FALSE);
+			droptree(btree, child);
+			stdfree(child);
+		}
+	}
+	removefile(btree, ixself(index));
+}
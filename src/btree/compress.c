@@ -0,0 +1,283 @@
+/*
+   Copyright (c) 2026 The LifeLines developers
+   "The MIT license"
+   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+/*=============================================================
+ * compress.c -- Compression of records in BTREE data blocks
+ *  Records of compressed blocks (BTPACKTYPE) are each stored
+ *  as a method byte & original length, followed by either the
+ *  record itself or its LZSS encoding. Encoding may refer back
+ *  into a fixed dictionary of common GEDCOM text, which counts
+ *  as coming just before every record.
+ *  LZSS stream: a flag byte precedes each 8 items; a clear bit
+ *  is a literal byte, a set bit is a match of two bytes, 12 bits
+ *  of distance (less 1) & 4 bits of length (less 3); length
+ *  code 15 means an extra byte of length follows.
+ *   Created: 2026/10
+ *===========================================================*/
+
+#include "sys_inc.h"
+#include "llstdlib.h"
+#include "btreei.h"
+
+/*********************************************
+ * local types
+ *********************************************/
+
+/* method byte of packed record */
+#define PK_STORED 0   /* record follows as is */
+#define PK_LZSS   1   /* LZSS encoding of record follows */
+/* method byte & original length */
+#define PK_HDRLEN (1 + (INT)sizeof(INT))
+
+#define PK_MAXDIST 4096   /* farthest match */
+#define PK_MINMATCH 3     /* shortest match */
+#define PK_MAXMATCH (PK_MINMATCH + 15 + 255) /* longest match */
+#define PK_HASHSIZE 4096  /* heads of match chains */
+#define PK_MAXCHAIN 32    /* candidates tried per position */
+
+/*********************************************
+ * local function prototypes
+ *********************************************/
+
+/* alphabetical */
+static INT encode(CNSTRING in, INT len, STRING out);
+static INT hash3(const unsigned char *p);
+
+/*********************************************
+ * local variables
+ *********************************************/
+
+/* common GEDCOM text (in LifeLines records) that matches may use */
+static const char dict[] =
+	"0 @S1@ SOUR\n1 TITL 1 AUTH 1 PUBL 1 REPO @R"
+	"0 @E1@ EVEN\n0 @X1@ NOTE\n1 CONT 1 CONC 2 CONT 2 CONC "
+	"0 @F1@ FAM\n1 HUSB @I1 WIFE @I1 CHIL @I1 MARR\n2 DATE "
+	"1 DIV\n1 ENGA\n1 NCHI "
+	"1 SEX F\n1 SEX M\n1 FAMC @F1 FAMS @F1 RESI\n1 OCCU 1 RELI "
+	"1 EDUC 1 CHR\n1 BAPM\n1 CONF\n1 NATU 1 EMIG\n1 IMMI\n1 CENS\n"
+	"1 PROB\n1 WILL\n1 GRAD\n1 RETI\n1 ADOP\n"
+	"1 CHAN\n2 DATE 3 TIME 1 REFN 1 NOTE @N1 OBJE\n2 FILE 2 FORM "
+	"2 NOTE 2 SOUR @S1@\n3 PAGE 3 DATA\n3 QUAY 2 ADDR 2 AGE 2 CAUS "
+	"2 TYPE 2 PLAC 2 PLAC , County, , USA\n"
+	"ABT BEF AFT BET AND EST CAL FROM TO "
+	"JAN 1FEB 1MAR 1APR 1MAY 1JUN 1JUL 1AUG 1SEP 1OCT 1NOV 1DEC 1"
+	"1 DEAT\n2 DATE 1 BURI\n2 DATE 1 BIRT\n2 DATE "
+	"0 @I1@ INDI\n1 NAME /\n";
+#define PK_DICTLEN ((INT)sizeof(dict) - 1)
+
+/*********************************************
+ * local & exported function definitions
+ * body of module
+ *********************************************/
+
+/*=================================
+ * bt_setcompress -- Choose format of data blocks
+ *  btree: [IN]  btree handle
+ *  pack:  [IN]  write compressed blocks (BTPACKTYPE) ?
+ * Called by client after open, eg, from BtreeCompress option.
+ * A block in the other format is converted when a record is next
+ *  added to it (see bt_addrecord), & both are always readable
+ *===============================*/
+void
+bt_setcompress (BTREE btree, BOOLEAN pack)
+{
+	bpack(btree) = pack;
+}
+
+/*=================================
+ * packrecord -- Compress record for compressed data block
+ *  rec:   [IN]  record data
+ *  len:   [IN]  length of record
+ *  plen:  [OUT] length of packed record
+ * returns new buffer (caller frees); an empty record stays
+ *  empty, & one that does not shrink is stored as it is
+ *===============================*/
+STRING
+packrecord (CNSTRING rec, INT len, INT *plen)
+{
+	/* encode gives up before it overruns this */
+	STRING out = (STRING) stdalloc(PK_HDRLEN + len + len/8 + 2);
+	INT n;
+
+	*plen = 0;
+	if (!len)
+		return out;
+	memcpy(out + 1, &len, sizeof(INT));
+	n = encode(rec, len, out + PK_HDRLEN);
+	if (n < len) {
+		out[0] = PK_LZSS;
+	} else {
+		out[0] = PK_STORED;
+		memcpy(out + PK_HDRLEN, rec, len);
+		n = len;
+	}
+	*plen = PK_HDRLEN + n;
+	return out;
+}
+/*=================================
+ * unpackedlen -- Original length of packed record
+ *  data:  [IN]  packed record
+ *  len:   [IN]  length of packed record
+ *===============================*/
+INT
+unpackedlen (CNSTRING data, INT len)
+{
+	INT n;
+	if (!len)
+		return 0;
+	if (len < PK_HDRLEN)
+		FATAL2("Corrupt compressed btree record (too short)");
+	memcpy(&n, data + 1, sizeof(INT));
+	return n;
+}
+/*=================================
+ * unpackrecord -- Decompress packed record
+ *  data:  [IN]  packed record
+ *  len:   [IN]  length of packed record
+ *  out:   [OUT] buffer for record (of unpackedlen bytes)
+ * Damaged data is fatal, rather than being allowed to
+ *  overrun the buffer
+ *===============================*/
+void
+unpackrecord (CNSTRING data, INT len, STRING out)
+{
+	const unsigned char *in = (const unsigned char *)data + PK_HDRLEN;
+	const unsigned char *end = (const unsigned char *)data + len;
+	INT olen = unpackedlen(data, len), o = 0, dist, mlen, from;
+	unsigned int flags = 0;
+
+	if (!len)
+		return;
+	if (data[0] == PK_STORED) {
+		if (len - PK_HDRLEN != olen)
+			FATAL2("Corrupt compressed btree record (bad length)");
+		memcpy(out, in, olen);
+		return;
+	}
+	if (data[0] != PK_LZSS)
+		FATAL2("Corrupt compressed btree record (bad method)");
+	while (o < olen) {
+		/* high bit marks the 8 items of a flag byte */
+		if (!(flags & 0x100)) {
+			if (in >= end) goto corrupt;
+			flags = *in++ | 0xff00;
+		}
+		if (!(flags & 1)) {
+			if (in >= end) goto corrupt;
+			out[o++] = *in++;
+		} else {
+			if (in + 2 > end) goto corrupt;
+			dist = ((in[0] << 4) | (in[1] >> 4)) + 1;
+			mlen = (in[1] & 0x0f) + PK_MINMATCH;
+			in += 2;
+			if (mlen == PK_MINMATCH + 15) {
+				if (in >= end) goto corrupt;
+				mlen += *in++;
+			}
+			if (dist > o + PK_DICTLEN || o + mlen > olen)
+				goto corrupt;
+			/* copy bytewise, as match may overlap itself */
+			for (from = o - dist; mlen > 0; --mlen, ++from) {
+				out[o++] = (from < 0) ? dict[PK_DICTLEN + from] : out[from];
+			}
+		}
+		flags >>= 1;
+	}
+	return;
+
+corrupt:
+	FATAL2("Corrupt compressed btree record");
+}
+/*=================================
+ * encode -- LZSS encoding of record
+ *  in:    [IN]  record
+ *  len:   [IN]  length of record
+ *  out:   [OUT] encoding (room for len + len/8 + 1 bytes)
+ * returns length of encoding, or len if it does not shrink
+ *  (in which case out holds rubbish)
+ *===============================*/
+static INT
+encode (CNSTRING in, INT len, STRING out)
+{
+	INT total = PK_DICTLEN + len, pos, cand, best, bestdist, n, i, h;
+	unsigned char *buf = (unsigned char *) stdalloc(total + 1);
+	INT *head = (INT *) stdalloc(PK_HASHSIZE * sizeof(INT));
+	INT *prev = (INT *) stdalloc(total * sizeof(INT));
+	INT o = 0, flagpos = 0, nitems = 8, chain;
+
+	/* dictionary is searched as if it came just before record */
+	memcpy(buf, dict, PK_DICTLEN);
+	memcpy(buf + PK_DICTLEN, in, len);
+	for (i = 0; i < PK_HASHSIZE; ++i)
+		head[i] = -1;
+	for (pos = 0; pos + PK_MINMATCH <= PK_DICTLEN; ++pos) {
+		h = hash3(buf + pos);
+		prev[pos] = head[h];
+		head[h] = pos;
+	}
+	pos = PK_DICTLEN;
+	while (pos < total) {
+		if (o >= len)
+			break; /* not worth it */
+		if (nitems == 8) {
+			flagpos = o++;
+			out[flagpos] = 0;
+			nitems = 0;
+		}
+		best = 0;
+		bestdist = 0;
+		if (pos + PK_MINMATCH <= total) {
+			h = hash3(buf + pos);
+			for (cand = head[h], chain = 0
+				; cand >= 0 && pos - cand <= PK_MAXDIST && chain < PK_MAXCHAIN
+				; cand = prev[cand], ++chain) {
+				for (n = 0; n < PK_MAXMATCH && pos + n < total
+					&& buf[cand + n] == buf[pos + n]; ++n)
+					;
+				if (n > best) {
+					best = n;
+					bestdist = pos - cand;
+					if (n == PK_MAXMATCH) break;
+				}
+			}
+		}
+		if (best >= PK_MINMATCH) {
+			out[flagpos] |= (1 << nitems);
+			out[o++] = (char)((bestdist - 1) >> 4);
+			if (best - PK_MINMATCH >= 15) {
+				out[o++] = (char)((((bestdist - 1) & 0x0f) << 4) | 15);
+				out[o++] = (char)(best - PK_MINMATCH - 15);
+			} else {
+				out[o++] = (char)((((bestdist - 1) & 0x0f) << 4) | (best - PK_MINMATCH));
+			}
+		} else {
+			best = 1;
+			out[o++] = buf[pos];
+		}
+		++nitems;
+		/* all positions covered go into match chains */
+		for (n = 0; n < best; ++n, ++pos) {
+			if (pos + PK_MINMATCH <= total) {
+				h = hash3(buf + pos);
+				prev[pos] = head[h];
+				head[h] = pos;
+			}
+		}
+	}
+	stdfree(prev);
+	stdfree(head);
+	stdfree(buf);
+	return (pos < total || o >= len) ? len : o;
+}
+/*=================================
+ * hash3 -- Hash of 3 bytes (start of possible match)
+ *===============================*/
+static INT
+hash3 (const unsigned char *p)
+{
+	return ((p[0] << 8) ^ (p[1] << 4) ^ p[2]) & (PK_HASHSIZE - 1);
+}
@@ -0,0 +1,264 @@
+/*
+   Copyright (c) 2026 The LifeLines developers
+   "The MIT license"
+   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+/*=============================================================
+ * cursor.c -- Cursor over a range of BTREE records
+ *  Each data block is read with one sequential read of its
+ *  whole file, and records are handed out in place from
+ *  that buffer, in key order. The path of indices down to
+ *  the current block is kept (by FKEY, so the index cache
+ *  may drop them meanwhile) to find the next block.
+ *  Records of a batch not yet checkpointed (see wal.c) are
+ *  merged in from a copy taken when the cursor is opened.
+ *   Created: 2026/10
+ *===========================================================*/
+
+#include "sys_inc.h"
+#include "llstdlib.h"
+#include "btreei.h"
+
+/*********************************************
+ * local types
+ *********************************************/
+
+struct tag_btcursor {
+	BTREE   c_btree;    /* btree being scanned */
+	RKEY    c_lo;       /* records must be above this (if set) */
+	RKEY    c_hi;       /* records must not be above this (if set) */
+	INT     c_depth;    /* levels of index above current block */
+	FKEY    c_ixkeys[BTMAXLEVELS]; /* index at each level */
+	INT     c_ixpos[BTMAXLEVELS];  /* child of it being scanned */
+	BLOCK   c_block;    /* copy of header of current block */
+	STRING  c_data;     /* record data of current block */
+	INT     c_pos;      /* next record of current block */
+	STRING  c_term;     /* where zero follows record handed out */
+	char    c_saved;    /* byte the zero replaced */
+	STRING  c_rec;      /* record handed out (if block is packed) */
+	BOOLEAN c_done;     /* no more blocks ? */
+	ADDREC *c_pend;     /* records pending checkpoint, in range */
+	INT     c_npend;    /* number of them */
+	INT     c_ipend;    /* next of them */
+};
+
+/*********************************************
+ * local function prototypes
+ *********************************************/
+
+/* alphabetical */
+static void descend(BTCURSOR cursor, FKEY fkey, BOOLEAN first);
+static void dropblock(BTCURSOR cursor);
+static void nextblock(BTCURSOR cursor);
+
+/*********************************************
+ * local & exported function definitions
+ * body of module
+ *********************************************/
+
+/*=================================
+ * bt_cursor_open -- Start scan of range of records
+ *  btree:  [in] btree
+ *  lo:     [in] scan records with keys above this
+ *  hi:     [in] and not above this
+ *  (either lo or hi can have 0 as its first character,
+ *   which means unspecified)
+ * NB: This covers all records, including DELE records.
+ *===============================*/
+BTCURSOR
+bt_cursor_open (BTREE btree, RKEY lo, RKEY hi)
+{
+	BTCURSOR cursor = (BTCURSOR) stdalloc(sizeof(*cursor));
+	memset(cursor, 0, sizeof(*cursor));
+	cursor->c_btree = btree;
+	cursor->c_lo = lo;
+	cursor->c_hi = hi;
+	/* records still in write-ahead log must be visible too, but
+	 checkpointing them here would commit part of an open batch */
+	cursor->c_pend = walpending(btree, &lo, &hi, &cursor->c_npend);
+	descend(cursor, ixself(bmaster(btree)), TRUE);
+	return cursor;
+}
+/*=================================
+ * bt_cursor_next -- Get next record of scan
+ *  cursor: [in]  cursor from bt_cursor_open
+ *  prkey:  [out] key of record
+ *  prec:   [out] record data (NULL if length is 0)
+ *  plen:   [out] length of record
+ * returns FALSE when there are no more records
+ * Record data stays in the cursor, & is only valid until
+ * the next call; it is followed by a zero, and may be
+ * modified in place (eg, by string_to_node)
+ * Records of compressed blocks are unpacked one at a time
+ *===============================*/
+BOOLEAN
+bt_cursor_next (BTCURSOR cursor, RKEY *prkey, STRING *prec, INT *plen)
+{
+	BLOCK block = NULL;
+	ADDREC *pend;
+	INT i = 0, rel = 1;
+
+	if (cursor->c_term) {
+		*cursor->c_term = cursor->c_saved;
+		cursor->c_term = NULL;
+	}
+	if (cursor->c_rec) {
+		stdfree(cursor->c_rec);
+		cursor->c_rec = NULL;
+	}
+	/* find next record of blocks in range (not yet taken) */
+	while (!cursor->c_done) {
+		block = cursor->c_block;
+		if (!block || cursor->c_pos >= nkeys(block)) {
+			nextblock(cursor);
+			continue;
+		}
+		i = cursor->c_pos;
+		if (cursor->c_lo.r_rkey[0]
+			&& cmpkeys(&cursor->c_lo, &rkeys(block, i)) >= 0) {
+			cursor->c_pos++;
+			continue;
+		}
+		if (cursor->c_hi.r_rkey[0]
+			&& cmpkeys(&cursor->c_hi, &rkeys(block, i)) < 0) {
+			cursor->c_done = TRUE;
+			break;
+		}
+		break;
+	}
+	/* pending record comes first, & replaces block's version */
+	if (cursor->c_ipend < cursor->c_npend) {
+		pend = &cursor->c_pend[cursor->c_ipend];
+		if (!cursor->c_done)
+			rel = cmpkeys(&pend->a_rkey, &rkeys(block, i));
+		if (cursor->c_done || rel <= 0) {
+			if (!rel)
+				cursor->c_pos++;
+			cursor->c_ipend++;
+			*prkey = pend->a_rkey;
+			*plen = pend->a_len;
+			*prec = pend->a_len ? (STRING) pend->a_rec : NULL;
+			return TRUE;
+		}
+	}
+	if (cursor->c_done) {
+		dropblock(cursor);
+		return FALSE;
+	}
+	cursor->c_pos++;
+	*prkey = rkeys(block, i);
+	*plen = lens(block, i);
+	*prec = NULL;
+	if (lens(block, i) && ixtype(block) == BTPACKTYPE) {
+		*plen = unpackedlen(cursor->c_data + offs(block, i), lens(block, i));
+		cursor->c_rec = (STRING) stdalloc(*plen + 1);
+		unpackrecord(cursor->c_data + offs(block, i), lens(block, i)
+			, cursor->c_rec);
+		cursor->c_rec[*plen] = 0;
+		*prec = cursor->c_rec;
+	} else if (lens(block, i)) {
+		*prec = cursor->c_data + offs(block, i);
+		cursor->c_term = *prec + lens(block, i);
+		cursor->c_saved = *cursor->c_term;
+		*cursor->c_term = 0;
+	}
+	return TRUE;
+}
+/*=================================
+ * bt_cursor_close -- Finish scan & free cursor
+ *===============================*/
+void
+bt_cursor_close (BTCURSOR cursor)
+{
+	INT i;
+	dropblock(cursor);
+	for (i = 0; i < cursor->c_npend; ++i)
+		stdfree((STRING) cursor->c_pend[i].a_rec);
+	if (cursor->c_pend)
+		stdfree(cursor->c_pend);
+	stdfree(cursor);
+}
+/*=================================
+ * descend -- Go down from index (or block) to a data block
+ *  cursor: [in] cursor
+ *  fkey:   [in] index or block to start from
+ *  first:  [in] first descent (go to block that may hold lo) ?
+ *           otherwise, go to leftmost block
+ *===============================*/
+static void
+descend (BTCURSOR cursor, FKEY fkey, BOOLEAN first)
+{
+	BTREE btree = cursor->c_btree;
+	INT copy[BTMAXPAGELEN/sizeof(INT)]; /* header, if btree is shared */
+	INDEX index = viewindex(btree, fkey, (INDEX)copy);
+	INT i;
+
+	while (ixtype(index) == BTINDEXTYPE) {
+		i = 0;
+		if (first && cursor->c_lo.r_rkey[0])
+			i = childslot(index, &cursor->c_lo);
+		ASSERT(cursor->c_depth < BTMAXLEVELS);
+		cursor->c_ixkeys[cursor->c_depth] = ixself(index);
+		cursor->c_ixpos[cursor->c_depth] = i;
+		++cursor->c_depth;
+		index = viewindex(btree, fkeys(index, i), (INDEX)copy);
+	}
+	ASSERT(ixtype(index) != BTINDEXTYPE);
+	/* copy header, lest index cache drop it */
+	cursor->c_block = allocblock();
+	memcpy(cursor->c_block, index, PAGELEN);
+	cursor->c_data = readblockdata(btree, cursor->c_block);
+	cursor->c_pos = 0;
+}
+/*=================================
+ * nextblock -- Move cursor to next data block
+ *  (or set c_done if there is none in range)
+ *===============================*/
+static void
+nextblock (BTCURSOR cursor)
+{
+	INDEX index;
+	INT level, pos;
+	INT copy[BTMAXPAGELEN/sizeof(INT)]; /* header, if btree is shared */
+
+	dropblock(cursor);
+	while (cursor->c_depth > 0) {
+		level = cursor->c_depth - 1;
+		index = viewindex(cursor->c_btree, cursor->c_ixkeys[level]
+			, (INDEX)copy);
+		ASSERT(ixtype(index) == BTINDEXTYPE);
+		if (cursor->c_ixpos[level] < nkeys(index)) {
+			pos = ++cursor->c_ixpos[level];
+			/* rest of this index is all above hi */
+			if (cursor->c_hi.r_rkey[0]
+				&& cmpkeys(&cursor->c_hi, &rkeys(index, pos)) < 0)
+				break;
+			descend(cursor, fkeys(index, pos), FALSE);
+			return;
+		}
+		--cursor->c_depth;
+	}
+	cursor->c_done = TRUE;
+}
+/*=================================
+ * dropblock -- Free current block of cursor
+ *===============================*/
+static void
+dropblock (BTCURSOR cursor)
+{
+	if (cursor->c_block) {
+		stdfree(cursor->c_block);
+		cursor->c_block = NULL;
+	}
+	if (cursor->c_data) {
+		stdfree(cursor->c_data);
+		cursor->c_data = NULL;
+	}
+	if (cursor->c_rec) {
+		stdfree(cursor->c_rec);
+		cursor->c_rec = NULL;
+	}
+	cursor->c_term = NULL;
+}
@@ -0,0 +1,336 @@
+/*
+   Copyright (c) 2026 The LifeLines developers
+   "The MIT license"
+   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+/*=============================================================
+ * fdcache.c -- Cache of open BTREE file descriptors
+ *  Index and block files are kept open (most recently used
+ *  first) and accessed with pread/pwrite, so that each record
+ *  read or index write does not cost an open and a close.
+ *  Descriptors must be dropped (closefilefd) whenever the file
+ *  behind them is replaced (see movefiles in btrec.c).
+ *   Created: 2026/10
+ *===========================================================*/
+
+#include <errno.h>
+#include "sys_inc.h"
+#include "llstdlib.h"
+#include "btreei.h"
+
+#if defined(HAVE_PREAD) && defined(HAVE_PWRITE)
+#define USE_FDCACHE 1
+#include <fcntl.h>
+#endif
+
+/*********************************************
+ * local types
+ *********************************************/
+
+typedef struct tag_fdentry {
+	FKEY   f_fkey;   /* file opened */
+	int    f_fd;     /* descriptor */
+	struct tag_fdentry *f_next; /* next most recently used */
+} *FDENTRY;
+
+struct tag_fdcache {
+	INT     fc_max;   /* max descriptors held open */
+	INT     fc_count; /* descriptors currently open */
+	FDENTRY fc_first; /* most recently used */
+};
+
+/*********************************************
+ * local function prototypes
+ *********************************************/
+
+/* alphabetical */
+#ifdef USE_FDCACHE
+static void closeentry(FDENTRY entry);
+#endif
+
+/*********************************************
+ * local & exported function definitions
+ * body of module
+ *********************************************/
+
+/*==============================================
+ * initfdcache -- Set up descriptor cache for btree
+ *  btree: [IN]  btree handle
+ *  n:     [IN]  max number of files to keep open
+ * Does nothing where pread/pwrite are not available, if n is 0,
+ *  or for a paged btree (which has just the one file open)
+ *============================================*/
+void
+initfdcache (BTREE btree, INT n)
+{
+	bfdcache(btree) = NULL;
+	if (bpagefile(btree)) return;
+	bfdcache(btree) = newfdcache(n);
+}
+/*==============================================
+ * newfdcache -- Create (empty) descriptor cache
+ *  n:     [IN]  max number of files to keep open
+ * returns NULL where pread/pwrite are not available, or if n is 0
+ * Used by initfdcache, & for each shard of a shared btree
+ *============================================*/
+FDCACHE
+newfdcache (INT n)
+{
+	FDCACHE fc=0;
+#ifdef USE_FDCACHE
+	if (n <= 0) return NULL;
+	fc = (FDCACHE) stdalloc(sizeof(*fc));
+	fc->fc_max = n;
+	fc->fc_count = 0;
+	fc->fc_first = NULL;
+#else
+	n=n; /* unused */
+#endif
+	return fc;
+}
+/*=============================================
+ * freefdcache -- Close all cached descriptors
+ *  btree: [IN]  btree handle
+ *===========================================*/
+void
+freefdcache (BTREE btree)
+{
+	if (!bfdcache(btree)) return;
+	dropfdcache(bfdcache(btree));
+	bfdcache(btree) = NULL;
+}
+/*=============================================
+ * dropfdcache -- Close all descriptors of cache & free it
+ *===========================================*/
+void
+dropfdcache (FDCACHE fc)
+{
+#ifdef USE_FDCACHE
+	while (fc->fc_first) {
+		FDENTRY entry = fc->fc_first;
+		fc->fc_first = entry->f_next;
+		closeentry(entry);
+	}
+#endif
+	stdfree(fc);
+}
+/*=============================================
+ * bt_setfilecache -- Change number of btree files kept open
+ *  btree: [IN]  btree handle
+ *  n:     [IN]  max number of files to keep open (0 to disable)
+ * Called by client after open, eg, from BtreeFileCache option
+ *===========================================*/
+void
+bt_setfilecache (BTREE btree, INT n)
+{
+	freefdcache(btree);
+	initfdcache(btree, n);
+}
+/*=============================================
+ * getfilefd -- Find (or open) descriptor for btree file
+ *  btree:  [IN]  btree handle
+ *  fkey:   [IN]  file desired (index or block)
+ *  create: [IN]  create file if it does not exist ?
+ * returns descriptor (owned by cache), or -1 if not available
+ *  (caller falls back to stdio in that case)
+ * Descriptor is valid until the next call into this module
+ *===========================================*/
+int
+getfilefd (BTREE btree, FKEY fkey, BOOLEAN create)
+{
+	return cachedfd(bfdcache(btree), btree, fkey, create);
+}
+/*=============================================
+ * cachedfd -- Find (or open) descriptor in given cache
+ *  fc:     [IN]  descriptor cache (may be NULL)
+ *  btree:  [IN]  btree handle
+ *  fkey:   [IN]  file desired (index or block)
+ *  create: [IN]  create file if it does not exist ?
+ * (see getfilefd)
+ *===========================================*/
+int
+cachedfd (FDCACHE fc, BTREE btree, FKEY fkey, BOOLEAN create)
+{
+#ifdef USE_FDCACHE
+	char scratch[MAXPATHLEN], path[6];
+	FDENTRY entry, prev=NULL;
+	int fd, flags;
+	if (!fc) return -1;
+	/* look for it, moving it to front if found */
+	for (entry = fc->fc_first; entry; prev = entry, entry = entry->f_next) {
+		if (entry->f_fkey == fkey) {
+			if (prev) {
+				prev->f_next = entry->f_next;
+				entry->f_next = fc->fc_first;
+				fc->fc_first = entry;
+			}
+			return entry->f_fd;
+		}
+	}
+	snprintf(scratch, sizeof(scratch)
+		, "%s%c%s"
+		, bbasedir(btree), LLCHRDIRSEPARATOR, fkeypath(fkey, path));
+	flags = bwrite(btree) ? O_RDWR : O_RDONLY;
+	if (create && bwrite(btree))
+		flags |= O_CREAT;
+#ifdef O_BINARY
+	flags |= O_BINARY;
+#endif
+	if ((fd = open(scratch, flags, 0666)) < 0)
+		return -1;
+	btcount(btree, c_opens, 1);
+	/* close least recently used descriptor if full */
+	if (fc->fc_count >= fc->fc_max) {
+		FDENTRY last = fc->fc_first;
+		prev = NULL;
+		while (last->f_next) {
+			prev = last;
+			last = last->f_next;
+		}
+		if (prev)
+			prev->f_next = NULL;
+		else
+			fc->fc_first = NULL;
+		closeentry(last);
+		--fc->fc_count;
+	}
+	entry = (FDENTRY) stdalloc(sizeof(*entry));
+	entry->f_fkey = fkey;
+	entry->f_fd = fd;
+	entry->f_next = fc->fc_first;
+	fc->fc_first = entry;
+	++fc->fc_count;
+	return fd;
+#else
+	fc=fc; /* unused */
+	btree=btree; /* unused */
+	fkey=fkey; /* unused */
+	create=create; /* unused */
+	return -1;
+#endif
+}
+/*=============================================
+ * closefilefd -- Close any cached descriptor of specified file
+ *  (eg, because it is about to be replaced on disk)
+ *  btree: [IN]  btree handle
+ *  fkey:  [IN]  file
+ *===========================================*/
+void
+closefilefd (BTREE btree, FKEY fkey)
+{
+#ifdef USE_FDCACHE
+	FDCACHE fc = bfdcache(btree);
+	FDENTRY entry, prev=NULL;
+	if (!fc) return;
+	for (entry = fc->fc_first; entry; prev = entry, entry = entry->f_next) {
+		if (entry->f_fkey == fkey) {
+			if (prev)
+				prev->f_next = entry->f_next;
+			else
+				fc->fc_first = entry->f_next;
+			closeentry(entry);
+			--fc->fc_count;
+			return;
+		}
+	}
+#else
+	btree=btree; /* unused */
+	fkey=fkey; /* unused */
+#endif
+}
+/*=============================================
+ * syncfilefds -- Force all cached files through to disk
+ *  (or the single paged file, for a paged btree)
+ *  btree: [IN]  btree handle
+ *===========================================*/
+void
+syncfilefds (BTREE btree)
+{
+#ifdef USE_FDCACHE
+	FDCACHE fc = bfdcache(btree);
+	FDENTRY entry;
+#endif
+	if (bpagefile(btree)) {
+		syncpagefile(bpagefile(btree));
+		return;
+	}
+#ifdef USE_FDCACHE
+	if (!fc) return;
+	for (entry = fc->fc_first; entry; entry = entry->f_next) {
+#ifdef HAVE_FSYNC
+		fsync(entry->f_fd);
+#endif
+	}
+#endif
+}
+/*=============================================
+ * readfilefd -- Read exactly len bytes at offset
+ *  fd:   [IN]  descriptor from getfilefd
+ *  buf:  [OUT] destination
+ *  len:  [IN]  bytes wanted
+ *  off:  [IN]  file offset
+ * returns FALSE on error or short file
+ *===========================================*/
+BOOLEAN
+readfilefd (int fd, void *buf, INT len, INT off)
+{
+#ifdef USE_FDCACHE
+	char *p = (char *)buf;
+	while (len > 0) {
+		ssize_t got = pread(fd, p, (size_t)len, (off_t)off);
+		if (got <= 0) {
+			if (got < 0 && errno == EINTR) continue;
+			return FALSE;
+		}
+		p += got;
+		off += (INT)got;
+		len -= (INT)got;
+	}
+	return TRUE;
+#else
+	fd=fd; buf=buf; len=len; off=off; /* unused */
+	return FALSE;
+#endif
+}
+/*=============================================
+ * writefilefd -- Write exactly len bytes at offset
+ *  fd:   [IN]  descriptor from getfilefd
+ *  buf:  [IN]  source
+ *  len:  [IN]  bytes to write
+ *  off:  [IN]  file offset
+ * returns FALSE on error
+ *===========================================*/
+BOOLEAN
+writefilefd (int fd, const void *buf, INT len, INT off)
+{
+#ifdef USE_FDCACHE
+	const char *p = (const char *)buf;
+	while (len > 0) {
+		ssize_t put = pwrite(fd, p, (size_t)len, (off_t)off);
+		if (put <= 0) {
+			if (put < 0 && errno == EINTR) continue;
+			return FALSE;
+		}
+		p += put;
+		off += (INT)put;
+		len -= (INT)put;
+	}
+	return TRUE;
+#else
+	fd=fd; buf=buf; len=len; off=off; /* unused */
+	return FALSE;
+#endif
+}
+#ifdef USE_FDCACHE
+/*=============================================
+ * closeentry -- Close & free one entry
+ *===========================================*/
+static void
+closeentry (FDENTRY entry)
+{
+	close(entry->f_fd);
+	stdfree(entry);
+}
+#endif /* USE_FDCACHE */
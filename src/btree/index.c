@@ -32,8 +32,49 @@
 #include "llstdlib.h"
 #include "btreei.h"
 
-static INT incache (BTREE, FKEY);
+/*********************************************
+ * local types
+ *********************************************/
+
+/* one cached INDEX or BLOCK header, on both hash chain & LRU list */
+typedef struct tag_icentry {
+	FKEY   e_fkey;   /* file key of cached index */
+	INDEX  e_index;  /* cached index (or block header) */
+	INT    e_pins;   /* holders who need it kept (see pinindex) */
+	struct tag_icentry *e_hnext; /* next in hash chain */
+	struct tag_icentry *e_prev;  /* more recently used */
+	struct tag_icentry *e_next;  /* less recently used */
+} *ICENTRY;
+
+struct tag_indexcache {
+	INT     ic_max;      /* max entries (from byte budget) */
+	INT     ic_count;    /* entries currently cached */
+	INT     ic_nbuckets; /* size of hash table (power of 2) */
+	ICENTRY *ic_buckets; /* hash table */
+	ICENTRY ic_first;    /* most recently used */
+	ICENTRY ic_last;     /* least recently used */
+};
+
+/* fewest entries cache will hold regardless of budget */
+#define ICMINENTRIES 1
+/* initial hash table size (must be power of 2) */
+#define ICMINBUCKETS 64
+
+/*********************************************
+ * local function prototypes
+ *********************************************/
+
 static BOOLEAN cacheindex (BTREE, INDEX);
+static void dropentry (INDEXCACHE, ICENTRY);
+static ICENTRY findentry (INDEXCACHE, FKEY);
+static void growbuckets (INDEXCACHE);
+static INT ichash (INDEXCACHE, FKEY);
+static ICENTRY incache (BTREE, FKEY);
+static void insertentry (INDEXCACHE, INDEX);
+static ICENTRY lruentry (INDEXCACHE);
+static INDEX readversion (BTREE, FKEY, STRING, BOOLEAN);
+static void setcachemax (INDEXCACHE, INT bytes);
+static void touchentry (INDEXCACHE, ICENTRY);
 
 /*======================================
  * crtindex - Create new index for btree
@@ -43,7 +84,7 @@ crtindex (BTREE btree)
 {
 	INDEX index;
 	ASSERT(bwrite(btree) == 1);
-	index = (INDEX) stdalloc(BUFLEN);
+	index = (INDEX) stdalloc(PAGELEN);
 	nkeys(index) = 0;
 	ixparent(index) = 0;
 	ixtype(index) = BTINDEXTYPE;
@@ -82,7 +123,44 @@ readindex (BTREE btr, FKEY ikey, BOOLEAN robust)
 	FILE *fi=NULL;
 	INDEX index=NULL;
 	char scratch[400];
+	CNSTRING mapped;
+	INT maplen;
+	int fd;
+	if (bpagefile(btr)) {
+		index = (INDEX) stdalloc(PAGELEN);
+		if (readpages(bpagefile(btr), ikey, index, PAGELEN, 0)) {
+			btcount(btr, c_bytesread, PAGELEN);
+			return index;
+		}
+		stdfree(index);
+		if (robust)
+			return NULL;
+		sprintf(scratch, "Missing index in paged file: %s", fkey2path(ikey));
+		FATAL2(scratch);
+	}
+	if ((mapped = getmappedfile(btr, ikey, &maplen)) != NULL) {
+		/* getmappedfile only maps files of at least PAGELEN */
+		index = (INDEX) stdalloc(PAGELEN);
+		memcpy(index, mapped, PAGELEN);
+		btcount(btr, c_bytesread, PAGELEN);
+		return index;
+	}
+	if ((fd = getfilefd(btr, ikey, FALSE)) >= 0) {
+		index = (INDEX) stdalloc(PAGELEN);
+		if (readfilefd(fd, index, PAGELEN, 0)) {
+			btcount(btr, c_bytesread, PAGELEN);
+			return index;
+		}
+		if (robust) {
+			stdfree(index);
+			return NULL;
+		}
+		sprintf(scratch, "Undersized (<%d) index file: %s", PAGELEN, fkey2path(ikey));
+		FATAL2(scratch);
+	}
 	get_index_file(scratch, btr, ikey);
+	if (insnapshot(btr))
+		return readversion(btr, ikey, scratch, robust);
 	if ((fi = fopen(scratch, LLREADBINARY LLFILERANDOM)) == NULL) {
 		if (robust) {
 			/* fall to end & return NULL */
@@ -91,18 +169,60 @@ readindex (BTREE btr, FKEY ikey, BOOLEAN robust)
 		sprintf(scratch, "Missing index file: %s", fkey2path(ikey));
 		FATAL2(scratch);
 	}
-	index = (INDEX) stdalloc(BUFLEN);
-	if (fread(index, BUFLEN, 1, fi) != 1) {
+	btcount(btr, c_opens, 1);
+	index = (INDEX) stdalloc(PAGELEN);
+	if (fread(index, PAGELEN, 1, fi) != 1) {
 		if (robust) {
 			goto readindex_end;
 		}
-		sprintf(scratch, "Undersized (<%d) index file: %s", BUFLEN, fkey2path(ikey));
+		sprintf(scratch, "Undersized (<%d) index file: %s", PAGELEN, fkey2path(ikey));
 		FATAL2(scratch);
 	}
+	btcount(btr, c_bytesread, PAGELEN);
 	if (fi) fclose(fi);
 readindex_end:
 	return index;
 }
+/*=================================
+ * readversion - Read index of snapshot from file
+ *  btr:     [IN] btree structure (snapshot reader)
+ *  ikey:    [IN] index file key
+ *  path:    [IN] file of index in btree
+ *  robust:  [IN] return (not abort) on errors ?
+ * Header is written in place, so look for a version only after
+ *  reading it (see snapshot.c)
+ *===============================*/
+static INDEX
+readversion (BTREE btr, FKEY ikey, STRING path, BOOLEAN robust)
+{
+	INDEX index = (INDEX) stdalloc(PAGELEN);
+	char scratch[MAXPATHLEN];
+	BOOLEAN ok = FALSE;
+	FILE *fi;
+
+	if ((fi = fopen(path, LLREADBINARY LLFILERANDOM)) != NULL) {
+		ok = fread(index, PAGELEN, 1, fi) == 1;
+		fclose(fi);
+	}
+	if (snapfile(btr, ikey, scratch, sizeof(scratch))) {
+		ok = FALSE;
+		if ((fi = fopen(scratch, LLREADBINARY LLFILERANDOM)) != NULL) {
+			ok = fread(index, PAGELEN, 1, fi) == 1;
+			fclose(fi);
+		}
+	}
+	btcount(btr, c_opens, 1);
+	if (ok) {
+		btcount(btr, c_bytesread, PAGELEN);
+		return index;
+	}
+	stdfree(index);
+	if (robust)
+		return NULL;
+	sprintf(scratch, "Missing index file in snapshot: %s", fkey2path(ikey));
+	FATAL2(scratch);
+	return NULL;
+}
 /*=================================
  * writeindex - Write index to file
  *  btr:      [IN]  btree structure
@@ -113,12 +233,28 @@ writeindex (BTREE btr, INDEX index)
 {
 	FILE *fi=NULL;
 	char scratch[400];
+	int fd;
+	btcount(btr, c_byteswritten, PAGELEN);
+	if (bpagefile(btr)) {
+		writepages(bpagefile(btr), ixself(index), index, PAGELEN, 0);
+		return;
+	}
+	keepversion(btr, ixself(index), TRUE);
+	if ((fd = getfilefd(btr, ixself(index), TRUE)) >= 0) {
+		/* index files are always exactly PAGELEN, so overwrite in place */
+		if (!writefilefd(fd, index, PAGELEN, 0)) {
+			sprintf(scratch, "Error writing index file: %s", fkey2path(ixself(index)));
+			FATAL2(scratch);
+		}
+		return;
+	}
 	get_index_file(scratch, btr, ixself(index));
 	if ((fi = fopen(scratch, LLWRITEBINARY LLFILERANDOM)) == NULL) {
 		sprintf(scratch, "Error opening index file: %s", fkey2path(ixself(index)));
 		FATAL2(scratch);
 	}
-	if (fwrite(index, BUFLEN, 1, fi) != 1) {
+	btcount(btr, c_opens, 1);
+	if (fwrite(index, PAGELEN, 1, fi) != 1) {
 		sprintf(scratch, "Error writing index file: %s", fkey2path(ixself(index)));
 		FATAL2(scratch);
 	}
@@ -126,17 +262,63 @@ writeindex (BTREE btr, INDEX index)
 }
 /*==============================================
  * initcache -- Initialize index cache for btree
+ *  btree: [IN]  btree handle
+ *  bytes: [IN]  memory budget for cached indices & block headers
+ * Lookup is by hash on FKEY, and eviction is least recently used
  *============================================*/
 void
-initcache (BTREE btree, /* btree handle */
-           INT n)       /* num cache blocks to allow */
+initcache (BTREE btree, INT bytes)
 {
-	INT i=0;
-	n = (n < 5) ? 5 : n;
-	bncache(btree) = n;
-	bcache(btree) = (INDEX *) stdalloc(n*sizeof(INDEX));
-	for (i = 0;  i < n;  i++)
-		bcache(btree)[i] = NULL;
+	bcache(btree) = newcache(bytes);
+}
+/*==============================================
+ * newcache -- Create (empty) index cache
+ *  bytes: [IN]  memory budget
+ * Used by initcache, & for each shard of a shared btree
+ *============================================*/
+INDEXCACHE
+newcache (INT bytes)
+{
+	INDEXCACHE ic = (INDEXCACHE) stdalloc(sizeof(*ic));
+	ic->ic_max = 0;
+	ic->ic_count = 0;
+	ic->ic_nbuckets = ICMINBUCKETS;
+	ic->ic_buckets = (ICENTRY *) stdalloc(ICMINBUCKETS*sizeof(ICENTRY));
+	ic->ic_first = ic->ic_last = NULL;
+	setcachemax(ic, bytes);
+	return ic;
+}
+/*==============================================
+ * bt_setcachesize -- Change memory budget of index cache
+ *  btree: [IN]  btree handle
+ *  bytes: [IN]  memory budget
+ * Enough to hold all indices keeps the whole index tree resident
+ *============================================*/
+void
+bt_setcachesize (BTREE btree, INT bytes)
+{
+	setcachemax(bcache(btree), bytes);
+}
+/*==============================================
+ * setcachemax -- Set size of index cache from memory budget
+ *  (dropping least recently used entries if over it)
+ *============================================*/
+static void
+setcachemax (INDEXCACHE ic, INT bytes)
+{
+	INT n = bytes/(PAGELEN + (INT)sizeof(struct tag_icentry));
+	ICENTRY entry;
+	ic->ic_max = (n < ICMINENTRIES) ? ICMINENTRIES : n;
+	while (ic->ic_count > ic->ic_max && (entry = lruentry(ic)))
+		dropentry(ic, entry);
+}
+/*==============================================
+ * cachebytes -- Memory budget of index cache
+ *============================================*/
+INT
+cachebytes (INDEXCACHE ic)
+{
+	return ic->ic_max*(PAGELEN + (INT)sizeof(struct tag_icentry));
 }
 /*========================================
  * freecache -- Free index cache for btree
@@ -144,38 +326,113 @@ initcache (BTREE btree, /* btree handle */
 void
 freecache (BTREE btree)
 {
-	INT i=0;
-	INT n = bncache(btree);
-	for (i=0; i<n; ++i) {
-		if (bcache(btree)[i]) {
-			stdfree(bcache(btree)[i]);
-			bcache(btree)[i] = NULL;
-		}
-	}
-	stdfree(bcache(btree));
+	if (!bcache(btree)) return;
+	dropcache(bcache(btree));
+	bcache(btree) = NULL;
+}
+/*========================================
+ * dropcache -- Free index cache & all it holds
+ *======================================*/
+void
+dropcache (INDEXCACHE ic)
+{
+	while (ic->ic_first)
+		dropentry(ic, ic->ic_first);
+	stdfree(ic->ic_buckets);
+	stdfree(ic);
 }
 /*============================================
  * cacheindex -- Place INDEX or BLOCK in cache
+ *  If already cached, the new copy replaces the old one
+ *  (which is not freed -- caller owns it at that point)
  *==========================================*/
 static BOOLEAN
 cacheindex (BTREE btree, /* btree handle */
             INDEX index) /* INDEX or BLOCK */
 {
-	INT n = bncache(btree);
-	INDEX *indices = bcache(btree);
-	INT j = incache(btree, ixself(index));
-	if (j == -1) {	/* index not in cache */
-		if (indices[n-1]) stdfree(indices[n-1]);
-		for (j = n - 1; j > 0; --j)
-			indices[j] = indices[j - 1];
-		indices[0] = index;
-	} else {	/* index is in cache */
-		for (; j > 0; --j)
-			indices[j] = indices[j - 1];
-		indices[0] = index;
+	INDEXCACHE ic = bcache(btree);
+	ICENTRY entry = incache(btree, ixself(index));
+	/* every header read or changed passes here, so its filter is current */
+	if (ixtype(index) != BTINDEXTYPE)
+		addfilter(btree, (BLOCK) index);
+	if (entry) {
+		entry->e_index = index;
+		touchentry(ic, entry);
+		return TRUE;
 	}
+	insertentry(ic, index);
 	return TRUE;
 }
+/*============================================
+ * insertentry -- Add INDEX or BLOCK (not yet cached) to cache
+ *  making room by dropping least recently used entry
+ *  (cache grows past its budget while all entries are pinned)
+ *==========================================*/
+static void
+insertentry (INDEXCACHE ic, INDEX index)
+{
+	ICENTRY entry;
+	while (ic->ic_count >= ic->ic_max && (entry = lruentry(ic)))
+		dropentry(ic, entry);
+	if (ic->ic_count >= ic->ic_nbuckets)
+		growbuckets(ic);
+	entry = (ICENTRY) stdalloc(sizeof(*entry));
+	entry->e_fkey = ixself(index);
+	entry->e_index = index;
+	entry->e_pins = 0;
+	entry->e_hnext = ic->ic_buckets[ichash(ic, entry->e_fkey)];
+	ic->ic_buckets[ichash(ic, entry->e_fkey)] = entry;
+	entry->e_prev = NULL;
+	entry->e_next = ic->ic_first;
+	if (ic->ic_first)
+		ic->ic_first->e_prev = entry;
+	else
+		ic->ic_last = entry;
+	ic->ic_first = entry;
+	++ic->ic_count;
+}
+/*============================================
+ * lruentry -- Least recently used entry that may be dropped
+ *  (ie, is not pinned), or NULL if none
+ *==========================================*/
+static ICENTRY
+lruentry (INDEXCACHE ic)
+{
+	ICENTRY entry = ic->ic_last;
+	while (entry && entry->e_pins)
+		entry = entry->e_prev;
+	return entry;
+}
+/*============================================
+ * copyfromcache -- Copy cached INDEX or BLOCK out of cache
+ *  ic:    [IN]  cache
+ *  fkey:  [IN]  index or block wanted
+ *  out:   [OUT] copy (PAGELEN bytes)
+ * returns FALSE if not cached
+ * Caller never holds a pointer into cache (see shared.c)
+ *==========================================*/
+BOOLEAN
+copyfromcache (INDEXCACHE ic, FKEY fkey, INDEX out)
+{
+	ICENTRY entry = findentry(ic, fkey);
+	if (!entry) return FALSE;
+	memcpy(out, entry->e_index, PAGELEN);
+	touchentry(ic, entry);
+	return TRUE;
+}
+/*============================================
+ * copytocache -- Put copy of INDEX or BLOCK in cache
+ *  (unless already there)
+ *==========================================*/
+void
+copytocache (INDEXCACHE ic, INDEX index)
+{
+	INDEX copy;
+	if (findentry(ic, ixself(index))) return;
+	copy = (INDEX) stdalloc(PAGELEN);
+	memcpy(copy, index, PAGELEN);
+	insertentry(ic, copy);
+}
 /*================================
  * getindex - Get index from btree
  *  checks cache first to avoid disk read if possible
@@ -185,16 +442,49 @@ cacheindex (BTREE btree, /* btree handle */
 INDEX
 getindex (BTREE btree, FKEY fkey)
 {
-	INT j;
+	ICENTRY entry;
 	INDEX index;
 	if (fkey == ixself(bmaster(btree))) return bmaster(btree);
-	if ((j = incache(btree, fkey)) == -1) {	/* not in cache */
+	if (!(entry = incache(btree, fkey))) {	/* not in cache */
 		BOOLEAN robust = FALSE; /* abort on error */
+		btcount(btree, c_misses, 1);
 		index = readindex(btree, fkey, robust);
 		cacheindex(btree, index);
 		return index;
 	}
-	return (bcache(btree))[j];
+	btcount(btree, c_hits, 1);
+	touchentry(bcache(btree), entry);
+	return entry->e_index;
+}
+/*================================
+ * pinindex -- Get index from btree, & keep it cached
+ *  until unpinindex (pins are counted)
+ *  For a caller that goes on to cache other headers while
+ *  it holds this one
+ *==============================*/
+INDEX
+pinindex (BTREE btree, FKEY fkey)
+{
+	INDEX index = getindex(btree, fkey);
+	ICENTRY entry = incache(btree, fkey);
+	if (entry) /* master is not in cache, & never dropped */
+		++entry->e_pins;
+	return index;
+}
+/*================================
+ * unpinindex -- Release index pinned by pinindex
+ *  (it may be dropped from cache from now on)
+ *==============================*/
+void
+unpinindex (BTREE btree, FKEY fkey)
+{
+	ICENTRY entry = incache(btree, fkey);
+	if (!entry) {
+		ASSERT(fkey == ixself(bmaster(btree)));
+		return;
+	}
+	ASSERT(entry->e_pins > 0);
+	--entry->e_pins;
 }
 /*=====================================
  * putindex -- Put out index - cache it
@@ -216,18 +506,110 @@ putheader (BTREE btree,
 {
 	cacheindex(btree, (INDEX) block);
 }
+/*=================================================
+ * uncacheindex -- Drop (& free) cached copy of INDEX or BLOCK
+ *  whose file is removed from btree, if it is cached
+ *===============================================*/
+void
+uncacheindex (BTREE btree,
+              FKEY fkey)
+{
+	ICENTRY entry = incache(btree, fkey);
+	if (entry) {
+		ASSERT(!entry->e_pins);
+		dropentry(bcache(btree), entry);
+	}
+}
 /*============================================================
- * incache -- If INDEX is in cache return index else return -1
+ * incache -- If INDEX is in cache return its entry else NULL
  *==========================================================*/
-static INT
+static ICENTRY
 incache (BTREE btree,
          FKEY fkey)
 {
-	INT i, n = bncache(btree);
-	INDEX index, *indices = bcache(btree);
-	for (i = 0; i < n; i++) {
-		if ((index = *indices++) == NULL) return -1;
-		if (ixself(index) == fkey) return i;
+	return findentry(bcache(btree), fkey);
+}
+/*============================================================
+ * findentry -- Entry of fkey in index cache, or NULL
+ *==========================================================*/
+static ICENTRY
+findentry (INDEXCACHE ic, FKEY fkey)
+{
+	ICENTRY entry = ic->ic_buckets[ichash(ic, fkey)];
+	while (entry && entry->e_fkey != fkey)
+		entry = entry->e_hnext;
+	return entry;
+}
+/*============================================================
+ * ichash -- Bucket of fkey in index cache
+ *==========================================================*/
+static INT
+ichash (INDEXCACHE ic, FKEY fkey)
+{
+	/* multiplicative hash; bucket count is a power of 2 */
+	unsigned int h = (unsigned int)fkey * 2654435761U;
+	return (INT)((h >> 8) & (unsigned int)(ic->ic_nbuckets - 1));
+}
+/*============================================================
+ * touchentry -- Move entry to most recently used end of list
+ *==========================================================*/
+static void
+touchentry (INDEXCACHE ic, ICENTRY entry)
+{
+	if (entry == ic->ic_first) return;
+	/* unlink (entry has a predecessor, as it is not first) */
+	entry->e_prev->e_next = entry->e_next;
+	if (entry->e_next)
+		entry->e_next->e_prev = entry->e_prev;
+	else
+		ic->ic_last = entry->e_prev;
+	/* relink at front */
+	entry->e_prev = NULL;
+	entry->e_next = ic->ic_first;
+	ic->ic_first->e_prev = entry;
+	ic->ic_first = entry;
+}
+/*============================================================
+ * dropentry -- Remove entry (& free its INDEX) from index cache
+ *==========================================================*/
+static void
+dropentry (INDEXCACHE ic, ICENTRY entry)
+{
+	ICENTRY *pp = &ic->ic_buckets[ichash(ic, entry->e_fkey)];
+	while (*pp != entry)
+		pp = &(*pp)->e_hnext;
+	*pp = entry->e_hnext;
+	if (entry->e_prev)
+		entry->e_prev->e_next = entry->e_next;
+	else
+		ic->ic_first = entry->e_next;
+	if (entry->e_next)
+		entry->e_next->e_prev = entry->e_prev;
+	else
+		ic->ic_last = entry->e_prev;
+	stdfree(entry->e_index);
+	stdfree(entry);
+	--ic->ic_count;
+}
+/*============================================================
+ * growbuckets -- Double number of hash buckets & rehash
+ *==========================================================*/
+static void
+growbuckets (INDEXCACHE ic)
+{
+	ICENTRY *old = ic->ic_buckets;
+	INT i, nold = ic->ic_nbuckets;
+	ic->ic_nbuckets = 2*nold;
+	ic->ic_buckets = (ICENTRY *) stdalloc(ic->ic_nbuckets*sizeof(ICENTRY));
+	for (i = 0; i < nold; ++i) {
+		ICENTRY entry = old[i];
+		while (entry) {
+			ICENTRY next = entry->e_hnext;
+			INT h = ichash(ic, entry->e_fkey);
+			entry->e_hnext = ic->ic_buckets[h];
+			ic->ic_buckets[h] = entry;
+			entry = next;
+		}
 	}
-	return -1;
+	stdfree(old);
 }
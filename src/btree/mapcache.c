@@ -0,0 +1,231 @@
+/* 
+   Copyright (c) 2026 The LifeLines developers
+   "The MIT license"
+   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+/*=============================================================
+ * mapcache.c -- Cache of memory-mapped BTREE files
+ *  Used for readonly (or immutable) btrees, so that reading
+ *  records and block headers does not cost an open/seek/read/close
+ *  for every record. The most recently used mappings are kept
+ *  in a small LRU list hanging off the BTREE.
+ *   Created: 2026/10
+ *===========================================================*/
+
+#include "sys_inc.h"
+#include "llstdlib.h"
+#include "btreei.h"
+
+#if defined(HAVE_MMAP) && defined(HAVE_SYS_MMAN_H)
+#define USE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#endif
+
+/*********************************************
+ * local types
+ *********************************************/
+
+typedef struct tag_mapentry {
+	FKEY   m_fkey;   /* file mapped */
+	char  *m_base;   /* start of mapping */
+	INT    m_len;    /* length of file (and mapping) */
+	struct tag_mapentry *m_next; /* next most recently used */
+} *MAPENTRY;
+
+struct tag_mapcache {
+	INT      mc_max;   /* max mappings held */
+	INT      mc_count; /* mappings currently held */
+	MAPENTRY mc_first; /* most recently used */
+};
+
+/*********************************************
+ * local function prototypes
+ *********************************************/
+
+/* alphabetical */
+#ifdef USE_MMAP
+static MAPENTRY mapfile(BTREE btree, FKEY fkey);
+static void unmapentry(MAPENTRY entry);
+#endif
+
+/*********************************************
+ * local & exported function definitions
+ * body of module
+ *********************************************/
+
+/*==============================================
+ * initmapcache -- Set up file mapping for btree
+ *  btree: [IN]  btree handle
+ *  n:     [IN]  max number of files to keep mapped
+ * Does nothing where mmap is not available, or if n is 0
+ *============================================*/
+void
+initmapcache (BTREE btree, INT n)
+{
+	MAPCACHE mc=0;
+	bmapcache(btree) = NULL;
+#ifdef USE_MMAP
+	if (n <= 0) return;
+	mc = (MAPCACHE) stdalloc(sizeof(*mc));
+	mc->mc_max = n;
+	mc->mc_count = 0;
+	mc->mc_first = NULL;
+#endif
+	bmapcache(btree) = mc;
+}
+/*=============================================
+ * freemapcache -- Release all file mappings
+ *  btree: [IN]  btree handle
+ *===========================================*/
+void
+freemapcache (BTREE btree)
+{
+	MAPCACHE mc = bmapcache(btree);
+	if (!mc) return;
+#ifdef USE_MMAP
+	while (mc->mc_first) {
+		MAPENTRY entry = mc->mc_first;
+		mc->mc_first = entry->m_next;
+		unmapentry(entry);
+	}
+#endif
+	stdfree(mc);
+	bmapcache(btree) = NULL;
+}
+/*=============================================
+ * getmappedfile -- Find (or create) mapping of btree file
+ *  btree: [IN]  btree handle
+ *  fkey:  [IN]  file desired (index or block)
+ *  plen:  [OUT] length of file
+ * returns start of mapped file, or NULL if not available
+ *  (caller falls back to stdio in that case)
+ * Pointer is valid until the next call into this module
+ *===========================================*/
+CNSTRING
+getmappedfile (BTREE btree, FKEY fkey, INT *plen)
+{
+#ifdef USE_MMAP
+	MAPCACHE mc = bmapcache(btree);
+	MAPENTRY entry, prev=NULL;
+	if (!mc) return NULL;
+	/* look for it, moving it to front if found */
+	for (entry = mc->mc_first; entry; prev = entry, entry = entry->m_next) {
+		if (entry->m_fkey == fkey) {
+			if (prev) {
+				prev->m_next = entry->m_next;
+				entry->m_next = mc->mc_first;
+				mc->mc_first = entry;
+			}
+			*plen = entry->m_len;
+			return entry->m_base;
+		}
+	}
+	if (!(entry = mapfile(btree, fkey)))
+		return NULL;
+	/* drop least recently used mapping if full */
+	if (mc->mc_count >= mc->mc_max) {
+		MAPENTRY last = mc->mc_first;
+		prev = NULL;
+		while (last->m_next) {
+			prev = last;
+			last = last->m_next;
+		}
+		if (prev)
+			prev->m_next = NULL;
+		else
+			mc->mc_first = NULL;
+		unmapentry(last);
+		--mc->mc_count;
+	}
+	entry->m_next = mc->mc_first;
+	mc->mc_first = entry;
+	++mc->mc_count;
+	*plen = entry->m_len;
+	return entry->m_base;
+#else
+	btree=btree; /* unused */
+	fkey=fkey; /* unused */
+	plen=plen; /* unused */
+	return NULL;
+#endif
+}
+/*=============================================
+ * unmapfile -- Drop any mapping of specified file
+ *  (eg, because it was replaced on disk)
+ *  btree: [IN]  btree handle
+ *  fkey:  [IN]  file
+ *===========================================*/
+void
+unmapfile (BTREE btree, FKEY fkey)
+{
+#ifdef USE_MMAP
+	MAPCACHE mc = bmapcache(btree);
+	MAPENTRY entry, prev=NULL;
+	if (!mc) return;
+	for (entry = mc->mc_first; entry; prev = entry, entry = entry->m_next) {
+		if (entry->m_fkey == fkey) {
+			if (prev)
+				prev->m_next = entry->m_next;
+			else
+				mc->mc_first = entry->m_next;
+			unmapentry(entry);
+			--mc->mc_count;
+			return;
+		}
+	}
+#else
+	btree=btree; /* unused */
+	fkey=fkey; /* unused */
+#endif
+}
+#ifdef USE_MMAP
+/*=============================================
+ * mapfile -- Map one btree file into memory
+ *  btree: [IN]  btree handle
+ *  fkey:  [IN]  file to map
+ * returns new entry (not yet linked in), or NULL on failure
+ *===========================================*/
+static MAPENTRY
+mapfile (BTREE btree, FKEY fkey)
+{
+	char scratch[MAXPATHLEN];
+	struct stat sbuf;
+	MAPENTRY entry;
+	void * base;
+	int fd;
+
+	snprintf(scratch, sizeof(scratch)
+		, "%s%c%s"
+		, bbasedir(btree), LLCHRDIRSEPARATOR, fkey2path(fkey));
+	if ((fd = open(scratch, O_RDONLY)) < 0)
+		return NULL;
+	btcount(btree, c_opens, 1);
+	if (fstat(fd, &sbuf) != 0 || sbuf.st_size < PAGELEN) {
+		close(fd);
+		return NULL;
+	}
+	base = mmap(NULL, (size_t)sbuf.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	/* mapping stays valid after descriptor is closed */
+	close(fd);
+	if (base == MAP_FAILED)
+		return NULL;
+	entry = (MAPENTRY) stdalloc(sizeof(*entry));
+	entry->m_fkey = fkey;
+	entry->m_base = (char *)base;
+	entry->m_len = (INT)sbuf.st_size;
+	entry->m_next = NULL;
+	return entry;
+}
+/*=============================================
+ * unmapentry -- Unmap & free one entry
+ *===========================================*/
+static void
+unmapentry (MAPENTRY entry)
+{
+	munmap(entry->m_base, (size_t)entry->m_len);
+	stdfree(entry);
+}
+#endif /* USE_MMAP */
@@ -43,8 +43,17 @@
 
 /* alphabetical */
 static void init_keyfile1(KEYFILE1 * kfile1);
-static void init_keyfile2(KEYFILE2 * kfile2);
-static BOOLEAN initbtree (STRING basedir, INT *lldberr);
+static void init_keyfile2(KEYFILE2 * kfile2, INT pagelen);
+static BOOLEAN initbtree (STRING basedir, BOOLEAN paged, INT *lldberr);
+static BTREE openbtree(STRING dir, INT cflag, INT writ, BOOLEAN immut, BOOLEAN snap, INT *lldberr);
+static BOOLEAN write_keyfile2(FILE *fp, KEYFILE2 * kfile2);
+
+/*********************************************
+ * local variables
+ *********************************************/
+
+/* number of btrees open (which share the page length, see btgeom) */
+static INT opened = 0;
 
 /*********************************************
  * local function definitions
@@ -70,12 +79,44 @@ init_keyfile1 (KEYFILE1 * kfile1)
  * 2000/12/08, Perry Rapp
  *==========================================*/
 static void
-init_keyfile2 (KEYFILE2 * kfile2)
+init_keyfile2 (KEYFILE2 * kfile2, INT pagelen)
 {
 	memset(kfile2, 0, sizeof(*kfile2));
 	strncpy(kfile2->name, KF2_NAME, sizeof(kfile2->name));
 	kfile2->magic = KF2_MAGIC;
-	kfile2->version = KF2_VER;
+	/* databases of default page length stay readable by older versions */
+	kfile2->version = (pagelen == BUFLEN) ? KF2_VER : KF2_VERPAGE;
+	kfile2->pagelen = pagelen;
+}
+/*============================================
+ * read_keyfile2 -- Read KEYFILE2 structure (after KEYFILE1)
+ *  fp:     [IN]  key file
+ *  kfile2: [OUT] structure read
+ * returns FALSE if key file has none (ie, is from before KEYFILE2)
+ * pagelen is only stored by KF2_VERPAGE, & is BUFLEN otherwise
+ *==========================================*/
+BOOLEAN
+read_keyfile2 (FILE *fp, KEYFILE2 * kfile2)
+{
+	memset(kfile2, 0, sizeof(*kfile2));
+	if (fread(kfile2, KF2_V1LEN, 1, fp) != 1)
+		return FALSE;
+	kfile2->pagelen = BUFLEN;
+	if (kfile2->version == KF2_VERPAGE
+		&& fread(&kfile2->pagelen, sizeof(kfile2->pagelen), 1, fp) != 1)
+		kfile2->pagelen = 0; /* fails validation */
+	return TRUE;
+}
+/*============================================
+ * write_keyfile2 -- Write KEYFILE2 structure (after KEYFILE1)
+ *  (in the length its version has)
+ *==========================================*/
+static BOOLEAN
+write_keyfile2 (FILE *fp, KEYFILE2 * kfile2)
+{
+	INT len = (kfile2->version == KF2_VERPAGE)
+		? (INT)sizeof(*kfile2) : KF2_V1LEN;
+	return fwrite(kfile2, len, 1, fp) == 1;
 }
 /*============================================
  * validate_keyfile2 -- Is KEYFILE2 structure valid ?
@@ -94,7 +135,8 @@ validate_keyfile2 (KEYFILE2 * kfile2, INT *lldberr)
 		*lldberr = BTERR_ALIGNKF;
 		return FALSE;
 	}
-	if (kfile2->version != KF2_VER)
+	if (kfile2->version != KF2_VER
+		&& !(kfile2->version == KF2_VERPAGE && validpagelen(kfile2->pagelen)))
 	{
 		*lldberr = BTERR_VERKF;
 		return FALSE;
@@ -105,17 +147,48 @@ validate_keyfile2 (KEYFILE2 * kfile2, INT *lldberr)
  * bt_openbtree -- Alloc and init BTREE structure
  *  If it fails, it returns NULL and sets the *lldberr
  *  dir:     [IN]  btree base dir
- *  cflag:   [IN]  create btree if no exist?
+ *  cflag:   [IN]  create btree if no exist? (BTFLGCRT, and also
+ *                 BTFLGPAGED to create it as a single paged file,
+ *                 BTFLGPAGE for larger index & block headers)
  *  writ:    [IN]  requesting write access? 1=yes, 2=requiring 
  *  immut:   [I/O] user can/will not change anything including keyfile
  *  lldberr: [OUT] error code (if returns NULL)
  * If this succeeds, it sets readonly & immutable flags in btree structure
  *  as appropriate (eg, if keyfile couldn't be opened in readwrite mode)
+ * A btree whose directory holds a paged file (BTPAGEFILE) is opened
+ *  as a paged btree
+ * All btrees open at once must have the same page length
+ *  (else BTERR_PAGELEN)
  *==========================================*/
 BTREE
-bt_openbtree (STRING dir, BOOLEAN cflag, INT writ, BOOLEAN immut, INT *lldberr)
+bt_openbtree (STRING dir, INT cflag, INT writ, BOOLEAN immut, INT *lldberr)
+{
+	return openbtree(dir, cflag, writ, immut, FALSE, lldberr);
+}
+/*============================================
+ * bt_opensnapshot -- Open BTREE as snapshot reader
+ *  dir:     [IN]  btree base dir
+ *  lldberr: [OUT] error code (if returns NULL)
+ * The btree is seen as it was when opened, whatever any writer
+ *  does meanwhile (see snapshot.c); it is opened immutable, so
+ *  neither blocks nor is blocked by readers & writers
+ * Fails (BTERR_SNAPSHOT) for paged btree, or if writer is in the
+ *  middle of an operation for longer than BTSNAPWAIT seconds
+ *==========================================*/
+BTREE
+bt_opensnapshot (STRING dir, INT *lldberr)
+{
+	return openbtree(dir, 0, 0, TRUE, TRUE, lldberr);
+}
+/*============================================
+ * openbtree -- Open BTREE (see bt_openbtree & bt_opensnapshot)
+ *  snap:    [IN]  open as snapshot reader ?
+ *==========================================*/
+static BTREE
+openbtree (STRING dir, INT cflag, INT writ, BOOLEAN immut, BOOLEAN snap, INT *lldberr)
 {
 	BTREE btree;
+	FKEY mkey;
 	char scratch[200];
 	FILE *fk=NULL;
 	struct stat sbuf;
@@ -123,6 +196,7 @@ bt_openbtree (STRING dir, BOOLEAN cflag, INT writ, BOOLEAN immut, INT *lldberr)
 	KEYFILE2 kfile2;
 	BOOLEAN keyed2 = FALSE;
 	STRING dbmode;
+	INT pagelen;
 
 	/* we only allow 150 characters in base directory name */
 	*lldberr = 0;
@@ -163,7 +237,18 @@ bt_openbtree (STRING dir, BOOLEAN cflag, INT writ, BOOLEAN immut, INT *lldberr)
 			goto failopenbtree;
 		}
 		/* create flag set, so try to create it & stat again */
-		if (!initbtree(dir, lldberr) || stat(scratch, &sbuf)) {
+		pagelen = BUFLEN << ((cflag >> 8) & 0xf);
+		if (!validpagelen(pagelen)) {
+			*lldberr = BTERR_DBCREATEFAILED;
+			goto failopenbtree;
+		}
+		if (opened && pagelen != PAGELEN) {
+			*lldberr = BTERR_PAGELEN;
+			goto failopenbtree;
+		}
+		setpagelen(pagelen);
+		if (!initbtree(dir, (cflag & BTFLGPAGED) != 0, lldberr)
+			|| stat(scratch, &sbuf)) {
 			/* initbtree actually set *lldberr, but we ignore it */
 			*lldberr = BTERR_DBCREATEFAILED;
 			goto failopenbtree;
@@ -199,11 +284,18 @@ immutretry:
 	}
 /* Read & validate KEYFILE2 - if not present, we'll add it below */
 	/* see btree.h for explanation of KEYFILE2 */
-	if (fread(&kfile2, sizeof(kfile2), 1, fk) == 1) {
+	if (read_keyfile2(fk, &kfile2)) {
 		if (!validate_keyfile2(&kfile2, lldberr))
 			goto failopenbtree; /* validate set *lldberr */
 		keyed2=TRUE;
 	}
+	/* headers of all open btrees are laid out alike */
+	pagelen = keyed2 ? kfile2.pagelen : BUFLEN;
+	if (opened && pagelen != PAGELEN) {
+		*lldberr = BTERR_PAGELEN;
+		goto failopenbtree;
+	}
+	setpagelen(pagelen);
 	if (writ < 2 && kfile1.k_ostat == -2)
 		immut = TRUE; /* keyfile contains the flag for immutable access only */
 	/* if not immutable, handle reader/writer protection update */
@@ -229,8 +321,8 @@ immutretry:
 		}
 		if (!keyed2) {
 			/* add KEYFILE2 structure */
-			init_keyfile2(&kfile2);
-			if (fwrite(&kfile2, sizeof(kfile2), 1, fk) != 1) {
+			init_keyfile2(&kfile2, BUFLEN);
+			if (!write_keyfile2(fk, &kfile2)) {
 				*lldberr = BTERR_KFILE;
 				goto failopenbtree;
 			}
@@ -244,22 +336,50 @@ immutretry:
 /* Create BTREE structure */
 	btree = (BTREE) stdalloc(sizeof *btree);
 	bbasedir(btree) = dir;
-	bmaster(btree) = readindex(btree, kfile1.k_mkey, TRUE);
+	bwrite(btree) = !immut && writ && (kfile1.k_ostat == -1);
+	sprintf(scratch, "%s/%s", dir, BTPAGEFILE);
+	if (!stat(scratch, &sbuf)
+		&& !(bpagefile(btree) = openpagefile(scratch, bwrite(btree), FALSE))) {
+		stdfree(btree);
+		*lldberr = BTERR_PAGEFILE;
+		goto failopenbtree;
+	}
+	bkfile(btree) = kfile1;
+	mkey = kfile1.k_mkey;
+	if (snap && !snapattach(btree, &mkey, lldberr)) {
+		if (bpagefile(btree))
+			closepagefile(bpagefile(btree));
+		stdfree(btree);
+		goto failopenbtree;
+	}
+	bmaster(btree) = readindex(btree, mkey, TRUE);
 
 	if (!(bmaster(btree)))
 	{
+		snapclose(btree);
+		if (bpagefile(btree))
+			closepagefile(bpagefile(btree));
 		stdfree(btree);
 		*lldberr = BTERR_MASTER_INDEX;
 		goto failopenbtree;
 	}
 	
-	bwrite(btree) = !immut && writ && (kfile1.k_ostat == -1);
 	bimmut(btree) = immut; /* includes case that ostat is -2 */
 	bkfp(btree) = fk;
-	btree->b_kfile.k_mkey = kfile1.k_mkey;
-	btree->b_kfile.k_fkey = kfile1.k_fkey;
-	btree->b_kfile.k_ostat = kfile1.k_ostat;
-	initcache(btree, 20);
+	btree->b_kfile.k_mkey = mkey;
+	initcache(btree, BTINDEXCACHEBYTES);
+	initfilters(btree, BTFILTERBYTES);
+	/* readonly handles read records straight out of mapped files,
+	 but a snapshot opens each file afresh, to look for its version */
+	initmapcache(btree, bwrite(btree) || bpagefile(btree) || snap ? 0 : BTMAPCACHESIZE);
+	initfdcache(btree, snap ? 0 : BTFDCACHESIZE);
+	/* snapshot sees no later changes, even those only logged */
+	if (!snap) {
+		snapopen(btree);
+		/* recover records logged but not checkpointed last session */
+		walopen(btree);
+	}
+	++opened;
 	return btree;
 
 failopenbtree:
@@ -268,15 +388,19 @@ failopenbtree:
 }
 /*==================================
  * initbtree -- Initialize new BTREE
+ *  basedir: [IN]  btree base dir
+ *  paged:   [IN]  create as single paged file ?
+ *  lldberr: [OUT] error code (if returns FALSE)
  *================================*/
 static BOOLEAN
-initbtree (STRING basedir, INT *lldberr)
+initbtree (STRING basedir, BOOLEAN paged, INT *lldberr)
 {
 	KEYFILE1 kfile1;
 	KEYFILE2 kfile2;
 	INDEX master=0;
 	BLOCK block=0;
 	FILE *fk=NULL, *fi=NULL, *fd=NULL;
+	PAGEFILE pf=NULL;
 	char scratch[200];
 	BOOLEAN result=FALSE; /* only set to good at end */
 	INT rtn=0;
@@ -288,6 +412,16 @@ initbtree (STRING basedir, INT *lldberr)
 		goto initbtree_exit;
 	}
 
+/* Paged btree has master index & first data block in paged file */
+	if (paged) {
+		sprintf(scratch, "%s/%s", basedir, BTPAGEFILE);
+		if ((pf = openpagefile(scratch, TRUE, TRUE)) == NULL) {
+			*lldberr = BTERR_PAGEFILE;
+			goto initbtree_exit;
+		}
+		goto initbtree_keyfile;
+	}
+
 /* Open file for writing master index */
 	sprintf(scratch, "%s/aa/aa", basedir);
 	if (!mkalldirs(scratch) || (fi = fopen(scratch, LLWRITEBINARY)) == NULL) {
@@ -303,10 +437,11 @@ initbtree (STRING basedir, INT *lldberr)
 	}
 
 /* Write key file */
+initbtree_keyfile:
 	init_keyfile1(&kfile1);
-	init_keyfile2(&kfile2);
+	init_keyfile2(&kfile2, PAGELEN);
 	if (fwrite(&kfile1, sizeof(kfile1), 1, fk) != 1
-		|| fwrite(&kfile2, sizeof(kfile2), 1, fk) != 1) {
+		|| !write_keyfile2(fk, &kfile2)) {
 		*lldberr = BTERR_KFILE;
 		goto initbtree_exit;
 	}
@@ -318,20 +453,25 @@ initbtree (STRING basedir, INT *lldberr)
 	fk=NULL;
 
 /* Write master index */
-	master = (INDEX) stdalloc(BUFLEN);
+	master = (INDEX) stdalloc(PAGELEN);
 	ixtype(master) = BTINDEXTYPE;
 	ixself(master) = path2fkey("aa/aa");
 	ixparent(master) = 0;
 	master->ix_nkeys = 0;
-	master->ix_fkeys[0] = path2fkey("ab/aa");
-	rtn = fwrite(master, BUFLEN, 1, fi);
+	fkeys(master, 0) = path2fkey("ab/aa");
+	if (pf) {
+		writepages(pf, ixself(master), master, PAGELEN, 0);
+		rtn = 1;
+	} else {
+		rtn = fwrite(master, PAGELEN, 1, fi);
+	}
 	stdfree(master);
 	master = 0;
 	if (rtn != 1) {
 		*lldberr = BTERR_INDEX;
 		goto initbtree_exit;
 	}
-	if (fclose(fi) != 0) {
+	if (fi && fclose(fi) != 0) {
 		fi = NULL;
 		*lldberr = BTERR_INDEX;
 		goto initbtree_exit;
@@ -339,19 +479,25 @@ initbtree (STRING basedir, INT *lldberr)
 	fi=NULL;
 
 /* Write first data block */
-	block = (BLOCK) stdalloc(BUFLEN);
+	block = (BLOCK) stdalloc(PAGELEN);
 	ixtype(block) = BTBLOCKTYPE;
 	ixself(block) = path2fkey("ab/aa");
 	ixparent(block) = 0;
 	block->ix_nkeys = 0;
-	rtn = fwrite(block, BUFLEN, 1, fd);
+	if (pf) {
+		writepages(pf, ixself(block), block, PAGELEN, 0);
+		syncpagefile(pf);
+		rtn = 1;
+	} else {
+		rtn = fwrite(block, PAGELEN, 1, fd);
+	}
 	stdfree(block);
 	block = 0;
 	if (rtn != 1) {
 		*lldberr = BTERR_BLOCK;
 		goto initbtree_exit;
 	}
-	if (fclose(fd) != 0) {
+	if (fd && fclose(fd) != 0) {
 		fd = NULL;
 		*lldberr = BTERR_BLOCK;
 		goto initbtree_exit;
@@ -363,6 +509,7 @@ initbtree (STRING basedir, INT *lldberr)
 
 initbtree_exit:
 	/* close any open files */
+	if (pf) closepagefile(pf);
 	if (fd) fclose(fd);
 	if (fi) fclose(fi);
 	if (fk) fclose(fk);
@@ -377,6 +524,11 @@ closebtree (BTREE btree)
 	FILE *fk=NULL;
 	KEYFILE1 kfile1;
 	BOOLEAN result=FALSE;
+	if (btree) {
+		walclose(btree);
+		snapclose(btree);
+		logcounters(btree, "close");
+	}
 	if (btree && ((fk = bkfp(btree)) != NULL) && !bimmut(btree)) {
 		kfile1 = btree->b_kfile;
 		if (kfile1.k_ostat <= 0) {
@@ -419,7 +571,16 @@ closebtree (BTREE btree)
 exit_closebtree:
 	if (fk) fclose(fk);
 	if (btree) {
+		--opened;
+		freeshared(btree);
+		freemapcache(btree);
+		freefdcache(btree);
+		if (bpagefile(btree))
+			closepagefile(bpagefile(btree));
 		freecache(btree);
+		freefilters(btree);
+		if (btree->b_statslog)
+			stdfree(btree->b_statslog);
 		if(bmaster(btree)) {
 			stdfree(bmaster(btree));
 		}
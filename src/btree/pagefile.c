@@ -0,0 +1,583 @@
+/*
+   Copyright (c) 2026 The LifeLines developers
+   "The MIT license"
+   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+/*=============================================================
+ * pagefile.c -- Single paged file holding all BTREE files
+ *  Instead of one file per index or data block (named by
+ *  fkey2path), a paged btree keeps each of them as a run of
+ *  BUFLEN pages (an extent) in one file (BTPAGEFILE).
+ *  Page 0 is the header, which locates the extent map of each
+ *  "directory" (hi half of FKEY); the map has an entry for each
+ *  FKEY in the directory (lo half of FKEY).
+ *  A file is replaced by writing it to fresh pages & then
+ *  updating its map entry, so readers see the old or the new
+ *  version, as with rename in a directory btree.
+ *  The free-page map is kept in memory only, as it is rebuilt
+ *  from the extent maps when the file is opened.
+ *   Created: 2026/10
+ *===========================================================*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include "sys_inc.h"
+#include "llstdlib.h"
+#include "btreei.h"
+
+/*********************************************
+ * local types
+ *********************************************/
+
+/* number of possible values of each half of a FKEY (see fkey2path) */
+#define PF_NDIRS (26*26)
+#define PF_NAME "LifeLines Pages"
+#define PF_MAGIC 0x12345678
+#define PF_VER 1
+
+/* where one btree file lives in the paged file */
+typedef struct {
+	INT e_start;  /* first page (0 if file does not exist) */
+	INT e_pages;  /* pages allocated to file */
+	INT e_len;    /* length of file */
+} PAGEEXTENT;
+
+/* pages needed by the extent map of one directory */
+#define PF_MAPPAGES ((INT)((PF_NDIRS*sizeof(PAGEEXTENT)+BUFLEN-1)/BUFLEN))
+
+/* contents of page 0 */
+typedef struct {
+	char h_name[16];         /* PF_NAME */
+	INT  h_magic;            /* PF_MAGIC (byte order check) */
+	INT  h_version;          /* PF_VER */
+	INT  h_maps[PF_NDIRS];   /* first page of map of each directory (or 0) */
+} PAGEHEADER;
+
+struct tag_pagefile {
+	int         pf_fd;       /* descriptor of paged file */
+	BOOLEAN     pf_write;    /* opened for writing ? */
+	PAGEHEADER  pf_hdr;      /* header page */
+	PAGEEXTENT *pf_maps[PF_NDIRS]; /* extent maps (NULL if none) */
+	INT         pf_npages;   /* pages in (or allocated past end of) file */
+	INT         pf_mapsize;  /* bytes in free-page map */
+	unsigned char *pf_used;  /* free-page map (bit set if page in use) */
+	INT         pf_hint;     /* no free page below this one */
+};
+
+/*********************************************
+ * local function prototypes
+ *********************************************/
+
+/* alphabetical */
+static INT allocpages(PAGEFILE pf, INT n);
+static void copytree(BTREE btree, PAGEFILE pf, FKEY fkey);
+static PAGEEXTENT *findextent(PAGEFILE pf, FKEY fkey, BOOLEAN create);
+static void freepages(PAGEFILE pf, INT start, INT n);
+static void loadpages(PAGEFILE pf, FKEY fkey, STRING file);
+static void markpages(PAGEFILE pf, INT start, INT n);
+static BOOLEAN pageread(int fd, void *buf, INT len, off_t off);
+static BOOLEAN pagewrite(int fd, const void *buf, INT len, off_t off);
+static INT pagesfor(INT len);
+static void putextent(PAGEFILE pf, FKEY fkey, PAGEEXTENT *ext);
+static void removetree(BTREE btree, FKEY fkey);
+
+/*********************************************
+ * local & exported function definitions
+ * body of module
+ *********************************************/
+
+/*=============================================
+ * openpagefile -- Open (or create) paged file of btree
+ *  path:   [IN]  paged file
+ *  write:  [IN]  open for writing ?
+ *  create: [IN]  create new empty paged file ?
+ * returns NULL if file is missing or is not a paged file
+ *===========================================*/
+PAGEFILE
+openpagefile (STRING path, BOOLEAN write, BOOLEAN create)
+{
+	PAGEFILE pf;
+	PAGEHEADER *hdr;
+	PAGEEXTENT *map;
+	struct stat sbuf;
+	int fd, flags = write ? O_RDWR : O_RDONLY;
+	INT i, j;
+
+	if (create)
+		flags |= O_CREAT | O_TRUNC;
+#ifdef O_BINARY
+	flags |= O_BINARY;
+#endif
+	if ((fd = open(path, flags, 0666)) < 0)
+		return NULL;
+	pf = (PAGEFILE) stdalloc(sizeof(*pf));
+	pf->pf_fd = fd;
+	pf->pf_write = write;
+	hdr = &pf->pf_hdr;
+	if (create) {
+		char page[BUFLEN];
+		strcpy(hdr->h_name, PF_NAME);
+		hdr->h_magic = PF_MAGIC;
+		hdr->h_version = PF_VER;
+		memset(page, 0, BUFLEN);
+		memcpy(page, hdr, sizeof(*hdr));
+		if (!pagewrite(fd, page, BUFLEN, 0))
+			goto badpagefile;
+	} else if (!pageread(fd, hdr, sizeof(*hdr), 0)
+		|| strcmp(hdr->h_name, PF_NAME)
+		|| hdr->h_magic != PF_MAGIC
+		|| hdr->h_version != PF_VER) {
+		goto badpagefile;
+	}
+	/* pages in use are header, maps, & extents in maps */
+	if (fstat(fd, &sbuf))
+		goto badpagefile;
+	pf->pf_npages = pagesfor((INT)sbuf.st_size);
+	markpages(pf, 0, 1);
+	for (i = 0; i < PF_NDIRS; ++i) {
+		if (!hdr->h_maps[i])
+			continue;
+		map = (PAGEEXTENT *) stdalloc(PF_MAPPAGES*BUFLEN);
+		if (!pageread(fd, map, PF_NDIRS*sizeof(PAGEEXTENT)
+			, (off_t)hdr->h_maps[i]*BUFLEN)) {
+			stdfree(map);
+			goto badpagefile;
+		}
+		pf->pf_maps[i] = map;
+		markpages(pf, hdr->h_maps[i], PF_MAPPAGES);
+		for (j = 0; j < PF_NDIRS; ++j) {
+			if (map[j].e_start)
+				markpages(pf, map[j].e_start, map[j].e_pages);
+		}
+	}
+	return pf;
+
+badpagefile:
+	closepagefile(pf);
+	return NULL;
+}
+/*=============================================
+ * closepagefile -- Close paged file & free its maps
+ *===========================================*/
+void
+closepagefile (PAGEFILE pf)
+{
+	INT i;
+	close(pf->pf_fd);
+	for (i = 0; i < PF_NDIRS; ++i) {
+		if (pf->pf_maps[i])
+			stdfree(pf->pf_maps[i]);
+	}
+	if (pf->pf_used)
+		stdfree(pf->pf_used);
+	stdfree(pf);
+}
+/*=============================================
+ * syncpagefile -- Force paged file through to disk
+ *===========================================*/
+void
+syncpagefile (PAGEFILE pf)
+{
+#ifdef HAVE_FSYNC
+	fsync(pf->pf_fd);
+#else
+	pf=pf; /* unused */
+#endif
+}
+/*=============================================
+ * readpages -- Read exactly len bytes of btree file
+ *  pf:   [IN]  paged file
+ *  fkey: [IN]  btree file (index or block)
+ *  buf:  [OUT] destination
+ *  len:  [IN]  bytes wanted
+ *  off:  [IN]  offset in btree file
+ * returns FALSE if btree file is missing or too short
+ *===========================================*/
+BOOLEAN
+readpages (PAGEFILE pf, FKEY fkey, void *buf, INT len, INT off)
+{
+	PAGEEXTENT *ext = findextent(pf, fkey, FALSE);
+	if (!ext || !ext->e_start || off < 0 || off + len > ext->e_len)
+		return FALSE;
+	return pageread(pf->pf_fd, buf, len, (off_t)ext->e_start*BUFLEN + off);
+}
+/*=============================================
+ * writepages -- Write len bytes of btree file
+ *  pf:   [IN]  paged file
+ *  fkey: [IN]  btree file (created if need be)
+ *  buf:  [IN]  source
+ *  len:  [IN]  bytes to write
+ *  off:  [IN]  offset in btree file
+ * Writes in place when the file's extent is big enough, else
+ *  moves the file to a bigger extent (with room to grow, for
+ *  appendrecord); errors are fatal
+ *===========================================*/
+void
+writepages (PAGEFILE pf, FKEY fkey, const void *buf, INT len, INT off)
+{
+	PAGEEXTENT *ext = findextent(pf, fkey, TRUE), next;
+	INT need = pagesfor(off + len);
+	char scratch[256];
+	char page[BUFLEN];
+	INT done, blklen;
+
+	ASSERT(pf->pf_write);
+	next = *ext;
+	if (off + len > next.e_len)
+		next.e_len = off + len;
+	if (ext->e_start && need <= ext->e_pages) {
+		if (!pagewrite(pf->pf_fd, buf, len, (off_t)ext->e_start*BUFLEN + off))
+			goto badwrite;
+		if (next.e_len != ext->e_len)
+			putextent(pf, fkey, &next);
+		return;
+	}
+	/* new file gets just what it needs, growing file gets spare */
+	next.e_pages = ext->e_start ? need + need/2 : need;
+	next.e_start = allocpages(pf, next.e_pages);
+	for (done = 0; done < ext->e_len && done < off; done += blklen) {
+		blklen = ext->e_len - done;
+		if (blklen > BUFLEN) blklen = BUFLEN;
+		if (!pageread(pf->pf_fd, page, blklen, (off_t)ext->e_start*BUFLEN + done)
+			|| !pagewrite(pf->pf_fd, page, blklen, (off_t)next.e_start*BUFLEN + done))
+			goto badwrite;
+	}
+	if (!pagewrite(pf->pf_fd, buf, len, (off_t)next.e_start*BUFLEN + off))
+		goto badwrite;
+	if (ext->e_start)
+		freepages(pf, ext->e_start, ext->e_pages);
+	putextent(pf, fkey, &next);
+	return;
+
+badwrite:
+	sprintf(scratch, "Error (errno=%d) writing btree file %s to paged file"
+		, errno, fkey2path(fkey));
+	FATAL2(scratch);
+}
+/*=============================================
+ * importpages -- Replace btree file with contents of another file
+ *  pf:   [IN]  paged file
+ *  fkey: [IN]  btree file being replaced
+ *  file: [IN]  file with new contents (removed afterwards)
+ * This is movefiles for a paged btree
+ *===========================================*/
+void
+importpages (PAGEFILE pf, FKEY fkey, STRING file)
+{
+	loadpages(pf, fkey, file);
+	unlink(file);
+}
+/*=============================================
+ * removepages -- Remove btree file from paged file
+ *  pf:   [IN]  paged file
+ *  fkey: [IN]  btree file
+ *===========================================*/
+void
+removepages (PAGEFILE pf, FKEY fkey)
+{
+	PAGEEXTENT *ext = findextent(pf, fkey, FALSE), next;
+	if (!ext || !ext->e_start)
+		return;
+	freepages(pf, ext->e_start, ext->e_pages);
+	memset(&next, 0, sizeof(next));
+	putextent(pf, fkey, &next);
+}
+/*=============================================
+ * bt_pagebtree -- Convert directory btree into paged btree
+ *  btree: [IN]  btree (must be writeable)
+ * Every index & block file reachable from the master index is
+ *  copied into a new paged file, which is then renamed into
+ *  place; only after that are the old files removed, so the
+ *  btree is intact if this is interrupted.
+ * returns FALSE if btree is readonly or already paged, snapshot
+ *  readers are using it, or the paged file cannot be created
+ *===========================================*/
+BOOLEAN
+bt_pagebtree (BTREE btree)
+{
+	char path[MAXPATHLEN], newpath[MAXPATHLEN];
+	PAGEFILE pf;
+
+	if (!bwrite(btree) || bpagefile(btree))
+		return FALSE;
+	walcheckpoint(btree);
+	/* snapshot readers need the files about to be removed */
+	snapbegin(btree);
+	if (snapreaders(btree)) {
+		snapend(btree);
+		return FALSE;
+	}
+	sprintf(newpath, "%s/%s.new", bbasedir(btree), BTPAGEFILE);
+	if (!(pf = openpagefile(newpath, TRUE, TRUE))) {
+		snapend(btree);
+		return FALSE;
+	}
+	copytree(btree, pf, ixself(bmaster(btree)));
+	syncpagefile(pf);
+	sprintf(path, "%s/%s", bbasedir(btree), BTPAGEFILE);
+	if (rename(newpath, path)) {
+		closepagefile(pf);
+		unlink(newpath);
+		snapend(btree);
+		return FALSE;
+	}
+	/* btree is now paged, so stop using its own files; operation is
+	 left unfinished, so readers now opening wait & then give up */
+	freefdcache(btree);
+	bpagefile(btree) = pf;
+	removetree(btree, ixself(bmaster(btree)));
+	snapclose(btree);
+	return TRUE;
+}
+/*=============================================
+ * copytree -- Copy btree files below index into paged file
+ *  btree: [IN]  directory btree
+ *  pf:    [IN]  new paged file
+ *  fkey:  [IN]  index or block to copy (with all below it)
+ *===========================================*/
+static void
+copytree (BTREE btree, PAGEFILE pf, FKEY fkey)
+{
+	char path[MAXPATHLEN];
+	INDEX index;
+	INT i;
+
+	sprintf(path, "%s/%s", bbasedir(btree), fkey2path(fkey));
+	loadpages(pf, fkey, path);
+	index = pinindex(btree, fkey);
+	if (ixtype(index) == BTINDEXTYPE) {
+		for (i = 0; i <= nkeys(index); ++i)
+			copytree(btree, pf, fkeys(index, i));
+	}
+	unpinindex(btree, fkey);
+}
+/*=============================================
+ * removetree -- Remove btree files below index from directory
+ *  (& their directories, once empty)
+ *  btree: [IN]  btree just converted to paged
+ *  fkey:  [IN]  index or block to remove (with all below it)
+ *===========================================*/
+static void
+removetree (BTREE btree, FKEY fkey)
+{
+	char path[MAXPATHLEN];
+	INDEX index = pinindex(btree, fkey);
+	INT i;
+
+	if (ixtype(index) == BTINDEXTYPE) {
+		for (i = 0; i <= nkeys(index); ++i)
+			removetree(btree, fkeys(index, i));
+	}
+	unpinindex(btree, fkey);
+	sprintf(path, "%s/%s", bbasedir(btree), fkey2path(fkey));
+	unlink(path);
+	/* fails (harmlessly) until directory is empty */
+	path[strlen(path)-3] = 0;
+	rmdir(path);
+}
+/*=============================================
+ * loadpages -- Copy file into fresh extent of btree file
+ *  pf:   [IN]  paged file
+ *  fkey: [IN]  btree file being replaced (or created)
+ *  file: [IN]  file with new contents
+ *===========================================*/
+static void
+loadpages (PAGEFILE pf, FKEY fkey, STRING file)
+{
+	PAGEEXTENT *ext = findextent(pf, fkey, TRUE), next;
+	char scratch[MAXPATHLEN+64];
+	char page[BUFLEN];
+	struct stat sbuf;
+	FILE *fp;
+	INT done, blklen;
+
+	ASSERT(pf->pf_write);
+	if (stat(file, &sbuf) || !(fp = fopen(file, LLREADBINARY))) {
+		sprintf(scratch, "Failed to open file to add to paged file: %s", file);
+		FATAL2(scratch);
+	}
+	next.e_len = (INT)sbuf.st_size;
+	next.e_pages = pagesfor(next.e_len);
+	next.e_start = allocpages(pf, next.e_pages);
+	for (done = 0; done < next.e_len; done += blklen) {
+		blklen = next.e_len - done;
+		if (blklen > BUFLEN) blklen = BUFLEN;
+		if (fread(page, blklen, 1, fp) != 1
+			|| !pagewrite(pf->pf_fd, page, blklen, (off_t)next.e_start*BUFLEN + done)) {
+			sprintf(scratch, "Error (errno=%d) copying file to paged file: %s"
+				, errno, file);
+			FATAL2(scratch);
+		}
+	}
+	fclose(fp);
+	/* old version is dropped only once new one is in the map */
+	if (ext->e_start)
+		freepages(pf, ext->e_start, ext->e_pages);
+	putextent(pf, fkey, &next);
+}
+/*=============================================
+ * findextent -- Find map entry of btree file
+ *  pf:     [IN]  paged file
+ *  fkey:   [IN]  btree file
+ *  create: [IN]  add map of its directory if missing ?
+ * returns entry in map (e_start is 0 if file does not exist),
+ *  or NULL if there is no map (& create is FALSE)
+ *===========================================*/
+static PAGEEXTENT *
+findextent (PAGEFILE pf, FKEY fkey, BOOLEAN create)
+{
+	INT hi = (fkey >> 16) & 0xffff, lo = fkey & 0xffff, start;
+	PAGEEXTENT *map;
+	char scratch[128];
+
+	if (hi >= PF_NDIRS || lo >= PF_NDIRS) {
+		sprintf(scratch, "Bad file key (%lx) in paged btree", (long)fkey);
+		FATAL2(scratch);
+	}
+	if ((map = pf->pf_maps[hi]) != NULL)
+		return &map[lo];
+	if (!create)
+		return NULL;
+	/* new map is written before header points to it */
+	map = (PAGEEXTENT *) stdalloc(PF_MAPPAGES*BUFLEN);
+	start = allocpages(pf, PF_MAPPAGES);
+	if (!pagewrite(pf->pf_fd, map, PF_MAPPAGES*BUFLEN, (off_t)start*BUFLEN))
+		FATAL2("Error writing map to paged file");
+	pf->pf_hdr.h_maps[hi] = start;
+	if (!pagewrite(pf->pf_fd, &pf->pf_hdr.h_maps[hi], sizeof(INT)
+		, (off_t)((char *)&pf->pf_hdr.h_maps[hi] - (char *)&pf->pf_hdr)))
+		FATAL2("Error writing header of paged file");
+	pf->pf_maps[hi] = map;
+	return &map[lo];
+}
+/*=============================================
+ * putextent -- Update map entry of btree file (in memory & on disk)
+ *===========================================*/
+static void
+putextent (PAGEFILE pf, FKEY fkey, PAGEEXTENT *ext)
+{
+	INT hi = (fkey >> 16) & 0xffff, lo = fkey & 0xffff;
+	off_t off = (off_t)pf->pf_hdr.h_maps[hi]*BUFLEN + lo*sizeof(PAGEEXTENT);
+	pf->pf_maps[hi][lo] = *ext;
+	if (!pagewrite(pf->pf_fd, ext, sizeof(*ext), off))
+		FATAL2("Error writing map of paged file");
+}
+/*=============================================
+ * allocpages -- Find n contiguous free pages (first fit)
+ *  extending file if there are none
+ * returns first page
+ *===========================================*/
+static INT
+allocpages (PAGEFILE pf, INT n)
+{
+	INT start = pf->pf_hint, i;
+	for (i = start; i < pf->pf_npages && i - start < n; ++i) {
+		/* skip quickly over full bytes of map */
+		if (!(i & 7) && pf->pf_used[i >> 3] == 0xff) {
+			i += 7;
+			start = i + 1;
+			continue;
+		}
+		if (pf->pf_used[i >> 3] & (1 << (i & 7)))
+			start = i + 1;
+	}
+	markpages(pf, start, n);
+	return start;
+}
+/*=============================================
+ * freepages -- Return pages to free-page map
+ *===========================================*/
+static void
+freepages (PAGEFILE pf, INT start, INT n)
+{
+	INT i;
+	for (i = start; i < start + n; ++i)
+		pf->pf_used[i >> 3] &= ~(1 << (i & 7));
+	if (start < pf->pf_hint)
+		pf->pf_hint = start;
+}
+/*=============================================
+ * markpages -- Mark pages in use in free-page map
+ *  (growing map, & count of pages, as needed)
+ *===========================================*/
+static void
+markpages (PAGEFILE pf, INT start, INT n)
+{
+	INT i, size;
+	if (start + n > pf->pf_npages)
+		pf->pf_npages = start + n;
+	if (pf->pf_npages > pf->pf_mapsize*8) {
+		size = pf->pf_npages/8 + 1;
+		if (size < 2*pf->pf_mapsize)
+			size = 2*pf->pf_mapsize;
+		pf->pf_used = (unsigned char *) stdrealloc(pf->pf_used, size);
+		memset(pf->pf_used + pf->pf_mapsize, 0, size - pf->pf_mapsize);
+		pf->pf_mapsize = size;
+	}
+	for (i = start; i < start + n; ++i)
+		pf->pf_used[i >> 3] |= (1 << (i & 7));
+	/* hint stays on first free page */
+	while (pf->pf_hint < pf->pf_npages
+		&& (pf->pf_used[pf->pf_hint >> 3] & (1 << (pf->pf_hint & 7))))
+		++pf->pf_hint;
+}
+/*=============================================
+ * pagesfor -- Number of pages to hold len bytes
+ *===========================================*/
+static INT
+pagesfor (INT len)
+{
+	return (len + BUFLEN - 1)/BUFLEN;
+}
+/*=============================================
+ * pageread -- Read exactly len bytes at offset of paged file
+ *===========================================*/
+static BOOLEAN
+pageread (int fd, void *buf, INT len, off_t off)
+{
+	char *p = (char *)buf;
+	while (len > 0) {
+#ifdef HAVE_PREAD
+		ssize_t got = pread(fd, p, (size_t)len, off);
+#else
+		ssize_t got = -1;
+		if (lseek(fd, off, SEEK_SET) == off)
+			got = read(fd, p, (size_t)len);
+#endif
+		if (got <= 0) {
+			if (got < 0 && errno == EINTR) continue;
+			return FALSE;
+		}
+		p += got;
+		off += got;
+		len -= (INT)got;
+	}
+	return TRUE;
+}
+/*=============================================
+ * pagewrite -- Write exactly len bytes at offset of paged file
+ *===========================================*/
+static BOOLEAN
+pagewrite (int fd, const void *buf, INT len, off_t off)
+{
+	const char *p = (const char *)buf;
+	while (len > 0) {
+#ifdef HAVE_PWRITE
+		ssize_t put = pwrite(fd, p, (size_t)len, off);
+#else
+		ssize_t put = -1;
+		if (lseek(fd, off, SEEK_SET) == off)
+			put = write(fd, p, (size_t)len);
+#endif
+		if (put <= 0) {
+			if (put < 0 && errno == EINTR) continue;
+			return FALSE;
+		}
+		p += put;
+		off += put;
+		len -= (INT)put;
+	}
+	return TRUE;
+}
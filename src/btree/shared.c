@@ -0,0 +1,224 @@
+/*
+   Copyright (c) 2026 The LifeLines developers
+   "The MIT license"
+   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+/*=============================================================
+ * shared.c -- Readonly BTREE shared by many threads
+ *  Once bt_setshared is called, bt_getrecord, isrecord and
+ *  cursors may be used from any number of threads at once.
+ *  Index & block headers then come from a cache split into
+ *  shards (by FKEY), each with its own lock, LRU list and
+ *  open descriptors, & are copied out to the caller, so no
+ *  thread holds a pointer another may free. Files are read
+ *  with positioned reads (pread); the paged file needs no
+ *  lock at all, as readonly it is never changed.
+ *  Everything else (eg, traverse_index_blocks) is still only
+ *  for one thread at a time.
+ *   Created: 2026/10
+ *===========================================================*/
+
+#include "sys_inc.h"
+#include "llstdlib.h"
+#include "btreei.h"
+
+#if defined(HAVE_PTHREAD_H) && defined(HAVE_PREAD) && defined(HAVE_PWRITE)
+#define USE_SHARED 1
+#include <pthread.h>
+#endif
+
+/*********************************************
+ * local types
+ *********************************************/
+
+#ifdef USE_SHARED
+/* number of shards (independently locked parts of cache) */
+#define BTSHARDS 16
+/* descriptors kept open by each shard */
+#define BTSHARDFDS 4
+
+typedef struct {
+	pthread_mutex_t h_lock;  /* guards rest of shard */
+	INDEXCACHE      h_cache; /* headers of files of this shard */
+	FDCACHE         h_fds;   /* open files of this shard */
+} BTSHARD;
+
+struct tag_btshared {
+	BTSHARD s_shards[BTSHARDS];
+};
+#endif
+
+/*********************************************
+ * local function prototypes
+ *********************************************/
+
+/* alphabetical */
+#ifdef USE_SHARED
+static BTSHARD *shardof(BTREE btree, FKEY fkey);
+#endif
+
+/*********************************************
+ * local & exported function definitions
+ * body of module
+ *********************************************/
+
+/*=================================
+ * bt_setshared -- Make readonly btree safe for many threads
+ *  btree: [IN]  btree handle (opened readonly)
+ * returns FALSE if btree is writeable, or threads are not
+ *  supported on this platform
+ * Call before starting threads; the index cache budget
+ *  (bt_setcachesize) is divided among the shards
+ *===============================*/
+BOOLEAN
+bt_setshared (BTREE btree)
+{
+#ifdef USE_SHARED
+	BTSHARED sh;
+	INT i, bytes;
+
+	/* snapshot looks for versions of files as it reads them */
+	if (bwrite(btree) || insnapshot(btree))
+		return FALSE;
+	if (bshared(btree))
+		return TRUE;
+	bytes = cachebytes(bcache(btree))/BTSHARDS;
+	sh = (BTSHARED) stdalloc(sizeof(*sh));
+	for (i = 0; i < BTSHARDS; ++i) {
+		BTSHARD *shard = &sh->s_shards[i];
+		pthread_mutex_init(&shard->h_lock, NULL);
+		shard->h_cache = newcache(bytes);
+		shard->h_fds = bpagefile(btree) ? NULL : newfdcache(BTSHARDFDS);
+	}
+	bshared(btree) = sh;
+	return TRUE;
+#else
+	btree=btree; /* unused */
+	return FALSE;
+#endif
+}
+/*=================================
+ * freeshared -- Free shards of btree (when it is closed)
+ *===============================*/
+void
+freeshared (BTREE btree)
+{
+#ifdef USE_SHARED
+	BTSHARED sh = bshared(btree);
+	INT i;
+	if (!sh) return;
+	for (i = 0; i < BTSHARDS; ++i) {
+		BTSHARD *shard = &sh->s_shards[i];
+		dropcache(shard->h_cache);
+		if (shard->h_fds)
+			dropfdcache(shard->h_fds);
+		pthread_mutex_destroy(&shard->h_lock);
+	}
+	stdfree(sh);
+	bshared(btree) = NULL;
+#else
+	btree=btree; /* unused */
+#endif
+}
+/*=================================
+ * sharedindex -- Get copy of index or block header
+ *  btree: [IN]  shared btree
+ *  fkey:  [IN]  index or block wanted
+ *  out:   [OUT] buffer (PAGELEN bytes) for copy
+ * returns out; errors are fatal, as in getindex
+ *===============================*/
+INDEX
+sharedindex (BTREE btree, FKEY fkey, INDEX out)
+{
+#ifdef USE_SHARED
+	BTSHARD *shard;
+	char msg[64], path[6];
+
+	/* master never changes in readonly btree */
+	if (fkey == ixself(bmaster(btree))) {
+		memcpy(out, bmaster(btree), PAGELEN);
+		return out;
+	}
+	shard = shardof(btree, fkey);
+	pthread_mutex_lock(&shard->h_lock);
+	if (copyfromcache(shard->h_cache, fkey, out)) {
+		pthread_mutex_unlock(&shard->h_lock);
+		return out;
+	}
+	pthread_mutex_unlock(&shard->h_lock);
+	/* another thread may read it too; first one cached wins */
+	if (!sharedread(btree, fkey, out, PAGELEN, 0)) {
+		sprintf(msg, "Missing index file: %s", fkeypath(fkey, path));
+		FATAL2(msg);
+	}
+	pthread_mutex_lock(&shard->h_lock);
+	copytocache(shard->h_cache, out);
+	pthread_mutex_unlock(&shard->h_lock);
+	return out;
+#else
+	btree=btree; /* unused */
+	fkey=fkey; /* unused */
+	FATAL();
+	return out;
+#endif
+}
+/*=================================
+ * sharedread -- Read exactly len bytes of btree file
+ *  btree: [IN]  shared btree
+ *  fkey:  [IN]  index or block file
+ *  buf:   [OUT] destination
+ *  len:   [IN]  bytes wanted
+ *  off:   [IN]  offset in file
+ * returns FALSE on error or short file
+ * Shard stays locked during read, so its descriptor cannot
+ *  be closed under it
+ *===============================*/
+BOOLEAN
+sharedread (BTREE btree, FKEY fkey, void *buf, INT len, INT off)
+{
+#ifdef USE_SHARED
+	BTSHARD *shard;
+	BOOLEAN ok;
+	int fd;
+
+	if (bpagefile(btree))
+		return readpages(bpagefile(btree), fkey, buf, len, off);
+	shard = shardof(btree, fkey);
+	pthread_mutex_lock(&shard->h_lock);
+	fd = cachedfd(shard->h_fds, btree, fkey, FALSE);
+	ok = (fd >= 0) && readfilefd(fd, buf, len, off);
+	pthread_mutex_unlock(&shard->h_lock);
+	return ok;
+#else
+	btree=btree; fkey=fkey; buf=buf; len=len; off=off; /* unused */
+	return FALSE;
+#endif
+}
+/*=================================
+ * viewindex -- Get index or block header, to read only
+ *  btree: [IN]  btree
+ *  fkey:  [IN]  index or block wanted
+ *  copy:  [IN]  buffer (PAGELEN bytes), used if btree is shared
+ * returns header in cache, or (if shared) copy of it
+ *===============================*/
+INDEX
+viewindex (BTREE btree, FKEY fkey, INDEX copy)
+{
+	if (bshared(btree))
+		return sharedindex(btree, fkey, copy);
+	return getindex(btree, fkey);
+}
+#ifdef USE_SHARED
+/*=================================
+ * shardof -- Shard that holds file
+ *===============================*/
+static BTSHARD *
+shardof (BTREE btree, FKEY fkey)
+{
+	/* FKEYs are allocated in sequence, so low bits spread well */
+	unsigned int h = (unsigned int)fkey ^ ((unsigned int)fkey >> 16);
+	return &bshared(btree)->s_shards[h % BTSHARDS];
+}
+#endif /* USE_SHARED */
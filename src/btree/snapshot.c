@@ -0,0 +1,681 @@
+/*
+   Copyright (c) 2026 The LifeLines developers
+   "The MIT license"
+   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+/*=============================================================
+ * snapshot.c -- Consistent snapshots of BTREE for readers
+ *  A snapshot reader (bt_opensnapshot) sees the btree just as
+ *  it was when opened, while a writer goes on changing it, and
+ *  neither locks out the other (as k_ostat readers & writers do).
+ *  The writer numbers its operations (generations). While any
+ *  snapshot reader is registered in the snapshot directory
+ *  (BTSNAPDIR), an operation about to replace, change or remove
+ *  an index or block file first keeps the old version there,
+ *  named by FKEY & generation, & appends it to a log of versions
+ *  kept. A reader of generation g reads each file from its first
+ *  version kept after g, if there is one, else from the btree
+ *  itself; it checks only after it has opened or read the file,
+ *  as the version is always kept before the file changes.
+ *  Versions no reader needs are removed as each operation ends.
+ *  Readers that die are noticed by process id, so this is for
+ *  readers & writer on one machine, & only for directory (not
+ *  paged) btrees.
+ *   Created: 2026/10
+ *===========================================================*/
+
+#include "sys_inc.h"
+#include "llstdlib.h"
+#include "btreei.h"
+
+#if defined(HAVE_DIRENT_H) && defined(HAVE_PREAD) && defined(HAVE_PWRITE)
+#define USE_SNAPSHOT 1
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <signal.h>
+#endif
+
+/*********************************************
+ * local types
+ *********************************************/
+
+#ifdef USE_SNAPSHOT
+/* state file of snapshot directory, kept by writer */
+typedef struct {
+	INT  f_magic;  /* SNAPMAGIC */
+	INT  f_gen;    /* operations of writer completed */
+	FKEY f_mkey;   /* master index as of f_gen */
+	INT  f_busy;   /* operation of writer in progress ? */
+	INT  f_kept;   /* versions logged so far (changes as each is kept) */
+	INT  f_base;   /* versions dropped from start of log */
+} SNAPSTATE;
+
+#define SNAPMAGIC 0x50414E53L /* "SNAP" */
+#define SNAPSTATEFILE "state"
+#define SNAPLOGFILE "kept"
+#define SNAPVERSDIR "v"
+
+/* file kept for readers (as logged) */
+typedef struct {
+	FKEY v_fkey;   /* index or block */
+	INT  v_gen;    /* generation of operation that changed it */
+} SNAPVER;
+#endif
+
+struct tag_btsnap {
+#ifdef USE_SNAPSHOT
+	BOOLEAN   s_writer; /* kept by writer (else reader) */
+	int       s_fd;     /* state file (or -1) */
+	int       s_log;    /* log of versions (or -1) */
+	SNAPSTATE s_state;  /* writer: as written; reader: as at open */
+	INT       s_depth;  /* writer: nesting of snapbegin */
+	BOOLEAN   s_keep;   /* writer: keep versions in this operation ? */
+	char      s_reg[MAXPATHLEN]; /* reader: registration file */
+	INT       s_kept;   /* reader: versions of log seen so far */
+	SNAPVER  *s_vers;   /* writer: versions not yet removed (in order kept)
+	                       reader: first version of each file (by fkey) */
+	INT       s_first;  /* writer: first of s_vers not yet removed */
+	INT       s_nvers;  /* entries in s_vers */
+	INT       s_max;    /* room in s_vers */
+#else
+	INT       s_unused;
+#endif
+};
+
+/*********************************************
+ * local function prototypes
+ *********************************************/
+
+/* alphabetical */
+#ifdef USE_SNAPSHOT
+static void addversion(BTSNAP sn, FKEY fkey, INT gen, BOOLEAN byfile);
+static void copyfile(STRING from, STRING to);
+static void dropall(BTREE btree);
+static INT oldestreader(BTREE btree, BOOLEAN *pany);
+static void readlog(BTREE btree, const SNAPSTATE *state, INT from);
+static void reclaim(BTREE btree);
+static void snappath(BTREE btree, CNSTRING name, STRING path, INT len);
+static void verpath(BTREE btree, FKEY fkey, INT gen, STRING path, INT len);
+static void writestate(BTREE btree);
+#endif
+
+/*********************************************
+ * local variables
+ *********************************************/
+
+#ifdef USE_SNAPSHOT
+/* snapshots opened by this process (names registrations) */
+static INT nregs = 0;
+#endif
+
+/*********************************************
+ * local & exported function definitions
+ * body of module
+ *********************************************/
+
+/*=================================
+ * snapopen -- Set up writer's side of snapshots
+ *  btree: [IN]  btree just opened for writing
+ * Without a snapshot directory (eg, paged btree, or it cannot
+ *  be made), no versions are kept & snapshots are not possible
+ *===============================*/
+void
+snapopen (BTREE btree)
+{
+#ifdef USE_SNAPSHOT
+	char scratch[MAXPATHLEN];
+	BTSNAP sn;
+	int fd, log;
+
+	bsnap(btree) = NULL;
+	if (!bwrite(btree) || bpagefile(btree))
+		return;
+	snappath(btree, SNAPVERSDIR, scratch, sizeof(scratch));
+	strcat(scratch, "/");
+	if (!mkalldirs(scratch))
+		return;
+	snappath(btree, SNAPLOGFILE, scratch, sizeof(scratch));
+	if ((log = open(scratch, O_RDWR|O_CREAT, 0666)) < 0)
+		return;
+	snappath(btree, SNAPSTATEFILE, scratch, sizeof(scratch));
+	if ((fd = open(scratch, O_RDWR|O_CREAT, 0666)) < 0) {
+		close(log);
+		return;
+	}
+	sn = (BTSNAP) stdalloc(sizeof(*sn));
+	sn->s_writer = TRUE;
+	sn->s_fd = fd;
+	sn->s_log = log;
+	/* generations go on from last writer, as readers may be using them */
+	if (!readfilefd(fd, &sn->s_state, sizeof(sn->s_state), 0)
+		|| sn->s_state.f_magic != SNAPMAGIC) {
+		memset(&sn->s_state, 0, sizeof(sn->s_state));
+		sn->s_state.f_magic = SNAPMAGIC;
+		ftruncate(log, 0);
+	}
+	/* an operation left unfinished is finished now (see walopen) */
+	sn->s_state.f_busy = 0;
+	sn->s_state.f_mkey = ixself(bmaster(btree));
+	bsnap(btree) = sn;
+	readlog(btree, &sn->s_state, sn->s_state.f_base);
+	writestate(btree);
+	reclaim(btree);
+#else
+	bsnap(btree) = NULL;
+#endif
+}
+/*=================================
+ * snapattach -- Set up reader's side of snapshot
+ *  btree:   [IN]  btree being opened (immutable, master not yet read)
+ *  pmkey:   [I/O] master index from keyfile; replaced by that of snapshot
+ *  lldberr: [OUT] error code (if returns FALSE)
+ * Registers reader, then takes generation of last complete
+ *  operation of writer (waiting a little if one is under way)
+ *===============================*/
+BOOLEAN
+snapattach (BTREE btree, FKEY *pmkey, INT *lldberr)
+{
+#ifdef USE_SNAPSHOT
+	char scratch[MAXPATHLEN], name[64];
+	BTSNAP sn;
+	INT gen = -1, tries;
+	int fd;
+
+	*lldberr = BTERR_SNAPSHOT;
+	if (bpagefile(btree))
+		return FALSE;
+	sn = (BTSNAP) stdalloc(sizeof(*sn));
+	sn->s_writer = FALSE;
+	sn->s_fd = -1;
+	sn->s_log = -1;
+	/* register first (as keeping all versions), so any operation
+	 that starts after this keeps what the snapshot needs */
+	sprintf(name, "r%ld.%ld", (long)getpid(), (long)++nregs);
+	snappath(btree, name, sn->s_reg, sizeof(sn->s_reg));
+	if (!mkalldirs(sn->s_reg)
+		|| (fd = open(sn->s_reg, O_WRONLY|O_CREAT|O_TRUNC, 0666)) < 0) {
+		stdfree(sn);
+		return FALSE;
+	}
+	if (!writefilefd(fd, &gen, sizeof(gen), 0))
+		goto failattach;
+	snappath(btree, SNAPSTATEFILE, scratch, sizeof(scratch));
+	if ((sn->s_fd = open(scratch, O_RDONLY)) < 0) {
+		/* no writer has kept snapshots yet, but none of an
+		 earlier release may be writing either */
+		if (bkfile(btree).k_ostat == -1) {
+			*lldberr = BTERR_WRITER;
+			goto failattach;
+		}
+		memset(&sn->s_state, 0, sizeof(sn->s_state));
+		sn->s_state.f_mkey = *pmkey;
+	} else {
+		for (tries = 0; ; ++tries) {
+			if (!readfilefd(sn->s_fd, &sn->s_state, sizeof(sn->s_state), 0)
+				|| sn->s_state.f_magic != SNAPMAGIC)
+				goto failattach;
+			if (!sn->s_state.f_busy)
+				break;
+			if (tries == BTSNAPWAIT)
+				goto failattach;
+			sleep(1);
+		}
+	}
+	/* versions logged so far are of this generation or before */
+	sn->s_kept = sn->s_state.f_kept;
+	gen = sn->s_state.f_gen;
+	if (!writefilefd(fd, &gen, sizeof(gen), 0))
+		goto failattach;
+	close(fd);
+	*pmkey = sn->s_state.f_mkey;
+	bsnap(btree) = sn;
+	return TRUE;
+
+failattach:
+	close(fd);
+	unlink(sn->s_reg);
+	if (sn->s_fd >= 0)
+		close(sn->s_fd);
+	stdfree(sn);
+	return FALSE;
+#else
+	btree=btree; pmkey=pmkey; /* unused */
+	*lldberr = BTERR_SNAPSHOT;
+	return FALSE;
+#endif
+}
+/*=================================
+ * snapclose -- Finish with snapshots of btree
+ *  (writer removes versions no longer needed,
+ *  reader unregisters)
+ *===============================*/
+void
+snapclose (BTREE btree)
+{
+#ifdef USE_SNAPSHOT
+	BTSNAP sn = bsnap(btree);
+	if (!sn) return;
+	if (sn->s_writer)
+		reclaim(btree);
+	else
+		unlink(sn->s_reg);
+	if (sn->s_fd >= 0)
+		close(sn->s_fd);
+	if (sn->s_log >= 0)
+		close(sn->s_log);
+	if (sn->s_vers)
+		stdfree(sn->s_vers);
+	stdfree(sn);
+#endif
+	bsnap(btree) = NULL;
+}
+/*=================================
+ * insnapshot -- Is btree open as snapshot reader ?
+ *===============================*/
+BOOLEAN
+insnapshot (BTREE btree)
+{
+#ifdef USE_SNAPSHOT
+	return bsnap(btree) && !bsnap(btree)->s_writer;
+#else
+	btree=btree; /* unused */
+	return FALSE;
+#endif
+}
+/*=================================
+ * snapreaders -- Are any snapshot readers using btree ?
+ *  btree: [IN]  writeable btree
+ *===============================*/
+BOOLEAN
+snapreaders (BTREE btree)
+{
+#ifdef USE_SNAPSHOT
+	BOOLEAN any = FALSE;
+	if (bsnap(btree) && bsnap(btree)->s_writer)
+		oldestreader(btree, &any);
+	return any;
+#else
+	btree=btree; /* unused */
+	return FALSE;
+#endif
+}
+/*=================================
+ * snapbegin -- Start operation of writer
+ *  btree: [IN]  btree
+ * Operations nest; only the outermost counts
+ *===============================*/
+void
+snapbegin (BTREE btree)
+{
+#ifdef USE_SNAPSHOT
+	BTSNAP sn = bsnap(btree);
+	if (!sn || !sn->s_writer || sn->s_depth++)
+		return;
+	/* say so before looking for readers, so a reader registering
+	 meanwhile either is seen, or sees this & waits */
+	sn->s_state.f_busy = 1;
+	writestate(btree);
+	oldestreader(btree, &sn->s_keep);
+#else
+	btree=btree; /* unused */
+#endif
+}
+/*=================================
+ * snapend -- Finish operation of writer
+ *  btree: [IN]  btree
+ * Outermost one makes the new generation current
+ *===============================*/
+void
+snapend (BTREE btree)
+{
+#ifdef USE_SNAPSHOT
+	BTSNAP sn = bsnap(btree);
+	if (!sn || !sn->s_writer || --sn->s_depth)
+		return;
+	++sn->s_state.f_gen;
+	sn->s_state.f_mkey = ixself(bmaster(btree));
+	sn->s_state.f_busy = 0;
+	writestate(btree);
+	sn->s_keep = FALSE;
+	if (sn->s_first < sn->s_nvers)
+		reclaim(btree);
+#else
+	btree=btree; /* unused */
+#endif
+}
+/*=================================
+ * keepversion -- Keep file for snapshot readers before it changes
+ *  btree:   [IN]  btree (in operation of writer, see snapbegin)
+ *  fkey:    [IN]  index or block about to change
+ *  inplace: [IN]  is file to be written in place (so must be copied) ?
+ *                 (else it is to be replaced or removed, & is linked)
+ * Does nothing unless some snapshot reader is registered, or
+ *  if file was already kept in this operation, or does not exist
+ *===============================*/
+void
+keepversion (BTREE btree, FKEY fkey, BOOLEAN inplace)
+{
+#ifdef USE_SNAPSHOT
+	char from[MAXPATHLEN], to[MAXPATHLEN];
+	BTSNAP sn = bsnap(btree);
+	struct stat sbuf;
+	SNAPVER ver;
+
+	if (!sn || !sn->s_keep)
+		return;
+	ver.v_fkey = fkey;
+	ver.v_gen = sn->s_state.f_gen + 1;
+	verpath(btree, fkey, ver.v_gen, to, sizeof(to));
+	sprintf(from, "%s/%s", bbasedir(btree), fkey2path(fkey));
+	if (!stat(to, &sbuf) || stat(from, &sbuf))
+		return;
+	if (inplace || link(from, to))
+		copyfile(from, to);
+	/* tell readers, before file changes */
+	if (!writefilefd(sn->s_log, &ver, sizeof(ver)
+		, (sn->s_state.f_kept - sn->s_state.f_base)*sizeof(ver)))
+		FATAL2("Failed to log version of btree file");
+	addversion(sn, fkey, ver.v_gen, FALSE);
+	++sn->s_state.f_kept;
+	writestate(btree);
+#else
+	btree=btree; fkey=fkey; inplace=inplace; /* unused */
+#endif
+}
+/*=================================
+ * snapfile -- Find version of file for snapshot reader
+ *  btree: [IN]  btree
+ *  fkey:  [IN]  index or block (just opened or read from btree)
+ *  path:  [OUT] file to use instead
+ *  len:   [IN]  size of path
+ * returns FALSE if file of btree itself is right for the snapshot
+ *  (always, unless btree is snapshot reader)
+ *===============================*/
+BOOLEAN
+snapfile (BTREE btree, FKEY fkey, STRING path, INT len)
+{
+#ifdef USE_SNAPSHOT
+	BTSNAP sn = bsnap(btree);
+	SNAPSTATE state;
+	SNAPVER *ver;
+	INT lo, hi;
+
+	if (!sn || sn->s_writer)
+		return FALSE;
+	if (sn->s_fd < 0) {
+		/* no writer yet when snapshot was taken */
+		char scratch[MAXPATHLEN];
+		snappath(btree, SNAPSTATEFILE, scratch, sizeof(scratch));
+		if ((sn->s_fd = open(scratch, O_RDONLY)) < 0)
+			return FALSE;
+	}
+	if (!readfilefd(sn->s_fd, &state, sizeof(state), 0)
+		|| state.f_magic != SNAPMAGIC)
+		return FALSE;
+	if (state.f_kept > sn->s_kept) {
+		/* log may have been emptied, but only while no reader was
+		 registered, so this snapshot needs none it dropped */
+		readlog(btree, &state, sn->s_kept > state.f_base ? sn->s_kept : state.f_base);
+		sn->s_kept = state.f_kept;
+	}
+	lo = 0;
+	hi = sn->s_nvers - 1;
+	while (lo <= hi) {
+		INT md = (lo + hi)/2;
+		ver = &sn->s_vers[md];
+		if (ver->v_fkey == fkey) {
+			verpath(btree, fkey, ver->v_gen, path, len);
+			return TRUE;
+		}
+		if (ver->v_fkey < fkey)
+			lo = md + 1;
+		else
+			hi = md - 1;
+	}
+	return FALSE;
+#else
+	btree=btree; fkey=fkey; path=path; len=len; /* unused */
+	return FALSE;
+#endif
+}
+#ifdef USE_SNAPSHOT
+/*=================================
+ * readlog -- Read versions from log
+ *  btree: [IN]  btree
+ *  state: [IN]  state file as just read
+ *  from:  [IN]  first version wanted (counting from start of log)
+ * Writer takes all of them; reader, only the first one after its
+ *  snapshot, of each file
+ *===============================*/
+static void
+readlog (BTREE btree, const SNAPSTATE *state, INT from)
+{
+	char scratch[MAXPATHLEN];
+	BTSNAP sn = bsnap(btree);
+	INT i, n = state->f_kept - from;
+	SNAPVER *vers;
+
+	if (n <= 0)
+		return;
+	if (sn->s_log < 0) {
+		snappath(btree, SNAPLOGFILE, scratch, sizeof(scratch));
+		if ((sn->s_log = open(scratch, O_RDONLY)) < 0)
+			FATAL2("Missing log of btree snapshot versions");
+	}
+	vers = (SNAPVER *) stdalloc(n*sizeof(SNAPVER));
+	if (!readfilefd(sn->s_log, vers, n*sizeof(SNAPVER)
+		, (from - state->f_base)*sizeof(SNAPVER)))
+		FATAL2("Failed to read log of btree snapshot versions");
+	for (i = 0; i < n; ++i) {
+		if (sn->s_writer || vers[i].v_gen > sn->s_state.f_gen)
+			addversion(sn, vers[i].v_fkey, vers[i].v_gen, !sn->s_writer);
+	}
+	stdfree(vers);
+}
+/*=================================
+ * addversion -- Add version to list of snapshot
+ *  sn:     [IN]  snapshot
+ *  fkey:   [IN]  file
+ *  gen:    [IN]  generation kept
+ *  byfile: [IN]  keep list in order of file, one per file ?
+ *                (else append)
+ *===============================*/
+static void
+addversion (BTSNAP sn, FKEY fkey, INT gen, BOOLEAN byfile)
+{
+	INT lo = sn->s_nvers, hi;
+	if (byfile) {
+		/* versions come in order kept, so the first one stays */
+		lo = 0;
+		hi = sn->s_nvers - 1;
+		while (lo <= hi) {
+			INT md = (lo + hi)/2;
+			if (sn->s_vers[md].v_fkey == fkey)
+				return;
+			if (sn->s_vers[md].v_fkey < fkey)
+				lo = md + 1;
+			else
+				hi = md - 1;
+		}
+	}
+	if (sn->s_nvers == sn->s_max) {
+		SNAPVER *old = sn->s_vers;
+		sn->s_max = sn->s_max ? 2*sn->s_max : 64;
+		sn->s_vers = (SNAPVER *) stdalloc(sn->s_max*sizeof(SNAPVER));
+		if (old) {
+			memcpy(sn->s_vers, old, sn->s_nvers*sizeof(SNAPVER));
+			stdfree(old);
+		}
+	}
+	memmove(&sn->s_vers[lo+1], &sn->s_vers[lo]
+		, (sn->s_nvers - lo)*sizeof(SNAPVER));
+	sn->s_vers[lo].v_fkey = fkey;
+	sn->s_vers[lo].v_gen = gen;
+	++sn->s_nvers;
+}
+/*=================================
+ * oldestreader -- Find oldest snapshot still registered
+ *  btree: [IN]  btree
+ *  pany:  [OUT] any readers registered ?
+ * returns its generation (-1 if one is still registering)
+ * Registrations of processes that have died are removed
+ *===============================*/
+static INT
+oldestreader (BTREE btree, BOOLEAN *pany)
+{
+	char scratch[MAXPATHLEN];
+	struct dirent *de;
+	INT oldest = 0;
+	long pid, n;
+	DIR *dir;
+	int fd;
+
+	*pany = FALSE;
+	snappath(btree, "", scratch, sizeof(scratch));
+	if (!(dir = opendir(scratch)))
+		return oldest;
+	while ((de = readdir(dir)) != NULL) {
+		INT gen = -1;
+		if (sscanf(de->d_name, "r%ld.%ld", &pid, &n) != 2)
+			continue;
+		snappath(btree, de->d_name, scratch, sizeof(scratch));
+		if (kill((pid_t)pid, 0) && errno == ESRCH) {
+			unlink(scratch);
+			continue;
+		}
+		/* unreadable counts as still registering */
+		if ((fd = open(scratch, O_RDONLY)) >= 0) {
+			if (!readfilefd(fd, &gen, sizeof(gen), 0))
+				gen = -1;
+			close(fd);
+		}
+		if (!*pany || gen < oldest)
+			oldest = gen;
+		*pany = TRUE;
+	}
+	closedir(dir);
+	return oldest;
+}
+/*=================================
+ * reclaim -- Remove versions no reader needs any more
+ *  (those of generations no later than the oldest snapshot)
+ * With no readers at all, log is emptied too
+ *===============================*/
+static void
+reclaim (BTREE btree)
+{
+	char scratch[MAXPATHLEN];
+	BTSNAP sn = bsnap(btree);
+	BOOLEAN any;
+	INT oldest = oldestreader(btree, &any);
+	SNAPVER *ver;
+
+	if (!any) {
+		dropall(btree);
+		return;
+	}
+	/* versions are in order kept, so in order of generation */
+	for ( ; sn->s_first < sn->s_nvers; ++sn->s_first) {
+		ver = &sn->s_vers[sn->s_first];
+		if (ver->v_gen > oldest)
+			break;
+		verpath(btree, ver->v_fkey, ver->v_gen, scratch, sizeof(scratch));
+		unlink(scratch);
+	}
+}
+/*=================================
+ * dropall -- Remove all versions & empty log
+ *  (when no reader is registered)
+ * Directory is swept, to catch any left by a writer that crashed
+ *===============================*/
+static void
+dropall (BTREE btree)
+{
+	char scratch[MAXPATHLEN];
+	BTSNAP sn = bsnap(btree);
+	struct dirent *de;
+	DIR *dir;
+
+	if (sn->s_state.f_base == sn->s_state.f_kept)
+		return; /* nothing kept since last time */
+	snappath(btree, SNAPVERSDIR, scratch, sizeof(scratch));
+	if ((dir = opendir(scratch)) != NULL) {
+		while ((de = readdir(dir)) != NULL) {
+			if (de->d_name[0] != 'v')
+				continue;
+			snprintf(scratch, sizeof(scratch), "%s%c%s%c%s%c%s"
+				, bbasedir(btree), LLCHRDIRSEPARATOR, BTSNAPDIR
+				, LLCHRDIRSEPARATOR, SNAPVERSDIR, LLCHRDIRSEPARATOR
+				, de->d_name);
+			unlink(scratch);
+		}
+		closedir(dir);
+	}
+	ftruncate(sn->s_log, 0);
+	sn->s_state.f_base = sn->s_state.f_kept;
+	sn->s_first = sn->s_nvers = 0;
+	writestate(btree);
+}
+/*=================================
+ * copyfile -- Copy file (to version of it)
+ *  written under temporary name & then renamed, so readers
+ *  never see it incomplete
+ *===============================*/
+static void
+copyfile (STRING from, STRING to)
+{
+	char temp[MAXPATHLEN+8], buffer[BUFLEN];
+	FILE *fi, *fo;
+	size_t n;
+
+	snprintf(temp, sizeof(temp), "%s.tmp", to);
+	if (!(fi = fopen(from, LLREADBINARY)) || !(fo = fopen(temp, LLWRITEBINARY))) {
+		char msg[sizeof(temp)+64];
+		sprintf(msg, "Failed to keep version of btree file: %s", from);
+		FATAL2(msg);
+	}
+	while ((n = fread(buffer, 1, sizeof(buffer), fi)) > 0)
+		CHECKED_fwrite(buffer, n, 1, fo, temp);
+	fclose(fi);
+	CHECKED_fclose(fo, temp);
+	if (rename(temp, to)) {
+		char msg[sizeof(temp)+64];
+		sprintf(msg, "Failed to keep version of btree file: %s", from);
+		FATAL2(msg);
+	}
+}
+/*=================================
+ * writestate -- Write state file (writer only)
+ *===============================*/
+static void
+writestate (BTREE btree)
+{
+	BTSNAP sn = bsnap(btree);
+	if (!writefilefd(sn->s_fd, &sn->s_state, sizeof(sn->s_state), 0))
+		FATAL2("Failed to write btree snapshot state");
+}
+/*=================================
+ * snappath -- Path of file in snapshot directory
+ *  (or of directory itself, if name is empty)
+ *===============================*/
+static void
+snappath (BTREE btree, CNSTRING name, STRING path, INT len)
+{
+	snprintf(path, len, "%s%c%s%c%s", bbasedir(btree), LLCHRDIRSEPARATOR
+		, BTSNAPDIR, LLCHRDIRSEPARATOR, name);
+}
+/*=================================
+ * verpath -- Path of version of file
+ *===============================*/
+static void
+verpath (BTREE btree, FKEY fkey, INT gen, STRING path, INT len)
+{
+	char name[40];
+	sprintf(name, "%s%cv%08lx.%ld", SNAPVERSDIR, LLCHRDIRSEPARATOR
+		, (long)fkey, (long)gen);
+	snappath(btree, name, path, len);
+}
+#endif /* USE_SNAPSHOT */
@@ -0,0 +1,106 @@
+/*
+   Copyright (c) 2026 The LifeLines developers
+   "The MIT license"
+   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+/*=============================================================
+ * stats.c -- Counters of BTREE I/O activity
+ *  The counters (BTCOUNTERS) are bumped where the work is done
+ *  (see btcount), & may be read by the client at any time, or
+ *  logged to a file every so many records, to help size the
+ *  caches or find where the time goes.
+ *   Created: 2026/10
+ *===========================================================*/
+
+#include "sys_inc.h"
+#include "llstdlib.h"
+#include "btreei.h"
+#include "log.h"
+
+/*********************************************
+ * local & exported function definitions
+ * body of module
+ *********************************************/
+
+/*=================================
+ * bt_getcounters -- Get counters of btree
+ *  btree: [IN]  btree handle
+ *  cnts:  [OUT] copy of counters (since open or last reset)
+ *===============================*/
+void
+bt_getcounters (BTREE btree, BTCOUNTERS *cnts)
+{
+	*cnts = bcounters(btree);
+}
+/*=================================
+ * bt_resetcounters -- Set counters of btree back to zero
+ *===============================*/
+void
+bt_resetcounters (BTREE btree)
+{
+	memset(&bcounters(btree), 0, sizeof(bcounters(btree)));
+}
+/*=================================
+ * bt_formatcounters -- Describe counters in one line
+ *  cnts:   [IN]  counters
+ *  buf:    [OUT] description (name=value pairs)
+ *  buflen: [IN]  size of buf
+ *===============================*/
+void
+bt_formatcounters (const BTCOUNTERS *cnts, STRING buf, INT buflen)
+{
+	snprintf(buf, buflen
+		, "gets=%ld adds=%ld hits=%ld misses=%ld opens=%ld readrecs=%ld"
+		" read=%ld written=%ld blocksplits=%ld indexsplits=%ld moves=%ld"
+		, cnts->c_gets, cnts->c_adds, cnts->c_hits, cnts->c_misses
+		, cnts->c_opens, cnts->c_readrecs, cnts->c_bytesread
+		, cnts->c_byteswritten, cnts->c_blocksplits, cnts->c_indexsplits
+		, cnts->c_moves);
+}
+/*=================================
+ * bt_setstatslog -- Log counters of btree to file as it is used
+ *  btree: [IN]  btree handle
+ *  path:  [IN]  log file (appended to), or NULL to stop logging
+ *  every: [IN]  records (looked up or added) between entries
+ *                (0 for default); counters are also logged at close
+ *===============================*/
+void
+bt_setstatslog (BTREE btree, CNSTRING path, INT every)
+{
+	if (btree->b_statslog) {
+		stdfree(btree->b_statslog);
+		btree->b_statslog = NULL;
+	}
+	if (path && path[0])
+		btree->b_statslog = strsave(path);
+	btree->b_statsevery = (every > 0) ? every : BTSTATSEVERY;
+}
+/*=================================
+ * logcounters -- Append counters of btree to its log (if any)
+ *  btree: [IN]  btree handle
+ *  why:   [IN]  occasion of entry (eg, "close")
+ *===============================*/
+void
+logcounters (BTREE btree, CNSTRING why)
+{
+	char buffer[256];
+	if (!btree->b_statslog)
+		return;
+	bt_formatcounters(&bcounters(btree), buffer, sizeof(buffer));
+	log_outf(btree->b_statslog, "btree %s %s: %s", bbasedir(btree), why, buffer);
+}
+/*=================================
+ * tickcounters -- Note one more record looked up or added
+ *  (after it is counted), logging counters if it is time
+ *===============================*/
+void
+tickcounters (BTREE btree)
+{
+	if (!btree->b_statslog)
+		return;
+	if ((bcounters(btree).c_gets + bcounters(btree).c_adds)
+		% btree->b_statsevery == 0)
+		logcounters(btree, "after");
+}
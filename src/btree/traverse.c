@@ -37,8 +37,7 @@
  *********************************************/
 
 /* alphabetical */
-static BOOLEAN traverse_block(BTREE btree, BLOCK block, RKEY lo, RKEY hi, TRAV_RECORD_FUNC_BYKEY, void * param);
-static BOOLEAN traverse_index(BTREE btree, INDEX index, RKEY lo, RKEY hi, TRAV_RECORD_FUNC_BYKEY, void * param);
+static void addstats(BTREE btree, INDEX index, INT level, BTSTATS *stats);
 
 /*********************************************
  * local function definitions
@@ -80,104 +79,69 @@ traverse_index_blocks (BTREE btree, INDEX index, void *param
 		return (*dfunc)(btree, (BLOCK)index, param);
 	return TRUE;
 }
-/*====================================================
- * traverse_block -- traverse subtree whilst under key
+/*==============================================
+ * traverse_db_rec_rkeys -- traverse a span of records
+ *  using rkeys (see bt_cursor_open)
  *  either lo or hi can have 0 as its first character
- *  (which means unspecified)
  * NB: This covers all records, including DELE records.
- * this calls getindex, so it uses the index cache
- * callback may modify the data, but it won't be updated into db
- *==================================================*/
-static BOOLEAN
-traverse_block (BTREE btree, BLOCK block, RKEY lo, RKEY hi, TRAV_RECORD_FUNC_BYKEY func, void * param)
-{
-	STRING p;
-	INT i, len;
-	RAWRECORD rawrec;
-	INT nkeys=nkeys(block); /* caller loaded block */
-	FKEY nfkeyme = ixself(block);
-	for (i=0; i<nkeys;i++)
-	{
-		if (i) {
-			/* reload block (lest callback purged it from cache) */
-			INDEX index1 = getindex(btree, nfkeyme);
-			ASSERT(ixtype(index1)==BTBLOCKTYPE);
-			block=(BLOCK)index1;
-		}
-		if (lo.r_rkey[0] && ll_strncmp(lo.r_rkey, rkeys(block, i).r_rkey, 8) >= 0)
-			continue;
-		if (hi.r_rkey[0] && ll_strncmp(hi.r_rkey, rkeys(block, i).r_rkey, 8) < 0)
-			continue;
-		rawrec = readrec(btree, block, i, &len);
-		/*
-		NB: rawrec could be NULL if len of record was 0 
-		I don't know if this would ever happen - Perry, 2001/05/26
-		*/
-		p = rawrec;
-		if (!(*func)(rkeys(block,i), p, len, param))
-			return FALSE;
-	}
-	return TRUE;
-}
-/*====================================================
- * traverse_index -- traverse subtree whilst under key
- *  either lo or hi can have 0 as its first character
  * callback may modify the data, but it won't be updated into db
- *==================================================*/
-static BOOLEAN
-traverse_index (BTREE btree, INDEX index, RKEY lo, RKEY hi, TRAV_RECORD_FUNC_BYKEY func, void * param)
+ *============================================*/
+void
+traverse_db_rec_rkeys (BTREE btree, RKEY lo, RKEY hi, TRAV_RECORD_FUNC_BYKEY func, void * param)
 {
-	INDEX index1;
-	BLOCK block1;
-	SHORT i, n, ilo;
-	FKEY nfkey;
-	FKEY nfkeyme = ixself(index);
-
-	i=1;
-	n = nkeys(index); /* caller loaded index */
-	/* advance over any below lo */
-	if (lo.r_rkey[0]) {
-		for (i=1; i<=n; i++) {
-			if (ll_strncmp(lo.r_rkey, rkeys(index, i).r_rkey, 8) < 0)
-				break;
-		}
-	}
-	ilo=i;
-	/* process all until above hi */
-	for ( ; i<=n+1; i++) {
-		if (i!=ilo) {
-			/* reload index (lest callback purged it from cache) */
-			index = getindex(btree, nfkeyme);
-			ASSERT(ixtype(index)==BTINDEXTYPE);
-		}
-		if (hi.r_rkey[0] && ll_strncmp(hi.r_rkey, rkeys(index, i-1).r_rkey, 8) < 0)
+	BTCURSOR cursor = bt_cursor_open(btree, lo, hi);
+	RKEY rkey;
+	STRING rec;
+	INT len;
+	while (bt_cursor_next(cursor, &rkey, &rec, &len)) {
+		if (!(*func)(rkey, rec, len, param))
 			break;
-		nfkey = fkeys(index, i-1);
-		index1 = getindex(btree, nfkey);
-		if (ixtype(index1) == BTINDEXTYPE) {
-			if (!traverse_index(btree, index1, lo, hi, func, param))
-				return FALSE;
-		} else {
-			ASSERT(ixtype(index1) == BTBLOCKTYPE);
-			block1 = (BLOCK)index1;
-			if (!traverse_block(btree, block1, lo, hi, func, param))
-				return FALSE;
-		}
 	}
-	return TRUE;
+	bt_cursor_close(cursor);
 }
 /*==============================================
- * traverse_db_rec_rkeys -- traverse a span of records
- *  using rkeys
- *  either lo or hi can have 0 as its first character
- * NB: This covers all records, including DELE records.
- * callback may modify the data, but it won't be updated into db
+ * bt_treestats -- Measure shape & size of btree
+ *  btree:  [in]  btree
+ *  stats:  [out] levels, files, records & bytes
+ * reads every index & block header (skipping the index
+ *  cache, like traverse_index_blocks)
  *============================================*/
 void
-traverse_db_rec_rkeys (BTREE btree, RKEY lo, RKEY hi, TRAV_RECORD_FUNC_BYKEY func, void * param)
+bt_treestats (BTREE btree, BTSTATS *stats)
 {
-	INDEX index;
-	ASSERT(index = bmaster(btree));
-	traverse_index(btree, index, lo, hi, func, param);
+	memset(stats, 0, sizeof(*stats));
+	addstats(btree, bmaster(btree), 1, stats);
 }
+/*==============================================
+ * addstats -- Add index or block (& all below it) to stats
+ *  level:  [in] level of index (master is 1)
+ *============================================*/
+static void
+addstats (BTREE btree, INDEX index, INT level, BTSTATS *stats)
+{
+	INDEX child;
+	BLOCK block;
+	INT i, end = 0;
 
+	if (ixtype(index) == BTINDEXTYPE) {
+		if (level > stats->s_levels)
+			stats->s_levels = level;
+		++stats->s_indexes;
+		stats->s_bytes += PAGELEN;
+		for (i = 0; i <= nkeys(index); i++) {
+			child = readindex(btree, fkeys(index, i), FALSE);
+			addstats(btree, child, level+1, stats);
+			stdfree(child);
+		}
+		return;
+	}
+	block = (BLOCK) index;
+	++stats->s_blocks;
+	stats->s_records += nkeys(block);
+	/* offsets need not be in order (see appendrecord) */
+	for (i = 0; i < nkeys(block); i++) {
+		if (offs(block, i) + lens(block, i) > end)
+			end = offs(block, i) + lens(block, i);
+	}
+	stats->s_bytes += PAGELEN + end;
+}
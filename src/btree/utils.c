@@ -33,7 +33,61 @@
 #include "llstdlib.h"
 #include "btreei.h"
 
+/*********************************************
+ * local types
+ *********************************************/
 
+/* layout of headers of given length (see comments at INDEX & BLOCK) */
+#define G_NOENTS(len) (((len)-12)/12)
+#define G_NORECS(len) (((len)-12)/16)
+#define G_RKEYOFF ((INT)offsetof(INDEXSTRUCT, ix_rkeys))
+#define G_ALIGN(n) (((n) + (INT)sizeof(INT) - 1) & ~((INT)sizeof(INT) - 1))
+#define G_FKEYOFF(len) G_ALIGN(G_RKEYOFF + G_NOENTS(len)*(INT)sizeof(RKEY))
+#define G_OFFSOFF(len) G_ALIGN(G_RKEYOFF + G_NORECS(len)*(INT)sizeof(RKEY))
+#define G_LENSOFF(len) (G_OFFSOFF(len) + G_NORECS(len)*(INT)sizeof(INT))
+
+/*********************************************
+ * global/exported variables
+ *********************************************/
+
+BTGEOMETRY btgeom = {
+	BUFLEN, G_NOENTS(BUFLEN), G_NORECS(BUFLEN)
+	, G_FKEYOFF(BUFLEN), G_OFFSOFF(BUFLEN), G_LENSOFF(BUFLEN)
+};
+
+/*********************************************
+ * local & exported function definitions
+ * body of module
+ *********************************************/
+
+/*=========================================
+ * setpagelen -- Set layout of headers of open btree(s)
+ *  pagelen: [IN]  size of headers (BUFLEN<<0 to BTMAXPAGELEN)
+ *=======================================*/
+void
+setpagelen (INT pagelen)
+{
+	btgeom.g_pagelen = pagelen;
+	btgeom.g_noents = G_NOENTS(pagelen);
+	btgeom.g_norecs = G_NORECS(pagelen);
+	btgeom.g_fkeyoff = G_FKEYOFF(pagelen);
+	btgeom.g_offsoff = G_OFFSOFF(pagelen);
+	btgeom.g_lensoff = G_LENSOFF(pagelen);
+}
+/*=========================================
+ * validpagelen -- Is this a supported size of headers ?
+ *  (BUFLEN times a power of 2, up to BTMAXPAGELEN)
+ *=======================================*/
+BOOLEAN
+validpagelen (INT pagelen)
+{
+	INT len;
+	for (len = BUFLEN; len <= BTMAXPAGELEN; len *= 2) {
+		if (len == pagelen)
+			return TRUE;
+	}
+	return FALSE;
+}
 /*=========================================
  * rkey2str -- Convert record key to STRING
  *  returns static buffer
@@ -86,6 +140,17 @@ STRING
 fkey2path (FKEY fkey)
 {
 	static char path[6];
+	return fkeypath(fkey, path);
+}
+/*======================================
+ * fkeypath -- Convert file key to path, in caller's buffer
+ *  fkey:  [IN]  file key
+ *  path:  [OUT] buffer (6 bytes)
+ * returns path; unlike fkey2path, safe for concurrent callers
+ *====================================*/
+STRING
+fkeypath (FKEY fkey, STRING path)
+{
 	SHORT hi = (fkey & 0xffff0000) >> 16;
 	SHORT lo = fkey & 0xffff;
 	path[0] = hi/26 + 'a';
@@ -115,8 +180,9 @@ nextfkey (BTREE btree)
 	else {
 		fkey += 0x20000;
 		fkey &= 0xffff0000;
+		/* paged btree has no directories for its files */
 		sprintf(scratch, "%s/%s", btree->b_basedir, fkey2path(fkey));
-		if (!mkalldirs(scratch))
+		if (!bpagefile(btree) && !mkalldirs(scratch))
 			FATAL();
 	}
 	btree->b_kfile.k_fkey = fkey;
@@ -140,3 +206,17 @@ newmaster (BTREE btree, INDEX master)
 	}
 	btree->b_master = master;
 }
+/*==========================================
+ * syncfile -- Flush file through to disk
+ *  fp:       [in] open file
+ *  filename: [in] name for error message
+ * (only flushes stdio buffers where fsync is not available)
+ *========================================*/
+void
+syncfile (FILE *fp, STRING filename)
+{
+	CHECKED_fflush(fp, filename);
+#ifdef HAVE_FSYNC
+	fsync(fileno(fp));
+#endif
+}
@@ -0,0 +1,540 @@
+/*
+   Copyright (c) 2026 The LifeLines developers
+   "The MIT license"
+   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+/*=============================================================
+ * wal.c -- Write-ahead log & group commit for BTREE
+ *  Between bt_begin_batch & bt_commit_batch, bt_addrecord
+ *  appends records to the log file (BTWALFILE in the database
+ *  directory) and keeps the latest version of each in memory,
+ *  instead of rewriting a data block per record.
+ *  On commit the log is forced to disk once (group commit), and
+ *  then all pending records are checkpointed into the data blocks,
+ *  each block being rewritten once (see addrecs.c).
+ *  If the program dies before a checkpoint completes, the
+ *  committed part of the log is replayed at the next open,
+ *  & records after the last commit are dropped, so a batch
+ *  is all-or-nothing (unless so large it is checkpointed
+ *  early, see BTWALMAXBYTES).
+ *   Created: 2026/10
+ *===========================================================*/
+
+#include "sys_inc.h"
+#include "llstdlib.h"
+#include "btreei.h"
+
+/*********************************************
+ * local types
+ *********************************************/
+
+/* record entry in log file (followed by w_len bytes of data) */
+typedef struct {
+	INT  w_magic;  /* WALMAGIC */
+	INT  w_type;   /* WAL_RECORD or WAL_COMMIT */
+	RKEY w_rkey;   /* key of record (unused for commit) */
+	INT  w_len;    /* length of record data */
+	INT  w_sum;    /* checksum of entry (see walsum) */
+} WALENTRY;
+
+#define WALMAGIC 0x4C41574CL /* "LWAL" */
+enum { WAL_RECORD=1, WAL_COMMIT };
+
+/* record pending checkpoint */
+typedef struct tag_walrec {
+	RKEY      p_rkey;  /* key of record */
+	RAWRECORD p_rec;   /* data of latest version */
+	INT       p_len;   /* length of data */
+	struct tag_walrec *p_next; /* next in hash chain */
+} *WALREC;
+
+struct tag_wal {
+	FILE   *wl_fp;       /* log file (opened at first record) */
+	INT     wl_depth;    /* nesting of bt_begin_batch */
+	INT     wl_count;    /* records pending checkpoint */
+	INT     wl_bytes;    /* data bytes pending checkpoint */
+	INT     wl_logged;   /* bytes written to log since checkpoint */
+	INT     wl_nbuckets; /* size of hash table (power of 2) */
+	WALREC *wl_buckets;  /* pending records by key */
+};
+
+/* initial hash table size (must be power of 2) */
+#define WALMINBUCKETS 256
+
+/*********************************************
+ * local function prototypes
+ *********************************************/
+
+/* alphabetical */
+static void addpending(WAL wal, RKEY rkey, CNSTRING rec, INT len);
+static int cmpaddrecs(const void *el1, const void *el2);
+static void clearpending(WAL wal);
+static WAL getwal(BTREE btree);
+static void growbuckets(WAL wal);
+static INT loadlog(BTREE btree);
+static WALREC *findpending(WAL wal, const RKEY *rkey);
+static INT rkeyhash(WAL wal, const RKEY *rkey);
+static INT walsum(WALENTRY *entry, CNSTRING rec);
+static void walpath(BTREE btree, STRING path, INT len);
+static void writeentry(BTREE btree, INT type, const RKEY *rkey, CNSTRING rec, INT len);
+
+/*********************************************
+ * local & exported function definitions
+ * body of module
+ *********************************************/
+
+/*=================================
+ * bt_begin_batch -- Start group of record updates
+ *  btree:  [in] writeable btree
+ * Until the matching bt_commit_batch, records added are
+ * logged & held in memory; calls may be nested
+ *===============================*/
+void
+bt_begin_batch (BTREE btree)
+{
+	if (!bwrite(btree)) return;
+	++getwal(btree)->wl_depth;
+}
+/*=================================
+ * bt_commit_batch -- Finish group of record updates
+ *  btree:  [in] writeable btree
+ * When outermost batch ends, log is forced to disk & then
+ * checkpointed into the data blocks
+ *===============================*/
+void
+bt_commit_batch (BTREE btree)
+{
+	WAL wal = bwal(btree);
+	if (!wal || !wal->wl_depth) return;
+	if (--wal->wl_depth == 0)
+		walcheckpoint(btree);
+}
+/*=================================
+ * waladdrecord -- Log record update if batch is in progress
+ *  btree:  [in] btree
+ *  rkey:   [in] key of record
+ *  rec:    [in] record data (copied)
+ *  len:    [in] length of record data
+ * returns FALSE if record must be written to blocks directly
+ *===============================*/
+BOOLEAN
+waladdrecord (BTREE btree, RKEY rkey, CNSTRING rec, INT len)
+{
+	WAL wal = bwal(btree);
+	if (!wal) return FALSE;
+	if (!wal->wl_depth) {
+		/* direct write must not overtake earlier logged ones */
+		if (wal->wl_count)
+			walcheckpoint(btree);
+		return FALSE;
+	}
+	writeentry(btree, WAL_RECORD, &rkey, rec, len);
+	addpending(wal, rkey, rec, len);
+	/* bound memory use & log size of very large batches
+	 (log holds every version of records rewritten often) */
+	if (wal->wl_bytes > BTWALMAXBYTES || wal->wl_logged > BTWALMAXBYTES)
+		walcheckpoint(btree);
+	return TRUE;
+}
+/*=================================
+ * walgetrecord -- Find record pending checkpoint
+ *  btree:  [in]  btree
+ *  rkey:   [in]  key of record
+ *  prec:   [out] copy of record (may be NULL if not wanted)
+ *  plen:   [out] length of record (may be NULL)
+ * returns FALSE if record is not in log
+ *===============================*/
+BOOLEAN
+walgetrecord (BTREE btree, const RKEY *rkey, RAWRECORD *prec, INT *plen)
+{
+	WAL wal = bwal(btree);
+	WALREC *pp;
+	if (!wal || !wal->wl_count) return FALSE;
+	pp = findpending(wal, rkey);
+	if (!*pp) return FALSE;
+	if (prec) {
+		if ((*pp)->p_len) {
+			*prec = (RAWRECORD) stdalloc((*pp)->p_len + 1);
+			memcpy(*prec, (*pp)->p_rec, (*pp)->p_len);
+			(*prec)[(*pp)->p_len] = 0;
+		} else
+			*prec = NULL;
+	}
+	if (plen)
+		*plen = (*pp)->p_len;
+	return TRUE;
+}
+/*=================================
+ * walinbatch -- Is a batch of record updates open ?
+ *===============================*/
+BOOLEAN
+walinbatch (BTREE btree)
+{
+	WAL wal = bwal(btree);
+	return wal && wal->wl_depth > 0;
+}
+/*=================================
+ * walpending -- Copy records pending checkpoint in key range
+ *  btree:  [in]  btree
+ *  lo:     [in]  records must be above this (if set)
+ *  hi:     [in]  records must not be above this (if set)
+ *  pn:     [out] number of records
+ * returns records in key order (NULL if none), each copied and
+ *  followed by a zero; caller frees data of each & the array
+ * Lets a cursor see records of an open batch without
+ *  checkpointing the batch before it is committed
+ *===============================*/
+ADDREC *
+walpending (BTREE btree, const RKEY *lo, const RKEY *hi, INT *pn)
+{
+	WAL wal = bwal(btree);
+	ADDREC *recs;
+	WALREC prec;
+	STRING rec;
+	INT i, n = 0;
+
+	*pn = 0;
+	if (!wal || !wal->wl_count) return NULL;
+	recs = (ADDREC *) stdalloc(wal->wl_count * sizeof(ADDREC));
+	for (i = 0; i < wal->wl_nbuckets; ++i) {
+		for (prec = wal->wl_buckets[i]; prec; prec = prec->p_next) {
+			if (lo->r_rkey[0] && cmpkeys(lo, &prec->p_rkey) >= 0)
+				continue;
+			if (hi->r_rkey[0] && cmpkeys(hi, &prec->p_rkey) < 0)
+				continue;
+			rec = (STRING) stdalloc(prec->p_len + 1);
+			if (prec->p_len)
+				memcpy(rec, prec->p_rec, prec->p_len);
+			rec[prec->p_len] = 0;
+			recs[n].a_rkey = prec->p_rkey;
+			recs[n].a_rec = rec;
+			recs[n].a_len = prec->p_len;
+			++n;
+		}
+	}
+	if (!n) {
+		stdfree(recs);
+		return NULL;
+	}
+	qsort(recs, n, sizeof(ADDREC), cmpaddrecs);
+	*pn = n;
+	return recs;
+}
+/*=================================
+ * walcheckpoint -- Commit log & apply pending records to blocks
+ *  btree:  [in] btree
+ * Log is emptied once the blocks are safely written
+ *===============================*/
+void
+walcheckpoint (BTREE btree)
+{
+	char scratch[MAXPATHLEN];
+	WAL wal = bwal(btree);
+	ADDREC *recs;
+	WALREC prec;
+	INT i, n;
+
+	if (!wal || !bwrite(btree)) return;
+	walpath(btree, scratch, sizeof(scratch));
+	if (wal->wl_count) {
+		/* group commit: one forced write for all records */
+		if (wal->wl_fp) {
+			writeentry(btree, WAL_COMMIT, NULL, NULL, 0);
+			syncfile(wal->wl_fp, scratch);
+		}
+
+		n = wal->wl_count;
+		recs = (ADDREC *) stdalloc(n * sizeof(ADDREC));
+		for (i = n = 0; i < wal->wl_nbuckets; ++i) {
+			for (prec = wal->wl_buckets[i]; prec; prec = prec->p_next) {
+				recs[n].a_rkey = prec->p_rkey;
+				recs[n].a_rec = prec->p_rec;
+				recs[n].a_len = prec->p_len;
+				++n;
+			}
+		}
+		qsort(recs, n, sizeof(ADDREC), cmpaddrecs);
+		addrecords(btree, recs, n);
+		stdfree(recs);
+		clearpending(wal);
+		/* make sure any index changes are down as well */
+		syncfilefds(btree);
+		syncfile(bkfp(btree), bbasedir(btree));
+	}
+	/* checkpointed, so log is no longer needed */
+	if (wal->wl_fp) {
+		fclose(wal->wl_fp);
+		wal->wl_fp = NULL;
+	}
+	wal->wl_logged = 0;
+	unlink(scratch);
+}
+/*=================================
+ * walopen -- Recover from log left by earlier session
+ *  btree:  [in] btree just opened
+ * Committed records in log are checkpointed if btree is writeable,
+ * otherwise they are just held in memory for reading
+ *===============================*/
+void
+walopen (BTREE btree)
+{
+	bwal(btree) = NULL;
+	if (!loadlog(btree))
+		return;
+	if (bwrite(btree))
+		walcheckpoint(btree);
+}
+/*=================================
+ * walclose -- Finish any batch & free log state
+ *  btree:  [in] btree being closed
+ *===============================*/
+void
+walclose (BTREE btree)
+{
+	WAL wal = bwal(btree);
+	if (!wal) return;
+	wal->wl_depth = 0;
+	walcheckpoint(btree);
+	if (wal->wl_fp)
+		fclose(wal->wl_fp);
+	clearpending(wal);
+	stdfree(wal->wl_buckets);
+	stdfree(wal);
+	bwal(btree) = NULL;
+}
+/*=================================
+ * getwal -- Get (creating if needed) log state of btree
+ *===============================*/
+static WAL
+getwal (BTREE btree)
+{
+	WAL wal = bwal(btree);
+	if (!wal) {
+		wal = (WAL) stdalloc(sizeof(*wal));
+		wal->wl_fp = NULL;
+		wal->wl_depth = 0;
+		wal->wl_count = 0;
+		wal->wl_bytes = 0;
+		wal->wl_logged = 0;
+		wal->wl_nbuckets = WALMINBUCKETS;
+		wal->wl_buckets = (WALREC *) stdalloc(WALMINBUCKETS * sizeof(WALREC));
+		bwal(btree) = wal;
+	}
+	return wal;
+}
+/*=================================
+ * walpath -- Path of log file of btree
+ *===============================*/
+static void
+walpath (BTREE btree, STRING path, INT len)
+{
+	snprintf(path, len, "%s%c%s", bbasedir(btree), LLCHRDIRSEPARATOR, BTWALFILE);
+}
+/*=================================
+ * writeentry -- Append entry to log file
+ *  rkey may be NULL (commit entry)
+ *  (not forced to disk until commit)
+ *===============================*/
+static void
+writeentry (BTREE btree, INT type, const RKEY *rkey, CNSTRING rec, INT len)
+{
+	char scratch[MAXPATHLEN];
+	WAL wal = bwal(btree);
+	WALENTRY entry;
+
+	walpath(btree, scratch, sizeof(scratch));
+	if (!wal->wl_fp && !(wal->wl_fp = fopen(scratch, LLAPPENDBINARY))) {
+		char msg[sizeof(scratch)+64];
+		sprintf(msg, "Failed to open btree log file: %s", scratch);
+		FATAL2(msg);
+	}
+	memset(&entry, 0, sizeof(entry));
+	entry.w_magic = WALMAGIC;
+	entry.w_type = type;
+	if (rkey)
+		entry.w_rkey = *rkey;
+	entry.w_len = len;
+	entry.w_sum = walsum(&entry, rec);
+	CHECKED_fwrite(&entry, sizeof(entry), 1, wal->wl_fp, scratch);
+	if (len)
+		CHECKED_fwrite(rec, len, 1, wal->wl_fp, scratch);
+	wal->wl_logged += sizeof(entry) + len;
+}
+/*=================================
+ * walsum -- Checksum of log entry & its data
+ *  (FNV-1a, so torn or garbage entries are not replayed)
+ *===============================*/
+static INT
+walsum (WALENTRY *entry, CNSTRING rec)
+{
+	unsigned int h = 2166136261U;
+	const unsigned char *p = (const unsigned char *)&entry->w_rkey;
+	INT i;
+	h = (h ^ (unsigned int)entry->w_type) * 16777619U;
+	h = (h ^ (unsigned int)entry->w_len) * 16777619U;
+	for (i = 0; i < (INT)sizeof(RKEY); ++i)
+		h = (h ^ p[i]) * 16777619U;
+	p = (const unsigned char *)rec;
+	for (i = 0; i < entry->w_len; ++i)
+		h = (h ^ p[i]) * 16777619U;
+	return (INT)h;
+}
+/*=================================
+ * loadlog -- Read committed records of log file into memory
+ *  btree:  [in] btree
+ * Stops at first damaged entry; records after the last
+ * commit entry are discarded
+ * returns number of records loaded
+ *===============================*/
+static INT
+loadlog (BTREE btree)
+{
+	char scratch[MAXPATHLEN];
+	WALENTRY entry;
+	RAWRECORD rec = NULL;
+	INT reclen = 0;
+	long committed = 0;
+	FILE *fp;
+	WAL wal;
+
+	walpath(btree, scratch, sizeof(scratch));
+	if (!(fp = fopen(scratch, LLREADBINARY)))
+		return 0;
+	/* first pass: find end of last commit */
+	while (fread(&entry, sizeof(entry), 1, fp) == 1) {
+		if (entry.w_magic != WALMAGIC || entry.w_len < 0)
+			break;
+		if (entry.w_len > reclen) {
+			if (rec) stdfree(rec);
+			rec = (RAWRECORD) stdalloc(entry.w_len);
+			reclen = entry.w_len;
+		}
+		if (entry.w_len && fread(rec, entry.w_len, 1, fp) != 1)
+			break;
+		if (walsum(&entry, rec) != entry.w_sum)
+			break;
+		if (entry.w_type == WAL_COMMIT)
+			committed = ftell(fp);
+	}
+	/* second pass: load records up to there */
+	wal = getwal(btree);
+	rewind(fp);
+	while (ftell(fp) < committed
+		&& fread(&entry, sizeof(entry), 1, fp) == 1) {
+		if (entry.w_len && fread(rec, entry.w_len, 1, fp) != 1)
+			break;
+		if (entry.w_type == WAL_RECORD)
+			addpending(wal, entry.w_rkey, rec, entry.w_len);
+	}
+	if (rec) stdfree(rec);
+	fclose(fp);
+	if (!wal->wl_count && bwrite(btree)) {
+		/* nothing committed, so nothing to recover */
+		unlink(scratch);
+	}
+	return wal->wl_count;
+}
+/*=================================
+ * addpending -- Add (or replace) record pending checkpoint
+ *===============================*/
+static void
+addpending (WAL wal, RKEY rkey, CNSTRING rec, INT len)
+{
+	WALREC *pp = findpending(wal, &rkey);
+	WALREC prec = *pp;
+	if (prec) {
+		wal->wl_bytes -= prec->p_len;
+		if (prec->p_rec) stdfree(prec->p_rec);
+	} else {
+		prec = (WALREC) stdalloc(sizeof(*prec));
+		prec->p_rkey = rkey;
+		prec->p_next = NULL;
+		*pp = prec;
+		++wal->wl_count;
+	}
+	prec->p_len = len;
+	prec->p_rec = NULL;
+	if (len) {
+		prec->p_rec = (RAWRECORD) stdalloc(len);
+		memcpy(prec->p_rec, rec, len);
+	}
+	wal->wl_bytes += len;
+	if (wal->wl_count > 2*wal->wl_nbuckets)
+		growbuckets(wal);
+}
+/*=================================
+ * findpending -- Find hash chain link for record
+ * returns link pointing to record, or terminal NULL link of chain
+ *===============================*/
+static WALREC *
+findpending (WAL wal, const RKEY *rkey)
+{
+	WALREC *pp = &wal->wl_buckets[rkeyhash(wal, rkey)];
+	while (*pp && memcmp(&(*pp)->p_rkey, rkey, sizeof(RKEY)))
+		pp = &(*pp)->p_next;
+	return pp;
+}
+/*=================================
+ * rkeyhash -- Bucket of record key
+ *===============================*/
+static INT
+rkeyhash (WAL wal, const RKEY *rkey)
+{
+	unsigned int h = 2166136261U;
+	INT i;
+	for (i = 0; i < RKEYLEN; ++i)
+		h = (h ^ (unsigned char)rkey->r_rkey[i]) * 16777619U;
+	return (INT)(h & (unsigned int)(wal->wl_nbuckets - 1));
+}
+/*=================================
+ * growbuckets -- Double size of hash table & rehash
+ *===============================*/
+static void
+growbuckets (WAL wal)
+{
+	WALREC *old = wal->wl_buckets;
+	INT i, nold = wal->wl_nbuckets;
+	wal->wl_nbuckets = 2*nold;
+	wal->wl_buckets = (WALREC *) stdalloc(wal->wl_nbuckets * sizeof(WALREC));
+	for (i = 0; i < nold; ++i) {
+		WALREC prec = old[i];
+		while (prec) {
+			WALREC next = prec->p_next;
+			INT h = rkeyhash(wal, &prec->p_rkey);
+			prec->p_next = wal->wl_buckets[h];
+			wal->wl_buckets[h] = prec;
+			prec = next;
+		}
+	}
+	stdfree(old);
+}
+/*=================================
+ * clearpending -- Free all pending records
+ *===============================*/
+static void
+clearpending (WAL wal)
+{
+	INT i;
+	for (i = 0; i < wal->wl_nbuckets; ++i) {
+		WALREC prec = wal->wl_buckets[i];
+		while (prec) {
+			WALREC next = prec->p_next;
+			if (prec->p_rec) stdfree(prec->p_rec);
+			stdfree(prec);
+			prec = next;
+		}
+		wal->wl_buckets[i] = NULL;
+	}
+	wal->wl_count = 0;
+	wal->wl_bytes = 0;
+}
+/*=================================
+ * cmpaddrecs -- qsort comparator for records in key order
+ *===============================*/
+static int
+cmpaddrecs (const void *el1, const void *el2)
+{
+	return cmpkeys(&((const ADDREC *)el1)->a_rkey, &((const ADDREC *)el2)->a_rkey);
+}
@@ -57,6 +57,7 @@ extern STRING readpath,readpath_file;
  *********************************************/
 
 static BOOLEAN alterdb(INT alteration, INT *lldberr);
+static void apply_btree_options(BTREE btree);
 static BOOLEAN open_database_impl(LLDATABASE lldb, INT alteration, INT *lldberr);
 
 /*********************************************
@@ -100,7 +101,7 @@ alterdb (INT alteration, INT *lldberr)
 		*lldberr = BTERR_KFILE_ALTERDB;
 		goto force_open_db_exit;
 	}
-	if (fread(&kfile2, sizeof(kfile2), 1, fp) == 1) {
+	if (read_keyfile2(fp, &kfile2)) {
 		if (!validate_keyfile2(&kfile2, lldberr)) {
 			/* validate set lldberr */
 			goto force_open_db_exit;
@@ -168,9 +169,14 @@ open_database_impl (LLDATABASE lldb, INT alteration, INT *lldberr)
 	if (alteration > 0 && !alterdb(alteration, lldberr)) return FALSE;
 
 	/* call btree module to do actual open of BTR */
-	if (!(btree = bt_openbtree(readpath, FALSE, writ, immutable, lldberr)))
+	if (snapshot)
+		btree = bt_opensnapshot(readpath, lldberr);
+	else
+		btree = bt_openbtree(readpath, FALSE, writ, immutable, lldberr);
+	if (!btree)
 		return FALSE;
 	lldb_set_btree(lldb, btree);
+	apply_btree_options(btree);
 	/* we have to set the global variable readonly correctly, because
 	it is used widely */
 	readonly = !bwrite(btree);
@@ -187,6 +193,27 @@ open_database_impl (LLDATABASE lldb, INT alteration, INT *lldberr)
 	}
 	return TRUE;
 }
+/*==================================================
+ * apply_btree_options -- Pass user tuning options to btree
+ *  btree:  [in] newly opened btree
+ * (btree library cannot read lloptions itself)
+ *================================================*/
+static void
+apply_btree_options (BTREE btree)
+{
+	INT n = getlloptint("BtreeFileCache", -1);
+	if (n >= 0)
+		bt_setfilecache(btree, n);
+	n = getlloptint("BtreeCacheKB", -1);
+	if (n >= 0)
+		bt_setcachesize(btree, n*1024);
+	n = getlloptint("BtreeFilterKB", -1);
+	if (n >= 0)
+		bt_setfiltersize(btree, n*1024);
+	bt_setcompress(btree, getlloptint("BtreeCompress", 0) != 0);
+	bt_setstatslog(btree, getlloptstr("BtreeStatsLog", NULL)
+		, getlloptint("BtreeStatsEvery", 0));
+}
 /*==================================================
  * open_database -- open database
  *  forceopen:    [in] flag to override reader/writer protection
@@ -227,6 +254,8 @@ create_database (STRING dbpath, INT *lldberr)
 {
 	LLDATABASE lldb = lldb_alloc();
 	BTREE btree = 0;
+	INT cflag = BTFLGCRT;
+	INT pagekb, shift;
 
 	/* first test that newdb props are legal */
 	STRING props = getlloptstr("NewDbProps", 0);
@@ -245,7 +274,15 @@ create_database (STRING dbpath, INT *lldberr)
 	readpath_file=strsave(lastpathname(dbpath));
 	readpath=strsave(dbpath);
 
-	if (!(btree = bt_openbtree(dbpath, TRUE, 2, immutable, lldberr))) {
+	/* btree files may all go in one paged file, instead of a directory tree */
+	if (getlloptint("NewDbPaged", 0))
+		cflag |= BTFLGPAGED;
+	/* larger index & block headers (4, 8, 16, 32 or 64 KB) */
+	pagekb = getlloptint("NewDbPageKB", BUFLEN/1024);
+	for (shift = 0; (BUFLEN/1024 << shift) < pagekb && shift < 4; ++shift)
+		;
+	cflag |= BTFLGPAGE(shift);
+	if (!(btree = bt_openbtree(dbpath, cflag, 2, immutable, lldberr))) {
 		/* open failed so clean up, preserve lldberr */
 		int myerr = *lldberr;
 		lldb_close(&lldb);
@@ -254,6 +291,7 @@ create_database (STRING dbpath, INT *lldberr)
 	}
 	def_lldb = lldb;
 	lldb_set_btree(lldb, btree);
+	apply_btree_options(btree);
 	initxref();
 	if (props)
 		store_record("VUOPT", props, strlen(props));
@@ -336,6 +374,15 @@ describe_dberror (INT dberr, STRING buffer, INT buflen)
 	case BTERR_BADPROPS:
 		llstrapps(b, n, u8,  _("Invalid properties set for new database"));
 		break;
+	case BTERR_PAGEFILE:
+		llstrapps(b, n, u8,  _("could not open, read or write the paged file."));
+		break;
+	case BTERR_PAGELEN:
+		llstrapps(b, n, u8,  _("its page size differs from that of a database already open."));
+		break;
+	case BTERR_SNAPSHOT:
+		llstrapps(b, n, u8,  _("a snapshot of it could not be opened (it may be paged, or busy)."));
+		break;
 	default:
 		llstrapps(b, n, u8,  _("Undefined database error -- fix program."));
 		break;
@@ -53,6 +53,7 @@
  *********************************************/
 
 TABLE tagtable=NULL;		/* table for tag strings */
+STRING *tagnames=NULL;		/* tag strings by number (see fixtag) */
 TABLE placabbvs=NULL;	/* table for place abbrevs */
 STRING editstr=NULL; /* edit command to run to edit (has editfile inside of it) */
 STRING editfile=NULL; /* file used for editing, name obtained via mktemp */
@@ -183,7 +184,7 @@ init_lifelines_postdb (void)
 	STRING emsg;
 	TABLE dbopts = create_table_str();
 
-	tagtable = create_table_str(); /* values are same as keys */
+	tagtable = create_table_int(); /* values are numbers of tags */
 	placabbvs = create_table_str();
 
 	init_valtab_from_rec("VPLAC", placabbvs, ':', &emsg);
@@ -260,6 +261,8 @@ update_useropts (VPTR uparm)
 	strupdate(&illegal_char, getlloptstr("IllegalChar", 0));
 
 	nodechk_enable(!!getlloptint("nodecheck", 0));
+	/* in case user changed memory for record caches */
+	update_cache_memory();
 }
 /*==================================================
  * update_db_options -- 
@@ -56,6 +56,29 @@ store_record (CNSTRING key, STRING rec, INT len)
 {
 	return bt_addrecord (BTR, str2rkey(key), rec, len);
 }
+/*=========================================
+ * begin_store_batch -- Start group of record stores
+ * Until commit_store_batch, stored records are logged,
+ * and written into the database blocks together
+ * The group is a transaction: if the program dies before
+ * the commit, none of its records reach the database
+ * (so an edit touching several records uses one group)
+ * Groups may be nested; only the outermost commits
+ *=======================================*/
+void
+begin_store_batch (void)
+{
+	bt_begin_batch(BTR);
+}
+/*=========================================
+ * commit_store_batch -- Finish group of record stores
+ * Outermost commit makes group durable with one sync
+ *=======================================*/
+void
+commit_store_batch (void)
+{
+	bt_commit_batch(BTR);
+}
 /*=========================================
  * retrieve_to_file -- Retrieve record to file
  *=======================================*/
@@ -97,32 +120,18 @@ store_text_file_to_db (STRING key, CNSTRING file, TRANSLFNC transfnc)
 	return addtextfile(BTR, str2rkey(key), file, transfnc);
 }
 /*===================================================
- * traverse_db_key_keys -- traverse a span of records
+ * traverse_db_rec_keys -- traverse a span of records
  *  using STRING keys
  *  either lo or hi can be NULL
  *=================================================*/
-typedef struct
-{
-	TRAV_RAWRECORDS_FUNC func;
-	void * param;
-} TRAV_RAWRECORDS_PARAM;
-/* see above */
-static BOOLEAN
-trav_callback (RKEY rkey, STRING data, INT len, void * param)
-{
-	TRAV_RAWRECORDS_PARAM *tparam = (TRAV_RAWRECORDS_PARAM *)param;
-	char key[MAXKEYWIDTH+1];
-	strcpy(key, rkey2str(rkey));
-	return tparam->func(key, data, len, tparam->param);
-}
-/* see above */
 void
 traverse_db_rec_keys (CNSTRING lo, CNSTRING hi, TRAV_RAWRECORDS_FUNC func, void *param)
 {
-	RKEY lo1, hi1;
-	TRAV_RAWRECORDS_PARAM tparam;
-	tparam.param = param;
-	tparam.func = func;
+	RKEY lo1, hi1, rkey;
+	BTCURSOR cursor;
+	char key[MAXKEYWIDTH+1];
+	STRING data;
+	INT len;
 	if (lo)
 		lo1 = str2rkey(lo);
 	else
@@ -131,43 +140,41 @@ traverse_db_rec_keys (CNSTRING lo, CNSTRING hi, TRAV_RAWRECORDS_FUNC func, void
 		hi1 = str2rkey(hi);
 	else
 		hi1.r_rkey[0] = 0;
-	traverse_db_rec_rkeys(BTR, lo1, hi1, trav_callback, &tparam);
+	cursor = bt_cursor_open(BTR, lo1, hi1);
+	while (bt_cursor_next(cursor, &rkey, &data, &len)) {
+		strcpy(key, rkey2str(rkey));
+		if (!func(key, data, len, param))
+			break;
+	}
+	bt_cursor_close(cursor);
 }
 /*====================================================
  * traverse_db_key_recs -- traverse a span of records
  *  returns key & node
  *==================================================*/
-typedef struct
-{
-	TRAV_RECORDS_FUNC func;
-	void * param;
-} TRAV_RECORDS_PARAM;
-/* see above */
-static BOOLEAN
-trav_rec_callback (TRAV_RAWRECORDS_FUNC_ARGS(key, data, len, param))
-{
-	TRAV_RECORDS_PARAM *tparam = (TRAV_RECORDS_PARAM *)param;
-	RECORD rec=0;
-	BOOLEAN keepgoing=FALSE;
-	if (key[0]!='I' && key[0]!='F' && key[0]!='S' && key[0]!='E' && key[0]!='X')
-		return TRUE;
-	if (!strcmp(data, "DELE\n"))
-		return TRUE;
-	rec = string_to_record(data, key, len);
-	keepgoing = tparam->func(key, rec, tparam->param);
-	release_record(rec);
-	return keepgoing;
-}
-/* see above */
 void
 traverse_db_key_recs (TRAV_RECORDS_FUNC func, void *param)
 {
-	TRAV_RECORDS_PARAM tparam;
-	CNSTRING lo,hi;
-	tparam.param = param;
-	tparam.func = func;
-	lo = hi = NULL; /* all records */
-	traverse_db_rec_keys(lo, hi, trav_rec_callback, &tparam);
+	RKEY lo, hi, rkey;
+	BTCURSOR cursor;
+	char key[MAXKEYWIDTH+1];
+	RECORD rec=0;
+	STRING data;
+	INT len;
+	BOOLEAN keepgoing=TRUE;
+	lo.r_rkey[0] = hi.r_rkey[0] = 0; /* all records */
+	cursor = bt_cursor_open(BTR, lo, hi);
+	while (keepgoing && bt_cursor_next(cursor, &rkey, &data, &len)) {
+		strcpy(key, rkey2str(rkey));
+		if (key[0]!='I' && key[0]!='F' && key[0]!='S' && key[0]!='E' && key[0]!='X')
+			continue;
+		if (!strcmp(data, "DELE\n"))
+			continue;
+		rec = string_to_record(data, key, len);
+		keepgoing = func(key, rec, param);
+		release_record(rec);
+	}
+	bt_cursor_close(cursor);
 }
 /*=================================================
  * del_in_dbase -- Write deleted record to database
@@ -36,6 +36,7 @@
 #include "gedcomi.h"
 #include "cache.h"
 #include "liflines.h"
+#include "lloptions.h"
 #include "feedback.h"
 #include "zstr.h"
 
@@ -61,6 +62,9 @@ struct tag_cacheel {
 	INT c_lock;       /* lock count (includes report locks) */
 	INT c_rptlock;    /* report lock count */
 	RECORD c_record;
+	BOOLEAN c_inq;    /* on probation queue (2Q) rather than main list */
+	size_t c_bytes;   /* memory of record (see put_node_in_cache) */
+	INT c_keynum;     /* number of key (0 if not in c_nums, see CACHE) */
 };
 #define cnode(e)      ((e)->c_node)
 #define cprev(e)      ((e)->c_prev)
@@ -69,28 +73,70 @@ struct tag_cacheel {
 #define cclock(e)     ((e)->c_lock)
 #define ccrptlock(e)  ((e)->c_rptlock)
 #define crecord(e)    ((e)->c_record)
+#define cinq(e)       ((e)->c_inq)
+#define cbytes(e)     ((e)->c_bytes)
+#define ckeynum(e)    ((e)->c_keynum)
 
 /*==============================
  * CACHE -- Internal cache type.
+ *  With the 2Q policy (default), a record read in goes first on
+ *  the probation queue (c_firstq..c_lastq), which is first in,
+ *  first out, & is only moved to the main (direct) list if it is
+ *  wanted again after it has left the queue, while its key is
+ *  still remembered (c_ghosts). So a pass over many records
+ *  once (eg, forindi, or an export) only churns the queue, &
+ *  leaves the records being browsed in the main list.
+ *  With the LRU policy, the queue is not used.
+ *  A cache is limited either to its share of the memory budget
+ *  of all record caches (c_budget, see balance_caches), or, if
+ *  there is no budget, to a number of records (c_maxdir).
+ *  Records are found by key number in c_nums, an open addressing
+ *  hash table (see find_keynum), so that the keynum_to_??? calls
+ *  need not make a key string. Only keys not of the usual form
+ *  (letter of cache & number without leading zeros) use c_data.
  *============================*/
 typedef struct {
 	char c_name[5];
-	TABLE c_data;        /* table of keys */
+	char c_letter;       /* first letter of keys (I, F, S, E, X) */
+	TABLE c_data;        /* table of keys not in c_nums */
+	CACHEEL *c_nums;     /* elements by key number (hash table) */
+	INT c_numbits;       /* c_nums has 2^c_numbits slots */
+	INT c_numcount;      /* elements in c_nums */
 	CACHEEL c_firstdir;  /* first direct */
 	CACHEEL c_lastdir;   /* last direct */
-	CACHEEL c_array;     /* big array of cacheels, all alloc'd in a block */
 	CACHEEL c_free;      /* root of free list */
-	INT c_maxdir;        /* max in direct */
-	INT c_sizedir;       /* cur in direct */
+	INT c_maxdir;        /* max in direct (if no budget) */
+	INT c_sizedir;       /* cur in direct (including probation queue) */
+	size_t c_budget;     /* memory allowed (0 if limited by c_maxdir) */
+	size_t c_bytes;      /* memory of records in direct */
+	size_t c_bytesq;     /* memory of records in probation queue */
+	INT c_recent;        /* recent misses, decaying (see balance_caches) */
+	INT c_lastmisses;    /* c_misses at last balance_caches */
+	BOOLEAN c_twoq;      /* 2Q policy (else LRU) */
+	CACHEEL c_firstq;    /* newest on probation queue */
+	CACHEEL c_lastq;     /* oldest on probation queue */
+	INT c_maxq;          /* target size of probation queue */
+	INT c_sizeq;         /* cur in probation queue */
+	STRING *c_ghosts;    /* keys of records dropped from queue (ring) */
+	INT c_maxghosts;     /* size of ring */
+	INT c_nextghost;     /* next slot of ring to use */
+	TABLE c_ghosttab;    /* keys in ring (value is slot) */
+	INT c_hits;          /* lookups found in cache */
+	INT c_misses;        /* lookups read from database */
 } *CACHE;
 #define cacname(c)     ((c)->c_name)
 #define cacdata(c)     ((c)->c_data)
 #define cacfirstdir(c) ((c)->c_firstdir)
 #define caclastdir(c)  ((c)->c_lastdir)
-#define cacarray(e) ((e)->c_array)
 #define cacfree(e) ((e)->c_free)
 #define cacmaxdir(c)   ((c)->c_maxdir)
 #define cacsizedir(c)  ((c)->c_sizedir)
+#define cactwoq(c)     ((c)->c_twoq)
+#define cacfirstq(c)   ((c)->c_firstq)
+#define caclastq(c)    ((c)->c_lastq)
+#define cacmaxq(c)     ((c)->c_maxq)
+#define cacsizeq(c)    ((c)->c_sizeq)
+#define cacbudget(c)   ((c)->c_budget)
 
 
 /*********************************************
@@ -98,27 +144,46 @@ typedef struct {
  *********************************************/
 
 /* static void add_record_to_direct(CACHE cache, RECORD rec, STRING key); */
+static void balance_caches(void);
+static CACHEEL cache_hit(CACHE cache, CACHEEL cel, STRING tag);
+static CACHEEL cache_miss(CACHE cache, CNSTRING key, STRING tag, INT reportmode);
 static void cache_get_lock_counts(CACHE ca, INT * locks);
 static CACHE create_cache(STRING name, INT dirsize);
 static void delete_cache(CACHE * pcache);
 static void ensure_cel_has_record(CACHEEL cel);
+static BOOLEAN evict_one(CACHE cache);
+static CACHEEL find_cel(CACHE cache, CNSTRING key);
+static CACHEEL find_keynum(CACHE cache, INT keynum);
+static CACHEEL find_unlocked(CACHEEL last);
+static void first_queue(CACHE cache, CACHEEL cel);
 static ZSTR get_cache_stats(CACHE ca);
 static CACHEEL get_free_cacheel(CACHE cache);
+static BOOLEAN in_ghosts(CACHE cache, CNSTRING key);
+static void index_cel(CACHE cache, CACHEEL cel);
 static void init_cel(CACHEEL cel);
 static CACHEEL key_to_cacheel(CACHE cache, CNSTRING key, STRING tag, INT reportmode);
 static CACHEEL key_to_even_cacheel(CNSTRING key);
+static INT key_to_keynum(CACHE cache, CNSTRING key);
 static NODE key_typed_to_node(CACHE cache, CNSTRING key, STRING tag);
 static RECORD key_to_record_impl(CNSTRING key, INT reportmode);
 static RECORD key_typed_to_record(CACHE cache, CNSTRING key, STRING tag);
 static CACHEEL key_to_othr_cacheel(CNSTRING key);
 static CACHEEL key_to_sour_cacheel(CNSTRING key);
+static CACHEEL keynum_to_cacheel(CACHE cache, INT keynum, STRING tag, INT reportmode);
+static size_t memory_option(void);
 static CACHEEL node_to_cache(CACHE, NODE);
+static size_t nodebytes(NODE node);
+static void note_key(CNSTRING key);
+static INT numslot(CACHE cache, INT keynum);
 static void put_node_in_cache(CACHE cache, CACHEEL cel, NODE node, STRING key);
+static void remember_ghost(CACHE cache, CNSTRING key);
+static void set_cache_budgets(void);
 static void remove_cel_from_cache(CACHE cache, CACHEEL cel, BOOLEAN delcache);
 static NODE qkey_to_node(CACHE cache, CNSTRING key, STRING tag);
 static RECORD qkey_typed_to_record(CACHE cache, CNSTRING key, STRING tag);
 /* static CACHEEL qkey_to_typed_cacheel(STRING key); */
 static void remove_from_cache(CACHE, CNSTRING);
+static void unindex_cel(CACHE cache, CACHEEL cel);
 
 
 INT csz_indi = 200;		/* cache size for indi */
@@ -126,12 +191,31 @@ INT csz_fam = 200;		/* cache size for fam */
 INT csz_sour = 200;		/* cache size for sour */
 INT csz_even = 200;		/* cache size for even */
 INT csz_othr = 200;		/* cache size for othr */
+BOOLEAN csz_set = FALSE;	/* sizes given by -c, not CacheMemoryMB */
+
+/* share of cache for probation queue, & number of keys remembered
+ after they leave it, in percent of cache size (see CACHE) */
+#define CACHEQPCT 25
+#define CACHEGHOSTPCT 50
+/* memory budget of all record caches, if not set by CacheMemoryMB */
+#define CACHEMEMORYMB 32
+/* share of budget split evenly, rest going by recent misses,
+ & misses (of all caches) between rebalancing (see balance_caches) */
+#define CACHEEVENPCT 10
+#define CACHEBALANCE 1024
+/* expected memory of record, to size ring of keys with a budget */
+#define CACHERECBYTES 1024
+/* initial size of hash table of key numbers (as power of 2) */
+#define CACHENUMBITS 8
 
 /*********************************************
  * local variables
  *********************************************/
 
 static CACHE indicache, famcache, evencache, sourcache, othrcache;
+static BOOLEAN twoq = TRUE; /* new caches use 2Q policy (else LRU) */
+static size_t cache_budget = 0; /* bytes for all record caches (0 for fixed sizes) */
+static INT cache_misses = 0; /* misses of all caches (see balance_caches) */
 
 static CNSTRING cel_magic = "CEL_MAGIC"; /* fixed pointer to identify cel */
 
@@ -162,16 +246,14 @@ node_to_record (NODE node)
 NODE
 keynum_to_indi (int keynum)
 {
-	char keystr[20];
-	sprintf(keystr,"I%d",keynum);
-	return key_to_indi(keystr);
+	CACHEEL cel = keynum_to_cacheel(indicache, keynum, "INDI", FALSE);
+	return cel ? cnode(cel) : NULL;
 }
 RECORD
 keynum_to_irecord (int keynum)
 {
-	char keystr[20];
-	sprintf(keystr,"I%d",keynum);
-	return key_to_irecord(keystr);
+	CACHEEL cel = keynum_to_cacheel(indicache, keynum, "INDI", FALSE);
+	return cel ? get_record_for_cel(cel) : NULL;
 }
 /*=========================================================
  * qkeynum_to_indi -- Convert a numeric key to an indi node
@@ -181,9 +263,8 @@ keynum_to_irecord (int keynum)
 NODE
 qkeynum_to_indi (int keynum)
 {
-	char keystr[20];
-	sprintf(keystr,"I%d",keynum);
-	return qkey_to_indi(keystr);
+	CACHEEL cel = keynum_to_cacheel(indicache, keynum, "INDI", TRUE);
+	return cel ? cnode(cel) : NULL;
 }
 /*================================================
  * keynum_to_fam -- Convert a numeric key to a fam node
@@ -192,16 +273,14 @@ qkeynum_to_indi (int keynum)
 NODE
 keynum_to_fam (int keynum)
 {
-	char keystr[20];
-	sprintf(keystr,"F%d",keynum);
-	return key_to_fam(keystr);
+	CACHEEL cel = keynum_to_cacheel(famcache, keynum, "FAM", FALSE);
+	return cel ? cnode(cel) : NULL;
 }
 RECORD
 keynum_to_frecord (int keynum)
 {
-	char keystr[20];
-	sprintf(keystr,"F%d",keynum);
-	return key_to_frecord(keystr);
+	CACHEEL cel = keynum_to_cacheel(famcache, keynum, "FAM", FALSE);
+	return cel ? get_record_for_cel(cel) : NULL;
 }
 /*======================================================
  * qkeynum_to_frecord -- Convert a numeric key to a fam record
@@ -211,9 +290,8 @@ keynum_to_frecord (int keynum)
 RECORD
 qkeynum_to_frecord (int keynum)
 {
-	char keystr[20];
-	sprintf(keystr,"F%d",keynum);
-	return qkey_to_frecord(keystr);
+	CACHEEL cel = keynum_to_cacheel(famcache, keynum, "FAM", TRUE);
+	return cel ? get_record_for_cel(cel) : NULL;
 }
 /*================================================
  * keynum_to_sour -- Convert a numeric key to a sour node
@@ -227,9 +305,8 @@ keynum_to_sour (int keynum)
 RECORD
 keynum_to_srecord (int keynum)
 {
-	char keystr[20];
-	sprintf(keystr,"S%d",keynum);
-	return key_to_srecord(keystr);
+	CACHEEL cel = keynum_to_cacheel(sourcache, keynum, "SOUR", FALSE);
+	return cel ? get_record_for_cel(cel) : NULL;
 }
 /*================================================
  * keynum_to_even -- Convert a numeric key to a even node
@@ -243,9 +320,8 @@ keynum_to_even (int keynum)
 RECORD
 keynum_to_erecord (int keynum)
 {
-	char keystr[MAXKEYWIDTH+1];
-	sprintf(keystr,"E%d",keynum);
-	return key_to_erecord(keystr);
+	CACHEEL cel = keynum_to_cacheel(evencache, keynum, "EVEN", FALSE);
+	return cel ? get_record_for_cel(cel) : NULL;
 }
 /*================================================
  * keynum_to_othr -- Convert a numeric key to an other node
@@ -254,16 +330,14 @@ keynum_to_erecord (int keynum)
 NODE
 keynum_to_othr (int keynum)
 {
-	char keystr[20];
-	sprintf(keystr,"X%d",keynum);
-	return key_to_othr(keystr);
+	CACHEEL cel = keynum_to_cacheel(othrcache, keynum, NULL, FALSE);
+	return cel ? cnode(cel) : NULL;
 }
 RECORD
 keynum_to_orecord (int keynum)
 {
-	char keystr[20];
-	sprintf(keystr,"X%d",keynum);
-	return key_to_orecord(keystr);
+	CACHEEL cel = keynum_to_cacheel(othrcache, keynum, NULL, FALSE);
+	return cel ? get_record_for_cel(cel) : NULL;
 }
 /*=====================================
  * keynum_to_node -- Convert keynum to node
@@ -516,11 +590,92 @@ key_to_othr_cacheel (CNSTRING key)
 void
 init_caches (void)
 {
+	twoq = !eqstr_ex(getlloptstr("CachePolicy", NULL), "LRU");
+	cache_budget = memory_option();
 	indicache = create_cache("INDI", csz_indi);
 	famcache  = create_cache("FAM", csz_fam);
 	evencache = create_cache("EVEN", csz_even);
 	sourcache = create_cache("SOUR", csz_sour);
 	othrcache = create_cache("OTHR", csz_othr);
+	set_cache_budgets();
+}
+/*======================================
+ * update_cache_memory -- Resize record caches, if user has
+ *  changed memory budget (CacheMemoryMB option)
+ * Caches over their new shares give memory back as they next
+ *  read records (not at once, as callers may be using records
+ *  of any cache as this is called)
+ *====================================*/
+void
+update_cache_memory (void)
+{
+	size_t budget = memory_option();
+	if (!indicache || budget == cache_budget)
+		return;
+	cache_budget = budget;
+	set_cache_budgets();
+}
+/*======================================
+ * memory_option -- Memory budget of record caches from options
+ *  (0 to limit each cache to its number of records, as when
+ *  sizes are given by -c)
+ *====================================*/
+static size_t
+memory_option (void)
+{
+	INT mb;
+	if (csz_set)
+		return 0;
+	mb = getlloptint("CacheMemoryMB", CACHEMEMORYMB);
+	return (mb > 0) ? (size_t)mb*1024*1024 : 0;
+}
+/*======================================
+ * set_cache_budgets -- Share budget out evenly among caches
+ *  (the share of each then follows its misses, see balance_caches)
+ *====================================*/
+static void
+set_cache_budgets (void)
+{
+	CACHE caches[5];
+	INT i;
+	caches[0] = indicache; caches[1] = famcache; caches[2] = evencache;
+	caches[3] = sourcache; caches[4] = othrcache;
+	for (i=0; i<5; ++i) {
+		if (!caches[i]) continue;
+		cacbudget(caches[i]) = cache_budget/5;
+		caches[i]->c_recent = 0;
+		caches[i]->c_lastmisses = caches[i]->c_misses;
+	}
+}
+/*======================================
+ * balance_caches -- Share budget among caches by recent misses
+ *  Each cache gets an even part of CACHEEVENPCT of the budget,
+ *  & the rest goes in proportion to its misses (counted since
+ *  the last time, plus half of those counted before that), so
+ *  memory moves to where records are being read in
+ *====================================*/
+static void
+balance_caches (void)
+{
+	CACHE caches[5];
+	size_t even = cache_budget/100*CACHEEVENPCT/5;
+	double total = 0, rest = (double)(cache_budget - 5*even);
+	INT i;
+	caches[0] = indicache; caches[1] = famcache; caches[2] = evencache;
+	caches[3] = sourcache; caches[4] = othrcache;
+	for (i=0; i<5; ++i) {
+		CACHE ca = caches[i];
+		ca->c_recent = ca->c_recent/2 + (ca->c_misses - ca->c_lastmisses);
+		ca->c_lastmisses = ca->c_misses;
+		total += ca->c_recent;
+	}
+	for (i=0; i<5; ++i) {
+		CACHE ca = caches[i];
+		if (total > 0)
+			cacbudget(ca) = even + (size_t)(rest*ca->c_recent/total);
+		else
+			cacbudget(ca) = cache_budget/5;
+	}
 }
 /*======================================
  * free_caches -- Release cache memory
@@ -542,7 +697,6 @@ static CACHE
 create_cache (STRING name, INT dirsize)
 {
 	CACHE cache;
-	INT i;
 	if (dirsize < 1) dirsize = 1;
 	cache = (CACHE) stdalloc(sizeof(*cache));
 	memset(cache, 0, sizeof(*cache));
@@ -552,23 +706,26 @@ create_cache (STRING name, INT dirsize)
 	caches, but right now (2003-10-08), tables do not expose a 
 	method to set their hash size.
 	*/
-	cacdata(cache) = create_table_vptr(); /* pointers to cache elements, owned by cacarray */
+	cacdata(cache) = create_table_vptr(); /* pointers to cache elements, owned by cache */
+	cache->c_letter = eqstr(name, "OTHR") ? 'X' : name[0];
+	cache->c_numbits = CACHENUMBITS;
+	cache->c_nums = (CACHEEL *) stdalloc(sizeof(CACHEEL) << CACHENUMBITS);
 	cacfirstdir(cache) = caclastdir(cache) = NULL;
 	cacsizedir(cache) = 0;
 	cacmaxdir(cache) = dirsize;
-	/* Allocate all the cache elements in a big block */
-	cacarray(cache) = (CACHEEL) stdalloc(cacmaxdir(cache) * sizeof(cacarray(cache)[0]));
-	/* Link all the elements together on the free list */
-	for (i=0; i<cacmaxdir(cache); ++i) {
-		CACHEEL cel = &cacarray(cache)[i];
-		CACHEEL celnext = cacfree(cache);
-		init_cel(cel);
-		if (celnext) {
-			cnext(cel) = celnext;
-			cprev(celnext) = cel;
-		}
-		cacfree(cache) = cel;
+	cactwoq(cache) = twoq;
+	if (twoq) {
+		cacmaxq(cache) = dirsize*CACHEQPCT/100;
+		/* with a budget, any one cache may come to have most of it */
+		if (cache_budget)
+			cache->c_maxghosts = (INT)(cache_budget/CACHERECBYTES*CACHEGHOSTPCT/100) + 1;
+		else
+			cache->c_maxghosts = dirsize*CACHEGHOSTPCT/100 + 1;
+		cache->c_ghosts = (STRING *) stdalloc(cache->c_maxghosts * sizeof(STRING));
+		cache->c_ghosttab = create_table_int();
 	}
+	/* elements are allocated as needed (see get_free_cacheel) */
+	cacfree(cache) = NULL;
 	return cache;
 }
 /*=============================
@@ -582,15 +739,29 @@ delete_cache (CACHE * pcache)
 	CACHEEL frst=0;
 	if (!cache) return;
 	/* Loop through all cache elements, freeing each */
-	while ((frst = cacfirstdir(cache)) != 0) {
+	while ((frst = cacfirstdir(cache)) != 0
+		|| (frst = cacfirstq(cache)) != 0) {
 		BOOLEAN delcache = TRUE;
 		remove_cel_from_cache(cache, frst, delcache);
 	}
-	/* TODO: Need to delete cache elements on free list */
+	while ((frst = cacfree(cache)) != 0) {
+		cacfree(cache) = cnext(frst);
+		stdfree(frst);
+	}
 	num = get_table_count(cacdata(cache));
 	ASSERT(num == 0);
 	destroy_table(cacdata(cache));
-	stdfree(cacarray(cache));
+	ASSERT(cache->c_numcount == 0);
+	stdfree(cache->c_nums);
+	if (cache->c_ghosts) {
+		INT i;
+		for (i=0; i<cache->c_maxghosts; ++i) {
+			if (cache->c_ghosts[i])
+				stdfree(cache->c_ghosts[i]);
+		}
+		stdfree(cache->c_ghosts);
+		destroy_table(cache->c_ghosttab);
+	}
 	stdfree(cache);
 	*pcache = 0;
 }
@@ -605,6 +776,7 @@ init_cel (CACHEEL cel)
 }
 /*=================================================
  * remove_direct -- Unlink CACHEEL from direct list
+ *  (or from probation queue, if it is there)
  *===============================================*/
 static void
 remove_direct (CACHE cache, CACHEEL cel)
@@ -615,9 +787,18 @@ remove_direct (CACHE cache, CACHEEL cel)
 	ASSERT(cel);
 	if (prev) cnext(prev) = next;
 	if (next) cprev(next) = prev;
-	if (!prev) cacfirstdir(cache) = next;
-	if (!next) caclastdir(cache) = prev;
+	if (cinq(cel)) {
+		if (!prev) cacfirstq(cache) = next;
+		if (!next) caclastq(cache) = prev;
+		cacsizeq(cache)--;
+		cache->c_bytesq -= cbytes(cel);
+		cinq(cel) = FALSE;
+	} else {
+		if (!prev) cacfirstdir(cache) = next;
+		if (!next) caclastdir(cache) = prev;
+	}
 	cacsizedir(cache)--;
+	cache->c_bytes -= cbytes(cel);
 }
 /*===========================================================
  * first_direct -- Make unlinked CACHEEL first in direct list
@@ -629,24 +810,77 @@ first_direct (CACHE cache, CACHEEL cel)
 	ASSERT(cache);
 	ASSERT(cel);
 	cacsizedir(cache)++;
+	cache->c_bytes += cbytes(cel);
 	cprev(cel) = NULL;
 	cnext(cel) = frst;
 	if (frst) cprev(frst) = cel;
 	if (!frst) caclastdir(cache) = cel;
 	cacfirstdir(cache) = cel;
 }
+/*===========================================================
+ * first_queue -- Make unlinked CACHEEL newest in probation queue
+ *=========================================================*/
+static void
+first_queue (CACHE cache, CACHEEL cel)
+{
+	CACHEEL frst = cacfirstq(cache);
+	ASSERT(cache);
+	ASSERT(cel);
+	cacsizedir(cache)++;
+	cacsizeq(cache)++;
+	cache->c_bytes += cbytes(cel);
+	cache->c_bytesq += cbytes(cel);
+	cinq(cel) = TRUE;
+	cprev(cel) = NULL;
+	cnext(cel) = frst;
+	if (frst) cprev(frst) = cel;
+	if (!frst) caclastq(cache) = cel;
+	cacfirstq(cache) = cel;
+}
 /*============================================================
  * direct_to_first -- Make direct CACHEEL first in direct list
+ *  (one on the probation queue stays where it is, see CACHE)
  *==========================================================*/
 static void
 direct_to_first (CACHE cache, CACHEEL cel)
 {
 	ASSERT(cache);
 	ASSERT(cel);
-	if (cel == cacfirstdir(cache)) return;
+	if (cel == cacfirstdir(cache) || cinq(cel)) return;
 	remove_direct(cache, cel);
 	first_direct(cache, cel);
 }
+/*============================================================
+ * remember_ghost -- Remember key of record leaving probation queue
+ *  (forgetting the oldest one remembered, if ring is full)
+ *==========================================================*/
+static void
+remember_ghost (CACHE cache, CNSTRING key)
+{
+	INT slot = cache->c_nextghost;
+	STRING old = cache->c_ghosts[slot];
+	if (old) {
+		/* key may have been forgotten already (see in_ghosts) */
+		if (valueof_int(cache->c_ghosttab, old) == slot+1)
+			delete_table_element(cache->c_ghosttab, old);
+		stdfree(old);
+	}
+	cache->c_ghosts[slot] = strsave(key);
+	insert_table_int(cache->c_ghosttab, key, slot+1);
+	cache->c_nextghost = (slot+1) % cache->c_maxghosts;
+}
+/*============================================================
+ * in_ghosts -- Was record dropped from probation queue lately ?
+ *  (if so, it is forgotten, as it is now being read in again)
+ *==========================================================*/
+static BOOLEAN
+in_ghosts (CACHE cache, CNSTRING key)
+{
+	if (!cache->c_ghosttab || !valueof_int(cache->c_ghosttab, key))
+		return FALSE;
+	delete_table_element(cache->c_ghosttab, key);
+	return TRUE;
+}
 /*========================================================
  * add_to_direct -- Add new CACHEEL to direct part of cache
  * reportmode: if True, then return NULL rather than aborting
@@ -669,9 +903,9 @@ add_to_direct (CACHE cache, CNSTRING key, INT reportmode)
 	ASSERT(cache);
 	ASSERT(key);
 	rec = NULL;
+	/* nodes point into rawrec, which is freed with them */
 	if ((rawrec = retrieve_raw_record(key, &len))) 
-		/* 2003-11-22, we should use string_to_node here */
-		rec = string_to_record(rawrec, key, len);
+		rec = keep_string_to_record(rawrec, key, len);
 	if (!rec)
 	{
 		ZSTR zstr=zs_newn(256);
@@ -708,7 +942,6 @@ add_to_direct (CACHE cache, CNSTRING key, INT reportmode)
 	record_set_cel(rec, cel);
 	/* our new rec above has one reference, which is held by cel */
 	crecord(cel) = rec;
-	stdfree(rawrec);
 	ASSERT(cel->c_magic == cel_magic);
 	return cel;
 }
@@ -720,21 +953,72 @@ key_to_cacheel (CACHE cache, CNSTRING key, STRING tag, INT reportmode)
 {
 	CACHEEL cel;
 
+	note_key(key);
+	if ((cel = find_cel(cache, key)))
+		return cache_hit(cache, cel, tag);
+	return cache_miss(cache, key, tag, reportmode);
+}
+/*======================================================
+ * keynum_to_cacheel -- Return CACHEEL corresponding to key number
+ *  (key string is only made if record must be read in)
+ *====================================================*/
+static CACHEEL
+keynum_to_cacheel (CACHE cache, INT keynum, STRING tag, INT reportmode)
+{
+	CACHEEL cel;
+	char key[20];
+
+	ASSERT(cache);
+	if (keynum > 0 && keynum <= MAXKEYNUMBER
+		&& (cel = find_keynum(cache, keynum))) {
+		note_key(ckey(cel));
+		return cache_hit(cache, cel, tag);
+	}
+	sprintf(key, "%c%d", cache->c_letter, keynum);
+	note_key(key);
+	if ((cel = find_cel(cache, key)))
+		return cache_hit(cache, cel, tag);
+	return cache_miss(cache, key, tag, reportmode);
+}
+/*======================================================
+ * note_key -- Remember key looked up, for crash log
+ *====================================================*/
+static void
+note_key (CNSTRING key)
+{
 	strncpy(keybuf[keyidx], (key ? (char *)key : "NULL"), 31);
 	keybuf[keyidx][31] = '\0';
 	keyidx++;
 	if(keyidx >= 10) keyidx = 0;
-	if ((cel = (CACHEEL) valueof_ptr(cacdata(cache), key))) {
-		ASSERT(cnode(cel));
-		ASSERT(cel->c_magic == cel_magic);
-		direct_to_first(cache, cel);
-		if (tag) {
-			ASSERT(eqstr(tag, ntag(cnode(cel))));
-			ASSERT(crecord(cel));
-			ASSERT(eqstr(key, nzkey(crecord(cel))));
-		}
-		return cel;
+}
+/*======================================================
+ * cache_hit -- Return CACHEEL found in cache, as most recently used
+ *====================================================*/
+static CACHEEL
+cache_hit (CACHE cache, CACHEEL cel, STRING tag)
+{
+	ASSERT(cnode(cel));
+	ASSERT(cel->c_magic == cel_magic);
+	++cache->c_hits;
+	direct_to_first(cache, cel);
+	if (tag) {
+		ASSERT(eqstr(tag, ntag(cnode(cel))));
+		ASSERT(crecord(cel));
+		ASSERT(eqstr(ckey(cel), nzkey(crecord(cel))));
 	}
+	return cel;
+}
+/*======================================================
+ * cache_miss -- Read record into cache & return its CACHEEL
+ *====================================================*/
+static CACHEEL
+cache_miss (CACHE cache, CNSTRING key, STRING tag, INT reportmode)
+{
+	CACHEEL cel;
+
+	++cache->c_misses;
+	if (cache_budget && ++cache_misses % CACHEBALANCE == 0)
+		balance_caches();
 	cel = add_to_direct(cache, key, reportmode);
 	if (cel && tag) {
 		ASSERT(eqstr(tag, ntag(cnode(cel))));
@@ -743,6 +1027,128 @@ key_to_cacheel (CACHE cache, CNSTRING key, STRING tag, INT reportmode)
 	}
 	return cel;
 }
+/*======================================================
+ * key_to_keynum -- Number of key, if key is of usual form
+ *  for cache (its letter & number without leading zeros),
+ *  else 0 (such keys are kept in table c_data)
+ *====================================================*/
+static INT
+key_to_keynum (CACHE cache, CNSTRING key)
+{
+	INT keynum = 0, i;
+
+	if (key[0] != cache->c_letter || key[1] < '1' || key[1] > '9')
+		return 0;
+	for (i=1; key[i]; ++i) {
+		if (key[i] < '0' || key[i] > '9' || i >= MAXKEYWIDTH)
+			return 0;
+		keynum = keynum*10 + (key[i] - '0');
+	}
+	return keynum <= MAXKEYNUMBER ? keynum : 0;
+}
+/*======================================================
+ * numslot -- Home slot of key number in hash table c_nums
+ *  (Fibonacci hashing, so runs of key numbers spread out)
+ *====================================================*/
+static INT
+numslot (CACHE cache, INT keynum)
+{
+	return (INT)((((unsigned long)keynum * 2654435761UL) & 0xffffffffUL)
+		>> (32 - cache->c_numbits));
+}
+/*======================================================
+ * find_keynum -- Find CACHEEL by key number (or NULL)
+ *====================================================*/
+static CACHEEL
+find_keynum (CACHE cache, INT keynum)
+{
+	INT mask = (1 << cache->c_numbits) - 1;
+	INT i = numslot(cache, keynum);
+	CACHEEL cel;
+	while ((cel = cache->c_nums[i]) != 0) {
+		if (ckeynum(cel) == keynum)
+			return cel;
+		i = (i+1) & mask;
+	}
+	return NULL;
+}
+/*======================================================
+ * find_cel -- Find CACHEEL by key (or NULL)
+ *====================================================*/
+static CACHEEL
+find_cel (CACHE cache, CNSTRING key)
+{
+	INT keynum = key_to_keynum(cache, key);
+	if (keynum)
+		return find_keynum(cache, keynum);
+	return (CACHEEL) valueof_ptr(cacdata(cache), key);
+}
+/*======================================================
+ * index_cel -- Add new CACHEEL to c_nums (or c_data)
+ *  c_nums is kept no more than half full
+ *====================================================*/
+static void
+index_cel (CACHE cache, CACHEEL cel)
+{
+	INT mask, i;
+
+	ckeynum(cel) = key_to_keynum(cache, ckey(cel));
+	if (!ckeynum(cel)) {
+		insert_table_ptr(cacdata(cache), ckey(cel), cel);
+		return;
+	}
+	if (2*(cache->c_numcount+1) > (1 << cache->c_numbits)) {
+		CACHEEL *old = cache->c_nums;
+		INT oldsize = 1 << cache->c_numbits;
+		++cache->c_numbits;
+		cache->c_nums = (CACHEEL *) stdalloc(sizeof(CACHEEL) << cache->c_numbits);
+		mask = (1 << cache->c_numbits) - 1;
+		for (i=0; i<oldsize; ++i) {
+			INT j;
+			if (!old[i]) continue;
+			for (j = numslot(cache, ckeynum(old[i])); cache->c_nums[j]; j = (j+1) & mask) {
+			}
+			cache->c_nums[j] = old[i];
+		}
+		stdfree(old);
+	}
+	mask = (1 << cache->c_numbits) - 1;
+	for (i = numslot(cache, ckeynum(cel)); cache->c_nums[i]; i = (i+1) & mask) {
+		ASSERT(ckeynum(cache->c_nums[i]) != ckeynum(cel));
+	}
+	cache->c_nums[i] = cel;
+	++cache->c_numcount;
+}
+/*======================================================
+ * unindex_cel -- Remove CACHEEL from c_nums (or c_data)
+ *  Entries after it in its run are moved back as needed,
+ *  so that no search stops short of its entry (no tombstones)
+ *====================================================*/
+static void
+unindex_cel (CACHE cache, CACHEEL cel)
+{
+	INT mask = (1 << cache->c_numbits) - 1;
+	INT i, j, home;
+
+	if (!ckeynum(cel)) {
+		delete_table_element(cacdata(cache), ckey(cel));
+		return;
+	}
+	for (i = numslot(cache, ckeynum(cel)); cache->c_nums[i] != cel; i = (i+1) & mask) {
+		ASSERT(cache->c_nums[i]);
+	}
+	for (j = (i+1) & mask; cache->c_nums[j]; j = (j+1) & mask) {
+		home = numslot(cache, ckeynum(cache->c_nums[j]));
+		/* move entry j to hole i unless its home is cyclically in (i,j] */
+		if (i <= j ? (home <= i || home > j) : (home <= i && home > j)) {
+			cache->c_nums[i] = cache->c_nums[j];
+			i = j;
+		}
+	}
+	cache->c_nums[i] = 0;
+	--cache->c_numcount;
+	ckeynum(cel) = 0;
+}
 /*===============================================================
  * key_to_node -- Return tree from key; add to cache if not there
  * asserts if failure
@@ -930,6 +1336,9 @@ cache_get_lock_counts (CACHE ca, INT * locks)
 	for (cel = cacfirstdir(ca); cel; cel = cnext(cel)) {
 		if (cclock(cel) && locks) ++(*locks);
 	}
+	for (cel = cacfirstq(ca); cel; cel = cnext(cel)) {
+		if (cclock(cel) && locks) ++(*locks);
+	}
 }
 /*=========================================
  * get_cache_stats -- Calculate cache stats
@@ -939,12 +1348,23 @@ static ZSTR
 get_cache_stats (CACHE ca)
 {
 	ZSTR zstr = zs_new();
-	INT lo=0;
+	INT lo=0, looks = ca->c_hits + ca->c_misses;
+	INT hitpct = looks ? (INT)((double)ca->c_hits*100/looks) : 0;
 	cache_get_lock_counts(ca, &lo);
-	zs_appf(zstr
-		, "d:%d/%d (l:%d)"
-		, cacsizedir(ca), cacmaxdir(ca), lo
-		);
+	if (cacbudget(ca)) {
+		zs_appf(zstr
+			, "d:%d %ldK/%ldK (l:%d) h:%d%%"
+			, cacsizedir(ca), (long)(ca->c_bytes/1024)
+			, (long)(cacbudget(ca)/1024), lo
+			, hitpct
+			);
+	} else {
+		zs_appf(zstr
+			, "d:%d/%d (l:%d) h:%d%%"
+			, cacsizedir(ca), cacmaxdir(ca), lo
+			, hitpct
+			);
+	}
 	return zstr;
 }
 /*=========================================
@@ -1051,7 +1471,7 @@ node_to_cache (CACHE cache, NODE top)
 	ASSERT(key);
 	/* ASSERT that record is not in cache */
 	/* We're not supposed to be called if record in cache */
-	ASSERT(!valueof_ptr(cacdata(cache), key));
+	ASSERT(!find_cel(cache, key));
 	cel = get_free_cacheel(cache);
 	put_node_in_cache(cache, cel, top, key);
 	return cel;
@@ -1064,20 +1484,18 @@ get_free_cacheel (CACHE cache)
 {
 	CACHEEL cel=0, celnext=0;
 
-	/* If free list is empty, move least recently used entry to free list */
-	if (!cacfree(cache)) {
-		/* find least recently used by unlocked entry */
-		for (cel = caclastdir(cache); cel && cclock(cel); cel = cprev(cel)) {
-		}
-		if (!cel) {
+	/* If cache is full, move least recently used entry to free list
+	 (with a budget, room is made after record is in, see put_node_in_cache) */
+	while (!cacbudget(cache) && cacsizedir(cache) >= cacmaxdir(cache)) {
+		if (!evict_one(cache)) {
 			crashlog(_("Cache [%s] overflowed its max size (%d)"), cacname(cache), cacmaxdir(cache));
 			ASSERT(0);
 		}
-		remove_from_cache(cache, ckey(cel));
 	}
 
 	cel = cacfree(cache);
-	ASSERT(cel);
+	if (!cel)
+		return (CACHEEL) stdalloc(sizeof(*cel));
 
 	/* remove entry from free list */
 	celnext = cnext(cel);
@@ -1089,6 +1507,44 @@ get_free_cacheel (CACHE cache)
 
 	return cel;
 }
+/*=======================================================
+ * evict_one -- Move one unlocked entry to free list
+ *  (oldest of probation queue, if that is over its share,
+ *  else least recently used)
+ * returns FALSE if every entry is locked
+ *=====================================================*/
+static BOOLEAN
+evict_one (CACHE cache)
+{
+	CACHEEL cel = NULL;
+	BOOLEAN overq = cacbudget(cache)
+		? cache->c_bytesq > cacbudget(cache)/100*CACHEQPCT
+		: cacsizeq(cache) > cacmaxq(cache);
+	if (overq)
+		cel = find_unlocked(caclastq(cache));
+	if (!cel)
+		cel = find_unlocked(caclastdir(cache));
+	if (!cel)
+		cel = find_unlocked(caclastq(cache));
+	if (!cel)
+		return FALSE;
+	if (cinq(cel))
+		remember_ghost(cache, ckey(cel));
+	remove_from_cache(cache, ckey(cel));
+	return TRUE;
+}
+/*=======================================================
+ * find_unlocked -- Find unlocked entry, going back from last
+ *  of direct list or probation queue
+ *=====================================================*/
+static CACHEEL
+find_unlocked (CACHEEL last)
+{
+	CACHEEL cel;
+	for (cel = last; cel && cclock(cel); cel = cprev(cel)) {
+	}
+	return cel;
+}
 /*=======================================================
  * set_all_nodetree_to_cel -- clear all the cel pointers in a node tree
  *=====================================================*/
@@ -1098,11 +1554,12 @@ set_all_nodetree_to_cel (NODE node, CACHEEL cel)
 	BOOLEAN travdone = FALSE;
 	/* Now set all nodes in tree to point to cache record */
 	while (!travdone) {
-		node->n_cel = cel;
-		/* go to bottom of tree */
-		while (nchild(node)) {
-			node = nchild(node);
-			node->n_cel = cel;
+		set_node_cel(node, cel);
+		/* go to bottom of tree (children not read in
+		 will take cel from their parent when read in) */
+		while (nloadedchild(node)) {
+			node = nloadedchild(node);
+			set_node_cel(node, cel);
 		}
 		/* find next node in traversal/ascent */
 		while (!nsibling(node)) {
@@ -1115,6 +1572,17 @@ set_all_nodetree_to_cel (NODE node, CACHEEL cel)
 		node = nsibling(node);
 	}
 }
+/*=======================================================
+ * nodebytes -- Memory of node (but not its tag, which is shared)
+ *=====================================================*/
+static size_t
+nodebytes (NODE node)
+{
+	size_t bytes = sizeof(*node);
+	if (nxref(node)) bytes += strlen(nxref(node)) + 1;
+	if (nval(node)) bytes += strlen(nval(node)) + 1;
+	return bytes;
+}
 /*=======================================================
  * put_node_in_cache -- Low-level work of loading node into cacheel supplied
  *=====================================================*/
@@ -1122,22 +1590,31 @@ static void
 put_node_in_cache (CACHE cache, CACHEEL cel, NODE node, STRING key)
 {
 	BOOLEAN travdone = FALSE;
+	size_t bytes;
 	ASSERT(cache);
 	ASSERT(node);
-	ASSERT(cacsizedir(cache) < cacmaxdir(cache));
+	ASSERT(cacbudget(cache) || cacsizedir(cache) < cacmaxdir(cache));
 	init_cel(cel);
-	insert_table_ptr(cacdata(cache), key, cel);
 	cnode(cel) = node;
 	ckey(cel) = strsave(key);
+	index_cel(cache, cel);
 	cclock(cel) = FALSE;
-	first_direct(cache, cel);
-	/* Now set all nodes in tree to point to cache record */
+	/* Now set all nodes in tree to point to cache record,
+	 counting their memory (tags are shared, so not counted),
+	 or that of their arena, if read from database */
+	bytes = sizeof(*cel) + strlen(key) + 1;
+	if (narena(node))
+		bytes += node_arena_bytes(narena(node));
 	while (!travdone) {
-		node->n_cel = cel;
-		/* go to bottom of tree */
-		while (nchild(node)) {
-			node = nchild(node);
-			node->n_cel = cel;
+		set_node_cel(node, cel);
+		if (!narena(node))
+			bytes += nodebytes(node);
+		/* go to bottom of tree (as in set_all_nodetree_to_cel) */
+		while (nloadedchild(node)) {
+			node = nloadedchild(node);
+			set_node_cel(node, cel);
+			if (!narena(node))
+				bytes += nodebytes(node);
 		}
 		/* find next node in traversal/ascent */
 		while (!nsibling(node)) {
@@ -1149,6 +1626,19 @@ put_node_in_cache (CACHE cache, CACHEEL cel, NODE node, STRING key)
 		}
 		node = nsibling(node);
 	}
+	cbytes(cel) = bytes;
+	/* with 2Q, only a record wanted again soon goes straight to main list */
+	if (cactwoq(cache) && !in_ghosts(cache, key))
+		first_queue(cache, cel);
+	else
+		first_direct(cache, cel);
+	/* keep within budget (new record is locked meanwhile, as it is
+	 not yet in the hands of the caller) */
+	++cclock(cel);
+	while (cacbudget(cache) && cache->c_bytes > cacbudget(cache)
+		&& evict_one(cache)) {
+	}
+	--cclock(cel);
 }
 /*==============================================
  * remove_indi_cache -- Remove person from cache
@@ -1193,7 +1683,7 @@ remove_from_cache (CACHE cache, CNSTRING key)
 	if (!key || *key == 0 || !cache)
 		return;
 	/* If it has a key, it is in the cache */
-	cel = valueof_ptr(cacdata(cache), key);
+	cel = find_cel(cache, key);
 	remove_cel_from_cache(cache, cel, delcache);
 }
 /*=============================================
@@ -1231,6 +1721,7 @@ remove_cel_from_cache (CACHE cache, CACHEEL cel, BOOLEAN delcache)
 	ASSERT(!cclock(cel)); 
 	ASSERT(cnode(cel));
 	remove_direct(cache, cel);
+	unindex_cel(cache, cel);
 
 	/* Clear all node tree info */
 	if (1) {
@@ -1255,7 +1746,6 @@ remove_cel_from_cache (CACHE cache, CACHEEL cel, BOOLEAN delcache)
 		crecord(cel) = 0;
 	}
 	cacfree(cache) = cel;
-	delete_table_element(cacdata(cache), key);
 	stdfree(key); /* alloc'd when assigned to ckey(cel) */
 }
 /*================================================================
@@ -1518,7 +2008,7 @@ cel_remove_record (CACHEEL cel, RECORD rec)
 void
 set_all_nodetree_to_root_cel (NODE root)
 {
-	set_all_nodetree_to_cel(root, root->n_cel);
+	set_all_nodetree_to_cel(root, ncel(root));
 }
 /*=======================================================
  * free_all_rprtlocks_in_cache -- Remove any rptlocks on any
@@ -1530,13 +2020,19 @@ free_all_rprtlocks_in_cache (CACHE cache)
 	INT ct=0;
 	CACHEEL cel=0;
 
-	for (cel = caclastdir(cache); cel; cel = cprev(cel)) {
-		if (ccrptlock(cel)) {
-			INT delta = ccrptlock(cel);
-			ccrptlock(cel) = 0;
-			ASSERT(cclock(cel) >= delta);
-			cclock(cel) -= delta;
-			++ct;
+	INT pass;
+
+	/* main list, then probation queue */
+	for (pass=0; pass<2; ++pass) {
+		cel = pass ? caclastq(cache) : caclastdir(cache);
+		for ( ; cel; cel = cprev(cel)) {
+			if (ccrptlock(cel)) {
+				INT delta = ccrptlock(cel);
+				ccrptlock(cel) = 0;
+				ASSERT(cclock(cel) >= delta);
+				cclock(cel) -= delta;
+				++ct;
+			}
 		}
 	}
 	return ct;
@@ -84,9 +84,8 @@ void lldb_close (LLDATABASE *plldb)
 
 	if (!lldb) return;
 
-	if (tagtable)
-		destroy_table(tagtable);
-	tagtable = 0;
+	free_binary_tags();
+	free_node_tags();
 	/* TODO: reverse the rest of init_lifelines_postdb -- Perry, 2002.06.05 */
 	if (placabbvs) {
 		destroy_table(placabbvs);
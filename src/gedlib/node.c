@@ -45,6 +45,31 @@ extern STRING qSrerbln, qSrernwt, qSrerilv, qSrerwlv, qSunsupunix, qSunsupuniv;
 typedef struct blck *NDALLOC;
 struct blck { NDALLOC next; };
 
+/*
+ An arena is one block holding all nodes of a record read from
+ the database, and their xrefs & values (see string_to_node),
+ so that the record costs one allocation rather than one per
+ node & string. Nodes follow the header, then strings. The
+ block is freed when its last node is freed. Strings of a node
+ are freed with it only if they are not in its arena, so values
+ must be changed with change_node_value (& change_node_xref).
+ An arena may instead keep the record text it is read from, and
+ then its nodes point into the text rather than copying their
+ strings (see keep_string_to_node); a changed value is copied
+ to the heap, leaving the text as it was.
+*/
+struct tag_ndarena {
+	INT a_live;      /* nodes not yet freed (+1 while being filled) */
+	NODE a_nextnode; /* next node to hand out */
+	NODE a_endnode;  /* end of nodes */
+	char *a_strs;    /* start of strings */
+	char *a_next;    /* next string byte to hand out */
+	char *a_end;     /* end of block */
+	char *a_text;    /* record text kept by arena (or NULL) */
+	char *a_textend; /* end of record text */
+	CACHEEL a_cel;   /* cache element of record (see node_cel) */
+};
+
 /*********************************************
  * local enums & defines
  *********************************************/
@@ -56,8 +81,10 @@ enum { NEW_RECORD, EXISTING_LACKING_WH_RECORD };
  *********************************************/
 
 static NODE alloc_node(void);
+static STRING arena_string(NDARENA arena, STRING str);
 static STRING fixup(STRING str);
-static STRING fixtag (STRING tag);
+static INT fixtag (STRING tag);
+static BOOLEAN in_arena(NODE node, CNSTRING str);
 static RECORD indi_to_prev_sib_impl(NODE indi);
 static void node_destructor(VTABLE *obj);
 static INT node_strlen(INT levl, NODE node);
@@ -82,6 +109,9 @@ NODE parents_nodes(NODE faml);
 static NDALLOC first_blck = (NDALLOC) 0;
 static int live_count = 0;
 
+/* tag names by number (tagnames[0] unused) */
+static INT numtags = 0, maxtags = 0;
+
 static struct tag_vtable vtable_for_node = {
 	VTABLE_MAGIC
 	, "node"
@@ -109,17 +139,59 @@ fixup (STRING str)
 }
 /*=============================
  * fixtag -- Keep tags in table
- * returns pointer to table's memory
+ * returns number of tag (index into tagnames)
  *===========================*/
-static STRING
+static INT
 fixtag (STRING tag)
 {
-	STRING str = valueof_str(tagtable, tag);
-	if (!str) {
-		insert_table_str(tagtable, tag, tag);
-		str = valueof_str(tagtable, tag);
+	INT num = valueof_int(tagtable, tag);
+	if (!num) {
+		if (numtags+1 >= maxtags) {
+			INT newmax = maxtags ? 2*maxtags : 64;
+			STRING *newnames = (STRING *) stdalloc(newmax*sizeof(STRING));
+			if (tagnames) {
+				memcpy(newnames, tagnames, maxtags*sizeof(STRING));
+				stdfree(tagnames);
+			}
+			tagnames = newnames;
+			maxtags = newmax;
+		}
+		num = ++numtags;
+		if (num >= (1 << 24))
+			FATAL2("Too many different tags");
+		tagnames[num] = strsave(tag);
+		insert_table_int(tagtable, tagnames[num], num);
 	}
-	return str;
+	return num;
+}
+/*=============================
+ * tag_to_num -- Number of tag (see ntag)
+ *  (numbers last until free_node_tags)
+ *===========================*/
+INT
+tag_to_num (STRING tag)
+{
+	return fixtag(tag);
+}
+/*=============================
+ * free_node_tags -- Free tag table & tag names
+ *  (when no node is left)
+ *===========================*/
+void
+free_node_tags (void)
+{
+	INT i;
+	if (tagtable) {
+		destroy_table(tagtable);
+		tagtable = NULL;
+	}
+	for (i = 1; i <= numtags; ++i)
+		stdfree(tagnames[i]);
+	if (tagnames) {
+		stdfree(tagnames);
+		tagnames = NULL;
+	}
+	numtags = maxtags = 0;
 }
 /*=====================================
  * change_node_tag -- Give new tag to node
@@ -127,8 +199,49 @@ fixtag (STRING tag)
 void
 change_node_tag (NODE node, STRING newtag)
 {
-	/* tag belongs to tagtable, so don't free old one */
-	ntag(node) = fixtag(newtag);
+	/* tag is number in tagtable, so nothing to free */
+	node->n_tag = fixtag(newtag);
+}
+/*=====================================
+ * change_node_value -- Give new value to node
+ *===================================*/
+void
+change_node_value (NODE node, CNSTRING newval)
+{
+	STRING old = nval(node);
+	nval(node) = newval ? strsave(newval) : NULL;
+	if (old && !in_arena(node, old))
+		stdfree(old);
+}
+/*=====================================
+ * change_node_xref -- Give new xref to node
+ *===================================*/
+void
+change_node_xref (NODE node, CNSTRING newxref)
+{
+	STRING old = nxref(node);
+	nxref(node) = newxref ? strsave(newxref) : NULL;
+	if (old && !in_arena(node, old))
+		stdfree(old);
+}
+/*=====================================
+ * swap_node_values -- Exchange values of two nodes
+ *  (copied, unless nodes share an arena)
+ *===================================*/
+void
+swap_node_values (NODE one, NODE two)
+{
+	STRING str;
+	if (narena(one) == narena(two)) {
+		str = nval(one);
+		nval(one) = nval(two);
+		nval(two) = str;
+		return;
+	}
+	str = nval(one) ? strsave(nval(one)) : NULL;
+	change_node_value(one, nval(two));
+	change_node_value(two, str);
+	if (str) stdfree(str);
 }
 /*=====================================
  * alloc_node -- Special node allocator
@@ -160,16 +273,175 @@ alloc_node (void)
 void
 free_node (NODE node)
 {
-	if (nxref(node)) stdfree(nxref(node));
-	if (nval(node)) stdfree(nval(node));
+	if (nxref(node) && !in_arena(node, nxref(node))) stdfree(nxref(node));
+	if (nval(node) && !in_arena(node, nval(node))) stdfree(nval(node));
 
 	/*
-	tag is pointer into shared tagtable
+	tag is number in shared tagtable
 	which we cannot delete until all nodes are freed
 	*/
+	--live_count;
+	if (narena(node)) {
+		release_node_arena(narena(node));
+		return;
+	}
 	((NDALLOC) node)->next = first_blck;
 	first_blck = (NDALLOC) node;
-	--live_count;
+}
+/*======================================
+ * create_node_arena -- Make arena for nodes of record
+ *  str:  [IN]  record (GEDCOM lines) to be read into arena
+ *  keep: [IN]  arena takes str (from stdalloc) & frees it
+ *              when done, & nodes point into it
+ * The arena is held by the caller until release_node_arena
+ *====================================*/
+NDARENA
+create_node_arena (STRING str, BOOLEAN keep)
+{
+	INT lines = 1, len;
+	CNSTRING p;
+	for (p = str; *p; ++p) {
+		if (*p == '\n') ++lines;
+	}
+	len = p - str;
+	/* xref & value of a line fit in the line & its newline */
+	return create_sized_arena(keep ? str : NULL, len, lines
+		, keep ? 0 : len + lines + 1);
+}
+/*======================================
+ * create_sized_arena -- Make arena for given numbers of
+ *  nodes & string bytes
+ *  text: [IN]  record (from stdalloc) that arena takes & frees
+ *              when done, & nodes point into (or NULL)
+ *  len:  [IN]  length of text
+ *====================================*/
+NDARENA
+create_sized_arena (STRING text, INT len, INT nodes, INT strbytes)
+{
+	NDARENA arena = (NDARENA) stdalloc(sizeof(*arena)
+		+ nodes*sizeof(struct tag_node) + strbytes);
+	arena->a_live = 1;
+	arena->a_nextnode = (NODE) (arena + 1);
+	arena->a_endnode = arena->a_nextnode + nodes;
+	arena->a_strs = arena->a_next = (char *) arena->a_endnode;
+	arena->a_end = arena->a_strs + strbytes;
+	if (text) {
+		arena->a_text = text;
+		arena->a_textend = text + len;
+	}
+	return arena;
+}
+/*======================================
+ * release_node_arena -- Drop hold on arena
+ *  (freed when no hold or node is left)
+ *====================================*/
+void
+release_node_arena (NDARENA arena)
+{
+	if (--arena->a_live == 0) {
+		if (arena->a_text)
+			stdfree(arena->a_text);
+		stdfree(arena);
+	}
+}
+/*======================================
+ * node_arena_bytes -- Memory of arena (& of text it keeps)
+ *====================================*/
+size_t
+node_arena_bytes (NDARENA arena)
+{
+	return (arena->a_end - (char *) arena) + (arena->a_textend - arena->a_text);
+}
+/*======================================
+ * arena_string -- Save non-tag string in arena
+ *  (or on heap, if arena is full)
+ *  Strings in record text kept by arena are used as they are
+ *====================================*/
+static STRING
+arena_string (NDARENA arena, STRING str)
+{
+	STRING new;
+	size_t len;
+	if (!str || *str == 0) return NULL;
+	if (str >= arena->a_text && str < arena->a_textend)
+		return str;
+	len = strlen(str) + 1;
+	if ((size_t)(arena->a_end - arena->a_next) < len)
+		return strsave(str);
+	new = arena->a_next;
+	memcpy(new, str, len);
+	arena->a_next += len;
+	return new;
+}
+/*======================================
+ * in_arena -- Is string in arena of node ?
+ *====================================*/
+static BOOLEAN
+in_arena (NODE node, CNSTRING str)
+{
+	NDARENA arena = narena(node);
+	return arena && ((str >= arena->a_strs && str < arena->a_end)
+		|| (str >= arena->a_text && str < arena->a_textend));
+}
+/*======================================
+ * node_cel -- Cache element of record holding node (or NULL)
+ *  Nodes in an arena take it from their parent, & the root
+ *  of the arena from the arena
+ *====================================*/
+CACHEEL
+node_cel (NODE node)
+{
+	while (narena(node) && nparent(node))
+		node = nparent(node);
+	if (!narena(node))
+		return node->n_owner.u_cel;
+	if (node == (NODE) (narena(node) + 1))
+		return narena(node)->a_cel;
+	return NULL;
+}
+/*======================================
+ * set_node_cel -- Record cache element of node
+ *  (see node_cel)
+ *====================================*/
+void
+set_node_cel (NODE node, CACHEEL cel)
+{
+	if (!narena(node))
+		node->n_owner.u_cel = cel;
+	else if (!nparent(node) && node == (NODE) (narena(node) + 1))
+		narena(node)->a_cel = cel;
+	/* else cel is found through parent or is NULL */
+}
+/*===========================
+ * create_arena_node -- Create NODE in arena
+ *  (on heap, if arena is full)
+ *=========================*/
+NODE
+create_arena_node (NDARENA arena, STRING xref, STRING tag, STRING val, NODE prnt)
+{
+	return create_arena_tagnum_node(arena, xref, fixtag(tag), val, prnt);
+}
+/*===========================
+ * create_arena_tagnum_node -- Create NODE in arena
+ *  given number of its tag (see tag_to_num)
+ *=========================*/
+NODE
+create_arena_tagnum_node (NDARENA arena, STRING xref, INT tagnum, STRING val, NODE prnt)
+{
+	NODE node;
+	if (arena->a_nextnode == arena->a_endnode)
+		return create_node(xref, tagnames[tagnum], val, prnt);
+	node = arena->a_nextnode++;
+	memset(node, 0, sizeof(*node));
+	nxref(node) = arena_string(arena, xref);
+	node->n_tag = tagnum;
+	nval(node) = arena_string(arena, val);
+	nparent(node) = prnt;
+	nflag(node) |= ND_ARENA;
+	node->n_owner.u_arena = arena;
+	++arena->a_live;
+	++live_count;
+	return node;
 }
 /*===========================
  * create_node -- Create NODE
@@ -185,11 +457,11 @@ create_node (STRING xref, STRING tag, STRING val, NODE prnt)
 	NODE node = alloc_node();
 	memset(node, 0, sizeof(*node));
 	nxref(node) = fixup(xref);
-	ntag(node) = fixtag(tag);
+	node->n_tag = fixtag(tag);
 	nval(node) = fixup(val);
 	nparent(node) = prnt;
 	if (prnt)
-		node->n_cel = prnt->n_cel;
+		node->n_owner.u_cel = ncel(prnt);
 	return node;
 }
 /*===========================
@@ -248,13 +520,14 @@ set_temp_node (NODE node, BOOLEAN temp)
 }
 /*=====================================
  * free_nodes -- Free all NODEs in tree
+ *  (children not yet read in are not read in to be freed)
  *===================================*/
 void
 free_nodes (NODE node)
 {
 	NODE sib;
 	while (node) {
-		if (nchild(node)) free_nodes(nchild(node));
+		if (nloadedchild(node)) free_nodes(nloadedchild(node));
 		sib = nsibling(node);
 		free_node(node);
 		node = sib;
@@ -353,16 +626,23 @@ othr_to_dbase (NODE node)
 }
 /*===============================================
  * node_to_dbase -- Store GEDCOM tree in database
+ *  (as text, or binary if BinaryRecords is set)
  *=============================================*/
 void
 node_to_dbase (NODE node,
                STRING tag)
 {
 	STRING str;
+	INT len;
 	ASSERT(node);
 	if (tag) { ASSERT(eqstr(tag, ntag(node))); }
-	str = node_to_string(node);
-	ASSERT(store_record(rmvat(nxref(node)), str, strlen(str)));
+	if (want_binary_records()) {
+		str = node_to_binary(node, &len);
+	} else {
+		str = node_to_string(node);
+		len = strlen(str);
+	}
+	ASSERT(store_record(rmvat(nxref(node)), str, len));
 	stdfree(str);
 }
 /*==================================================
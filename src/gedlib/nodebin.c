@@ -0,0 +1,405 @@
+/*
+   Copyright (c) 2026 The LifeLines developers
+   "The MIT license"
+   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+/*=============================================================
+ * nodebin.c -- Binary encoding of records in the database
+ *  A binary record starts with BINREC_MARK (which no GEDCOM
+ *  line starts with), its number of nodes, & the length of
+ *  the nodes, which follow in the order they are written as
+ *  GEDCOM lines. Each node is:
+ *   head: (up << 2) + (xref ? 2 : 0) + (value ? 1 : 0)
+ *     where up is 0 if the node is the first child of the one
+ *     before, 1 if its next sibling, 2 if the next sibling of
+ *     its parent, & so on
+ *   number of its tag in the tag list of the database
+ *   xref, if any, & value, if any: length, bytes, & a 0
+ *     (so nodes read from the record may point at them)
+ *  Numbers are stored 7 bits per byte, low bits first, with the
+ *  high bit set on all bytes but the last.
+ *  The tag list is record VTAGS, one tag per line (tag 1 is the
+ *  first); tags are only ever added to it, as records use them.
+ *  The BinaryRecords option chooses how records are written;
+ *  both kinds are always read (see dbverify -R to convert).
+ *   Created: 2026/10
+ *===========================================================*/
+
+#include "llstdlib.h"
+#include "table.h"
+#include "gedcom.h"
+#include "gedcomi.h"
+#include "lloptions.h"
+
+/*********************************************
+ * local types
+ *********************************************/
+
+#define BINREC_MARK 1          /* first byte of binary record */
+#define BINREC_TAGKEY "VTAGS"  /* record of tag list */
+#define BINREC_MAXNUM 5        /* most bytes of stored number */
+
+/*********************************************
+ * local function prototypes
+ *********************************************/
+
+/* alphabetical */
+static void add_tag(STRING tag);
+static INT encode_nodes(NODE root, STRING out, INT *pbytes);
+static BOOLEAN get_num(CNSTRING *pp, CNSTRING end, INT *pnum);
+static BOOLEAN get_str(CNSTRING *pp, CNSTRING end, STRING *pstr);
+static void load_tags(void);
+static void put_num(STRING out, INT *pbytes, INT num);
+static void put_str(STRING out, INT *pbytes, CNSTRING str);
+static void save_tags(void);
+static INT tag_to_dbnum(NODE node);
+
+/*********************************************
+ * local variables
+ *********************************************/
+
+static BOOLEAN tagsloaded = FALSE; /* tag list read from database ? */
+static INT *dbtagnums = NULL;  /* tag numbers of nodes (see tag_to_num), by number in list */
+static INT dbtagcount = 0, dbtagmax = 0;
+static TABLE dbtagtab = NULL;  /* numbers in list, by tag */
+static BOOLEAN newtags = FALSE; /* tags added to list, not yet saved ? */
+
+/*********************************************
+ * local & exported function definitions
+ * body of module
+ *********************************************/
+
+/*======================================
+ * is_binary_record -- Is record in binary encoding ?
+ *====================================*/
+BOOLEAN
+is_binary_record (CNSTRING str)
+{
+	return str && *str == BINREC_MARK;
+}
+/*======================================
+ * node_to_binary -- Encode tree as binary record
+ *  plen: [OUT] length of record
+ *  (adds any tags it lacks to tag list of database)
+ *====================================*/
+STRING
+node_to_binary (NODE node, INT *plen)
+{
+	INT count, bodylen = 0, len = 1;
+	STRING str;
+	if (!tagsloaded)
+		load_tags();
+	count = encode_nodes(node, NULL, &bodylen);
+	if (newtags)
+		save_tags();
+	str = (STRING) stdalloc(1 + 2*BINREC_MAXNUM + bodylen + 1);
+	str[0] = BINREC_MARK;
+	put_num(str, &len, count);
+	put_num(str, &len, bodylen);
+	encode_nodes(node, str, &len);
+	*plen = len;
+	return str;
+}
+/*======================================
+ * encode_nodes -- Write (or just count) encoding of nodes
+ *  root:   [IN]  first node (with its siblings)
+ *  out:    [IN]  where to write (NULL to count bytes)
+ *  pbytes: [I/O] bytes written
+ *  returns number of nodes
+ *====================================*/
+static INT
+encode_nodes (NODE root, STRING out, INT *pbytes)
+{
+	NODE node = root;
+	INT count = 0, depth = 0, up = 0;
+	while (TRUE) {
+		INT head = up << 2;
+		if (nxref(node)) head += 2;
+		if (nval(node)) head += 1;
+		put_num(out, pbytes, head);
+		put_num(out, pbytes, tag_to_dbnum(node));
+		if (nxref(node)) put_str(out, pbytes, nxref(node));
+		if (nval(node)) put_str(out, pbytes, nval(node));
+		++count;
+		/* next node, as in writing lines */
+		if (nchild(node)) {
+			node = nchild(node);
+			++depth;
+			up = 0;
+			continue;
+		}
+		up = 1;
+		while (!nsibling(node)) {
+			if (!depth)
+				return count;
+			node = nparent(node);
+			--depth;
+			++up;
+		}
+		node = nsibling(node);
+	}
+}
+/*======================================
+ * binary_to_node -- Read tree from binary record
+ *  len:  [IN]  length of record (as read from database)
+ *  keep: [IN]  tree keeps str (from stdalloc), pointing its
+ *              xrefs & values into it (see keep_string_to_node)
+ *  returns NULL if record is bad (& frees str now, if kept)
+ *====================================*/
+NODE
+binary_to_node (STRING str, INT len, BOOLEAN keep)
+{
+	CNSTRING p = str + 1, end;
+	INT count, bodylen, head, num, up, i;
+	NDARENA arena;
+	NODE root = NULL, prev = NULL, sib = NULL, prnt, node;
+	STRING xref, val;
+	/* lengths in record are not trusted past its end */
+	if (!get_num(&p, str + len, &count)
+		|| !get_num(&p, str + len, &bodylen)
+		|| bodylen > str + len - p) {
+		if (keep) stdfree(str);
+		return NULL;
+	}
+	end = p + bodylen;
+	arena = create_sized_arena(keep ? str : NULL, end - str, count
+		, keep ? 0 : bodylen);
+	if (!tagsloaded)
+		load_tags();
+	for (i = 0; i < count; ++i) {
+		xref = val = NULL;
+		if (!get_num(&p, end, &head) || !get_num(&p, end, &num))
+			goto binary_to_node_fail;
+		if (num < 1 || num > dbtagcount) {
+			/* another program may have added tags since read */
+			load_tags();
+			if (num < 1 || num > dbtagcount)
+				goto binary_to_node_fail;
+		}
+		if ((head & 2) && !get_str(&p, end, &xref))
+			goto binary_to_node_fail;
+		if ((head & 1) && !get_str(&p, end, &val))
+			goto binary_to_node_fail;
+		/* find parent, & sibling before node, if any */
+		up = head >> 2;
+		if (!prev) {
+			if (up)
+				goto binary_to_node_fail;
+			prnt = NULL;
+		} else if (!up) {
+			prnt = prev;
+		} else {
+			for (sib = prev; --up; sib = nparent(sib)) {
+				if (!nparent(sib))
+					goto binary_to_node_fail;
+			}
+			prnt = nparent(sib);
+		}
+		node = create_arena_tagnum_node(arena, xref, dbtagnums[num], val, prnt);
+		if (!prev)
+			root = node;
+		else if (prnt == prev)
+			nchild(prev) = node;
+		else
+			nsibling(sib) = node;
+		prev = node;
+	}
+	if (p != end)
+		goto binary_to_node_fail;
+	if (root)
+		nodechk(root, "binary_to_node");
+	release_node_arena(arena);
+	return root;
+binary_to_node_fail:
+	free_nodes(root);
+	release_node_arena(arena);
+	return NULL;
+}
+/*======================================
+ * binary_to_string -- GEDCOM text of binary record
+ *  len:  [IN]  length of record
+ *  returns NULL if record is bad
+ *====================================*/
+STRING
+binary_to_string (STRING str, INT len)
+{
+	NODE node = binary_to_node(str, len, FALSE);
+	STRING text;
+	if (!node) return NULL;
+	text = node_to_string(node);
+	free_nodes(node);
+	return text;
+}
+/*======================================
+ * put_num -- Write (or just count) number
+ *====================================*/
+static void
+put_num (STRING out, INT *pbytes, INT num)
+{
+	unsigned int n = num;
+	do {
+		unsigned int byte = n & 0x7f;
+		n >>= 7;
+		if (n) byte |= 0x80;
+		if (out) out[*pbytes] = (char) byte;
+		++*pbytes;
+	} while (n);
+}
+/*======================================
+ * put_str -- Write (or just count) string
+ *  with its length before & 0 after
+ *====================================*/
+static void
+put_str (STRING out, INT *pbytes, CNSTRING str)
+{
+	INT len = strlen(str);
+	put_num(out, pbytes, len);
+	if (out) memcpy(out + *pbytes, str, len + 1);
+	*pbytes += len + 1;
+}
+/*======================================
+ * get_num -- Read number (ending before end)
+ *====================================*/
+static BOOLEAN
+get_num (CNSTRING *pp, CNSTRING end, INT *pnum)
+{
+	CNSTRING p = *pp;
+	unsigned int n = 0;
+	INT shift;
+	for (shift = 0; shift < 7*BINREC_MAXNUM; shift += 7) {
+		unsigned int byte;
+		if (p >= end)
+			return FALSE;
+		byte = (uchar) *p++;
+		n |= (byte & 0x7f) << shift;
+		if (!(byte & 0x80)) {
+			if ((INT) n < 0)
+				return FALSE;
+			*pnum = n;
+			*pp = p;
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+/*======================================
+ * get_str -- Read string (ending before end)
+ *  returns pointer to string in record
+ *====================================*/
+static BOOLEAN
+get_str (CNSTRING *pp, CNSTRING end, STRING *pstr)
+{
+	CNSTRING p = *pp;
+	INT len;
+	if (!get_num(&p, end, &len) || len >= end - p || p[len])
+		return FALSE;
+	*pstr = (STRING) p;
+	*pp = p + len + 1;
+	return TRUE;
+}
+/*======================================
+ * tag_to_dbnum -- Number of tag of node in tag list
+ *  (adding it to list if not there)
+ *====================================*/
+static INT
+tag_to_dbnum (NODE node)
+{
+	INT num = valueof_int(dbtagtab, ntag(node));
+	if (!num) {
+		add_tag(ntag(node));
+		num = dbtagcount;
+		newtags = TRUE;
+	}
+	return num;
+}
+/*======================================
+ * add_tag -- Put tag at end of tag list
+ *====================================*/
+static void
+add_tag (STRING tag)
+{
+	if (dbtagcount+1 >= dbtagmax) {
+		INT newmax = dbtagmax ? 2*dbtagmax : 64;
+		INT *newnums = (INT *) stdalloc(newmax*sizeof(INT));
+		if (dbtagnums) {
+			memcpy(newnums, dbtagnums, dbtagmax*sizeof(INT));
+			stdfree(dbtagnums);
+		}
+		dbtagnums = newnums;
+		dbtagmax = newmax;
+	}
+	dbtagnums[++dbtagcount] = tag_to_num(tag);
+	insert_table_int(dbtagtab, tag, dbtagcount);
+}
+/*======================================
+ * load_tags -- Read tag list from database
+ *  (only tags not yet read are added)
+ *====================================*/
+static void
+load_tags (void)
+{
+	STRING rawrec, p, q;
+	INT len, i;
+	if (!dbtagtab)
+		dbtagtab = create_table_int();
+	tagsloaded = TRUE;
+	if (!(rawrec = retrieve_raw_record(BINREC_TAGKEY, &len)))
+		return;
+	for (p = rawrec, i = 0; *p; p = q, ++i) {
+		if (!(q = strchr(p, '\n')))
+			break;
+		*q++ = 0;
+		if (i >= dbtagcount)
+			add_tag(p);
+	}
+	stdfree(rawrec);
+}
+/*======================================
+ * save_tags -- Write tag list to database
+ *====================================*/
+static void
+save_tags (void)
+{
+	STRING str, p;
+	INT len = 0, i;
+	for (i = 1; i <= dbtagcount; ++i)
+		len += strlen(tagnames[dbtagnums[i]]) + 1;
+	p = str = (STRING) stdalloc(len + 1);
+	for (i = 1; i <= dbtagcount; ++i) {
+		strcpy(p, tagnames[dbtagnums[i]]);
+		p += strlen(p);
+		*p++ = '\n';
+	}
+	*p = 0;
+	ASSERT(store_record(BINREC_TAGKEY, str, len));
+	stdfree(str);
+	newtags = FALSE;
+}
+/*======================================
+ * want_binary_records -- Should records be written binary ?
+ *====================================*/
+BOOLEAN
+want_binary_records (void)
+{
+	return getlloptint("BinaryRecords", 0) != 0;
+}
+/*======================================
+ * free_binary_tags -- Forget tag list of database
+ *  (when closing it)
+ *====================================*/
+void
+free_binary_tags (void)
+{
+	if (dbtagtab) {
+		destroy_table(dbtagtab);
+		dbtagtab = NULL;
+	}
+	if (dbtagnums) {
+		stdfree(dbtagnums);
+		dbtagnums = NULL;
+	}
+	dbtagcount = dbtagmax = 0;
+	tagsloaded = newtags = FALSE;
+}
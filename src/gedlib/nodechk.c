@@ -85,7 +85,7 @@ check_node (NODE node, NODE parent, INT level, CNSTRING key, CNSTRING scope)
 		failreport("bad parent link", level, key, scope);
 	}
 	if (parent) {
-		if (node->n_cel != parent->n_cel) {
+		if (ncel(node) != ncel(parent)) {
 			failreport("bad cel", level, key, scope);
 		}
 	}
@@ -44,6 +44,12 @@ static BOOLEAN buffer_to_line(STRING p, INT *plev, STRING *pxref
 static NODE do_first_fp_to_node(FILE *fp, BOOLEAN list, XLAT tt
 	, STRING *pmsg, BOOLEAN *peof);
 static void prefix_file(FILE *fp, XLAT tt);
+static void defer_children(NODE node, INT lev, STRING *pstr);
+static INT line_level(CNSTRING p);
+static BOOLEAN line_ok(CNSTRING p);
+static NODE parse_nodes(NDARENA arena, STRING str, NODE prnt, BOOLEAN lazy);
+static NODE read_nodes(STRING str, INT len, BOOLEAN keep);
+static RECORD read_record(STRING str, CNSTRING key, INT len, BOOLEAN keep);
 static BOOLEAN string_to_line(STRING *ps, INT *plev, STRING *pxref, 
 	STRING *ptag, STRING *pval, STRING *pmsg);
 static STRING swrite_node(INT levl, NODE node, STRING p);
@@ -433,16 +439,37 @@ next_fp_to_node (FILE *fp, BOOLEAN list, XLAT ttm,
  *==========================================*/
 RECORD
 string_to_record (STRING str, CNSTRING key, INT len)
+{
+	return read_record(str, key, len, FALSE);
+}
+/*============================================
+ * keep_string_to_record -- Read record from data block
+ *  which its nodes keep (see keep_string_to_node)
+ * returns addref'd record
+ *==========================================*/
+RECORD
+keep_string_to_record (STRING str, CNSTRING key, INT len)
+{
+	return read_record(str, key, len, TRUE);
+}
+/*============================================
+ * read_record -- Read record from data block
+ *  keep: [IN]  nodes keep str (else copy from it)
+ * returns addref'd record
+ *==========================================*/
+static RECORD
+read_record (STRING str, CNSTRING key, INT len, BOOLEAN keep)
 {
 	RECORD rec = 0;
 	NODE node = 0;
-	len=len; /* unused */
 
 	/* we must fill in the top field */
 
 	if (*str == '0') { /* traditional node, no metadata */
 		/* actually no metadata was ever used in any version */
-		node = string_to_node(str);
+		node = read_nodes(str, len, keep);
+	} else if (is_binary_record(str)) { /* see nodebin.c */
+		node = binary_to_node(str, len, keep);
 	} else {
 		if (!strcmp(str, "DELE\n")) {
 			/* should have been filtered out in getrecord */
@@ -459,9 +486,78 @@ string_to_record (STRING str, CNSTRING key, INT len)
 /*========================================
  * string_to_node -- Read tree from string
  *  (modifies string -- adds 0s between lines)
+ *  (string may be binary record -- see nodebin.c)
+ *  len: [IN]  length of string (needed by binary record)
+ *  Nodes & their strings are put in one arena (see node.c)
+ *======================================*/
+NODE
+string_to_node (STRING str, INT len)
+{
+	return read_nodes(str, len, FALSE);
+}
+/*========================================
+ * keep_string_to_node -- Read tree from string, which
+ *  the tree keeps, pointing its xrefs & values into it
+ *  rather than copying them (see node.c)
+ *  str: [IN]  from stdalloc; freed with tree (or now, if error)
+ *  len: [IN]  length of string
  *======================================*/
 NODE
-string_to_node (STRING str)
+keep_string_to_node (STRING str, INT len)
+{
+	return read_nodes(str, len, TRUE);
+}
+/*========================================
+ * read_nodes -- Read tree from string
+ *  (modifies string -- adds 0s between lines)
+ *  len:  [IN]  length of string (binary record is not read past it)
+ *  keep: [IN]  nodes keep str (else copy from it)
+ *  If nodes keep str, the children of level 1 lines are only
+ *  read in when first followed (see expand_node).
+ *======================================*/
+static NODE
+read_nodes (STRING str, INT len, BOOLEAN keep)
+{
+	NODE root;
+	NDARENA arena;
+	if (is_binary_record(str))
+		return binary_to_node(str, len, keep);
+	arena = create_node_arena(str, keep);
+	if ((root = parse_nodes(arena, str, NULL, keep)))
+		nodechk(root, "string_to_node");
+	release_node_arena(arena);
+	return root;
+}
+/*========================================
+ * expand_node -- Read in children of node, which were
+ *  left in record text when it was read (see defer_children)
+ *  returns address of first child field (for nchild macro)
+ *======================================*/
+NODE *
+expand_node (NODE node)
+{
+	STRING str = (STRING) node->n_child;
+	INT lineno = flineno; /* may be reading a file meanwhile */
+	nflag(node) &= ~ND_LAZY;
+	node->n_child = parse_nodes(narena(node), str, node, FALSE);
+	flineno = lineno;
+	/* lines were checked before being left (see line_ok), so their
+	 loss would silently drop data when the record is next saved */
+	if (!node->n_child)
+		FATAL2("Children of record line could not be read");
+	return &node->n_child;
+}
+/*========================================
+ * parse_nodes -- Read nodes from string into arena
+ *  (modifies string -- adds 0s between lines)
+ *  prnt: [IN]  parent of nodes read (NULL for record)
+ *  lazy: [IN]  leave children of lines 1 level below first
+ *              in string (see defer_children)
+ *  returns first node read (others are its siblings & their
+ *  descendants), or NULL if error
+ *======================================*/
+static NODE
+parse_nodes (NDARENA arena, STRING str, NODE prnt, BOOLEAN lazy)
 {
 	INT lev;
 	INT lev0;
@@ -474,16 +570,20 @@ string_to_node (STRING str)
 	STRING msg;
 	flineno = 0;
 	if (!string_to_line(&str, &lev, &xref, &tag, &val, &msg))
-		goto string_to_node_fail;
+		goto parse_nodes_fail;
 	lev0 = curlev = lev;
-	root = curnode = create_node(xref, tag, val, NULL);
-	while (string_to_line(&str, &lev, &xref, &tag, &val, &msg)) {
+	root = curnode = create_arena_node(arena, xref, tag, val, prnt);
+	while (TRUE) {
+		if (lazy && curlev == lev0 + 1)
+			defer_children(curnode, curlev, &str);
+		if (!string_to_line(&str, &lev, &xref, &tag, &val, &msg))
+			break;
 		if (lev == curlev) {
-			node = create_node(xref, tag, val, nparent(curnode));
+			node = create_arena_node(arena, xref, tag, val, nparent(curnode));
 			nsibling(curnode) = node;
 			curnode = node;
 		} else if (lev == curlev + 1) {
-			node = create_node(xref, tag, val, curnode);
+			node = create_arena_node(arena, xref, tag, val, curnode);
 			nchild(curnode) = node;
 			curnode = node;
 			curlev = lev;
@@ -491,28 +591,110 @@ string_to_node (STRING str)
 			if (lev < lev0) {
 				llwprintf("Error: line %d: illegal level",
 				    flineno);
-				goto string_to_node_fail;
+				goto parse_nodes_fail;
 			}
 			while (lev < curlev) {
 				curnode = nparent(curnode);
 				curlev--;
 			}
-			node = create_node(xref, tag, val, nparent(curnode));
+			node = create_arena_node(arena, xref, tag, val, nparent(curnode));
 			nsibling(curnode) = node;
 			curnode = node;
 		} else {
 			llwprintf("Error: line %d: illegal level", flineno);
-			goto string_to_node_fail;
+			goto parse_nodes_fail;
 		}
 	}
-	if (!msg) {
-		nodechk(root, "string_to_node");
+	if (!msg)
 		return root;
-	}
-string_to_node_fail:
+parse_nodes_fail:
 	free_nodes(root);
 	return NULL;
 }
+/*========================================
+ * defer_children -- Leave lines of children of node in
+ *  record text, to be read in when first followed
+ *  node: [IN]  node just read, at level lev
+ *  pstr: [I/O] rest of record text (advanced past children)
+ * Children are only left if their lines would all be read
+ *  without error (see line_ok), & none is more than 1 level
+ *  below the line before (else they are read now, so that a
+ *  bad line is found as before).
+ * While node is lazy, its child field holds the text of its
+ *  children (0 inserted after it).
+ *======================================*/
+static void
+defer_children (NODE node, INT lev, STRING *pstr)
+{
+	STRING p = *pstr;
+	INT prevlev = lev, nextlev;
+	if (line_level(p) != lev+1)
+		return;
+	while ((nextlev = line_level(p)) > lev) {
+		if (nextlev > prevlev+1 || !line_ok(p))
+			return;
+		prevlev = nextlev;
+		while (*p && *p != '\n') p++;
+		if (*p) p++;
+	}
+	if (*p) {
+		if (nextlev < 0)
+			return;
+		p[-1] = 0;
+	}
+	nflag(node) |= ND_LAZY;
+	node->n_child = (NODE) *pstr;
+	*pstr = p;
+}
+/*========================================
+ * line_level -- Level of line in record text
+ *  returns -1 if none (or if no line)
+ *======================================*/
+static INT
+line_level (CNSTRING p)
+{
+	INT lev;
+	while (iswhite((uchar)*p) && *p != '\n') p++;
+	if (chartype((uchar)*p) != DIGIT)
+		return -1;
+	lev = 0;
+	while (chartype((uchar)*p) == DIGIT)
+		lev = lev*10 + (uchar)*p++ - (uchar)'0';
+	return lev;
+}
+/*========================================
+ * line_ok -- Would line of record text be read without
+ *  error (see buffer_to_line) ?
+ *  p: [IN]  start of line (which ends at newline or 0)
+ *======================================*/
+static BOOLEAN
+line_ok (CNSTRING p)
+{
+	CNSTRING end = p;
+	while (*end && *end != '\n') end++;
+	/* trailing white space is stripped before length is checked */
+	while (end > p && iswhite((uchar)end[-1])) end--;
+	if (end - p > MAXLINELEN)
+		return FALSE;
+	while (p < end && iswhite((uchar)*p)) p++;
+	if (p == end || chartype((uchar)*p) != DIGIT)
+		return FALSE;
+	while (p < end && chartype((uchar)*p) == DIGIT) p++;
+	while (p < end && iswhite((uchar)*p)) p++;
+	if (p == end)
+		return FALSE; /* no tag */
+	if (*p != '@')
+		return TRUE;
+	if (++p < end && *p == '@')
+		return FALSE; /* blank xref */
+	while (p < end && *p != '@') p++;
+	if (p == end || ++p == end)
+		return FALSE; /* xref not closed, or no tag */
+	if (!iswhite((uchar)*p))
+		return FALSE; /* no space after xref */
+	while (p < end && iswhite((uchar)*p)) p++;
+	return p < end; /* tag */
+}
 #if 0
 /*============================================
  * node_to_file -- Convert tree to GEDCOM file
@@ -375,7 +375,7 @@ resolve_refn_links (NODE node)
 	INT unresolved = 0;
 	BOOLEAN annotate_pointers = (getlloptint("AnnotatePointers", 0) > 0);
 	NODE child=0;
-	CACHEEL cel = node ? node->n_cel: 0;
+	CACHEEL cel = node ? ncel(node) : 0;
 	struct tag_node_iter nodeit;
 
 	if (!node) return 0;
@@ -410,8 +410,7 @@ resolve_node (NODE node, BOOLEAN annotate_pointers)
 		INT letr = record_letter(ntag(node));
 		NODE refr = refn_to_record(refn, letr);
 		if (refr) {
-			stdfree(nval(node));
-			nval(node) = strsave(nxref(refr));
+			change_node_value(node, nxref(refr));
 		} else {
 			return FALSE;
 		}
@@ -425,8 +424,7 @@ resolve_node (NODE node, BOOLEAN annotate_pointers)
 				newval[i] = nval(node)[i];
 			}
 			newval[i] = 0;
-			stdfree(nval(node));
-			nval(node) = strsave(newval);
+			change_node_value(node, newval);
 		}
 	}
 
@@ -471,7 +469,7 @@ annotate_with_supplemental (NODE node, RFMT rfmt)
 	BOOLEAN expand_refns = (getlloptint("ExpandRefnsDuringEdit", 0) > 0);
 	BOOLEAN annotate_pointers = (getlloptint("AnnotatePointers", 0) > 0);
 	NODE child=0;
-	CACHEEL cel = node->n_cel;
+	CACHEEL cel = ncel(node);
 	struct tag_node_iter nodeit;
 
 	if (cel) lock_cache(cel); /* ensure node doesn't fall out of cache */
@@ -514,8 +512,7 @@ annotate_node (NODE node, BOOLEAN expand_refns, BOOLEAN annotate_pointers, RFMT
 			strcpy(buffer, "<");
 			strcat(buffer, nval(refn));
 			strcat(buffer, ">");
-			stdfree(nval(node));
-			nval(node) = strsave(buffer);
+			change_node_value(node, buffer);
 		}
 	}
 
@@ -525,8 +522,7 @@ annotate_node (NODE node, BOOLEAN expand_refns, BOOLEAN annotate_pointers, RFMT
 		zs_apps(zstr, " {{");
 		zs_apps(zstr, str);
 		zs_apps(zstr, " }}");
-		stdfree(nval(node));
-		nval(node) = strsave(zs_str(zstr));
+		change_node_value(node, zs_str(zstr));
 		zs_free(&zstr);
 	}
 }
@@ -69,6 +69,9 @@ remove_indi_by_root (NODE indi)
 /* Factor out portions critical to lifelines (lineage-linking, names, & refns) */
 	split_indi_old(indi, &name, &refn, &sex, &body, &famc, &fams);
 
+/* All changes to database are one transaction */
+	begin_store_batch();
+
 /* Remove person from families he/she is in as a parent */
 
 	for (node = fams; node; node = nsibling(node)) {
@@ -115,6 +118,7 @@ remove_indi_by_root (NODE indi)
 /* Remove from on-disk database */
 	del_in_dbase(key);
 
+	commit_store_batch();
 }
 /*==========================================
  * remove_empty_fam -- Delete family from database
@@ -151,10 +155,12 @@ remove_empty_fam (NODE fam)
 	fam = 0; /* clear pointer to vanished nodes */
 
 /* Remove any refn entries */
+	begin_store_batch();
 	remove_refn_list(refn, key);
 
 /* Remove from on-disk database */
 	del_in_dbase(key);
+	commit_store_batch();
 
 	return TRUE;
 }
@@ -186,11 +192,13 @@ remove_child (NODE indi, NODE fam)
 	free_node(node);
 
 /* Update database with changed records */
+	begin_store_batch();
 	indi_to_dbase(indi);
 	if (num_fam_xrefs(fam) == 0)
 		remove_empty_fam(fam);
 	else
 		fam_to_dbase(fam);
+	commit_store_batch();
 	return TRUE;
 }
 /*===========================================
@@ -227,6 +235,7 @@ remove_spouse (NODE indi, NODE fam)
 	node = NULL;
 
 /* Update database with change records */
+	begin_store_batch();
 	indi_to_dbase(indi);
 
 /* Update family (delete if empty) */
@@ -234,6 +243,7 @@ remove_spouse (NODE indi, NODE fam)
 		fam_to_dbase(fam);
 	else
 		remove_empty_fam(fam);
+	commit_store_batch();
 
 	return TRUE;
 }
@@ -285,10 +295,12 @@ remove_any_record (RECORD record)
 	record=NULL; /* record no longer valid */
 
 /* Remove any refn entries */
+	begin_store_batch();
 	remove_refn_list(refn, key);
 
 /* Remove from on-disk database */
 	del_in_dbase(key);
+	commit_store_batch();
 
 /* Reassemble & delete the in-memory record we're holding (root) */
 	join_othr(root, refn, rest);
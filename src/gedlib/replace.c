@@ -62,8 +62,9 @@ replace_indi (NODE indi1, NODE indi2)
 	free_node(indi2);
 	nodechk(indi1, "replace_indi");
 
-	/* Write data to database */
+	/* Write data to database (as one transaction) */
 
+	begin_store_batch();
 	indi_to_dbase(indi1);
 	key = rmvat(nxref(indi1));
 	/* update name & refn info */
@@ -81,6 +82,7 @@ replace_indi (NODE indi1, NODE indi2)
 		if (nval(node)) remove_refn(nval(node), key);
 	for (node = refnn; node; node = nsibling(node))
 		if (nval(node)) add_refn(nval(node), key);
+	commit_store_batch();
 
 /* now cleanup (indi1 tree is now composed of indi2 data) */
 	free_nodes(name1);
@@ -116,9 +118,9 @@ replace_fam (NODE fam1, NODE fam2)
 	join_fam(fam1, refn2, husb, wife, chil, body);
 	free_node(fam2);
 
-	/* Write data to database */
-	
+	/* Write data to database (as one transaction) */
 
+	begin_store_batch();
 	fam_to_dbase(fam1);
 	key = rmvat(nxref(fam1));
 	/* remove deleted refns & add new ones */
@@ -127,6 +129,7 @@ replace_fam (NODE fam1, NODE fam2)
 		if (nval(node)) remove_refn(nval(node), key);
 	for (node = refnn; node; node = nsibling(node))
 		if (nval(node)) add_refn(nval(node), key);
+	commit_store_batch();
 	free_nodes(refn1);
 	free_nodes(refnn);
 	free_nodes(refn1n);
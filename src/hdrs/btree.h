@@ -34,12 +34,34 @@
 #define _BTREE_H
 
 #include "standard.h"
+#include <stddef.h> /* offsetof */
 
+/* default (& smallest) size of index & block headers; a database
+ may be created with larger ones (see KEYFILE2 & BTFLGPAGE) */
 #define BUFLEN 4096
+/* largest size of index & block headers */
+#define BTMAXPAGELEN (16*BUFLEN)
+
+/*
+Layout of index & block headers of the open btree(s), which all
+have the same size (see bt_openbtree). It is set when a btree is
+opened, and is that of BUFLEN until then.
+*/
+typedef struct {
+	INT g_pagelen;  /* size of index & block headers */
+	INT g_noents;   /* max keys of index */
+	INT g_norecs;   /* max records of block */
+	INT g_fkeyoff;  /* offset of fkeys in index */
+	INT g_offsoff;  /* offset of offs in block */
+	INT g_lensoff;  /* offset of lens in block */
+} BTGEOMETRY;
+extern BTGEOMETRY btgeom;
+
+#define PAGELEN (btgeom.g_pagelen)
 /* see comment at declaration of INDEX below for explanation */
-#define NOENTS ((BUFLEN-12)/12)
+#define NOENTS (btgeom.g_noents)
 /* see comment at declaration of BLOCK below for explanation */
-#define NORECS ((BUFLEN-12)/16)
+#define NORECS (btgeom.g_norecs)
 
 /*
 All records in a LifeLines btree are indexed on 8 character keys
@@ -73,64 +95,116 @@ typedef struct {
 	char name[18]; /* KF_NAME */
 	INT magic;     /* KF_MAGIC */ /* byte alignment check */
 	INT version;   /* KF_VER */
+	INT pagelen;   /* size of headers (only stored if KF2_VERPAGE) */
 } KEYFILE2;
 
 #define KF2_NAME "LifeLines Keyfile"
 #define KF2_MAGIC 0x12345678
 #define KF2_VER 1
+/* version of database with headers larger than BUFLEN */
+#define KF2_VERPAGE 2
+/* bytes of KEYFILE2 stored by KF2_VER */
+#define KF2_V1LEN ((INT)offsetof(KEYFILE2, pagelen))
 
 /*==============================================
  * INDEX -- Data structure for BTREE index files
  *  The constant NOENTS above depends on this exact contents:
  * 12=4+2+4+2=sizeof(FKEY)+sizeof(SHORT)+sizeof(FKEY)+sizeof(SHORT)
  * 12=8+4=sizeof(RKEY)+sizeof(FKEY)
+ *  The arrays are NOENTS long, which depends on the page length,
+ *  so the fkeys are found at g_fkeyoff (see fkeys)
  *============================================*/
 typedef struct {
 	FKEY  ix_self;		/*fkey of index*/
 	SHORT ix_type;           /*block/file type*/
 	FKEY  ix_parent;         /*parent file's fkey*/
 	SHORT ix_nkeys;          /*num of keys in index*/
-	RKEY  ix_rkeys[NOENTS];  /*rkeys in index*/
-	FKEY  ix_fkeys[NOENTS];  /*fkeys in index*/
+	RKEY  ix_rkeys[1];       /*rkeys in index (NOENTS)*/
+	/* FKEY ix_fkeys[NOENTS]; fkeys in index */
 } *INDEX, INDEXSTRUCT;
 /*=======================================
  * BTREE -- Internal BTREE data structure
  *=====================================*/
+typedef struct tag_indexcache *INDEXCACHE; /* private to btree library */
+typedef struct tag_mapcache *MAPCACHE; /* private to btree library */
+typedef struct tag_fdcache *FDCACHE; /* private to btree library */
+typedef struct tag_wal *WAL; /* private to btree library */
+typedef struct tag_btcursor *BTCURSOR; /* private to btree library */
+typedef struct tag_pagefile *PAGEFILE; /* private to btree library */
+typedef struct tag_btshared *BTSHARED; /* private to btree library */
+typedef struct tag_bloomset *BLOOMSET; /* private to btree library */
+typedef struct tag_btsnap *BTSNAP; /* private to btree library */
+/*============================================
+ * BTCOUNTERS -- I/O activity of BTREE since open (see bt_getcounters)
+ *  Not kept while btree is shared (bt_setshared)
+ *==========================================*/
+typedef struct {
+	long c_gets;        /* records looked up (bt_getrecord) */
+	long c_adds;        /* records added or replaced (bt_addrecord) */
+	long c_hits;        /* headers found in index cache (getindex) */
+	long c_misses;      /* headers read into index cache */
+	long c_opens;       /* btree files opened */
+	long c_readrecs;    /* records read from data blocks (readrec) */
+	long c_bytesread;   /* bytes of headers & records read */
+	long c_byteswritten;/* bytes of headers & blocks written */
+	long c_blocksplits; /* data blocks split */
+	long c_indexsplits; /* indices split (addkey) */
+	long c_moves;       /* files replaced by rewritten ones (movefiles) */
+} BTCOUNTERS;
 typedef struct {
 	STRING  b_basedir;   /* btree base directory */
 	INDEX   b_master;    /* master index block */
 	FKEY    b_nkey;      /* next index key */
 	FILE   *b_kfp;       /* keyfile file pointer */
 	KEYFILE1 b_kfile;    /* keyfile contents */
-	INT     b_ncache;    /* number of indices in cache */
-	INDEX  *b_cache;     /* index cache */
+	INDEXCACHE b_cache;  /* index & block header cache */
 	BOOLEAN b_write;     /* database writeable? */
 	BOOLEAN b_immut;     /* database immutable? */
+	MAPCACHE b_mapcache; /* mapped files (readonly only) */
+	FDCACHE b_fdcache;   /* open file descriptors */
+	WAL     b_wal;       /* write-ahead log (batches) */
+	PAGEFILE b_pagefile; /* single paged file (or NULL if directory) */
+	BOOLEAN b_pack;      /* write compressed data blocks? */
+	BTSHARED b_shared;   /* thread-safe readonly access (or NULL) */
+	BLOOMSET b_filters;  /* key filters of data blocks (or NULL) */
+	BTCOUNTERS b_counters; /* I/O activity */
+	STRING  b_statslog;  /* file to log counters to (or NULL) */
+	INT     b_statsevery; /* log counters every so many records */
+	BTSNAP  b_snap;      /* snapshot readers or writer (or NULL) */
 } *BTREE, BTREESTRUCT;
 #define bbasedir(b) ((b)->b_basedir)
 #define bmaster(b)  ((b)->b_master)
 /* #define bnkey(b)    ((b)->b_nkey) */ /* UNUSED */
 #define bkfp(b)     ((b)->b_kfp)
 #define bkfile(b)   ((b)->b_kfile)
-#define bncache(b)  ((b)->b_ncache)
 #define bcache(b)   ((b)->b_cache)
 #define bwrite(b)   ((b)->b_write)
 #define bimmut(b)   ((b)->b_immut)
+#define bmapcache(b) ((b)->b_mapcache)
+#define bfdcache(b) ((b)->b_fdcache)
+#define bwal(b)     ((b)->b_wal)
+#define bpagefile(b) ((b)->b_pagefile)
+#define bpack(b)    ((b)->b_pack)
+#define bshared(b)  ((b)->b_shared)
+#define bfilters(b) ((b)->b_filters)
+#define bcounters(b) ((b)->b_counters)
+#define bsnap(b)    ((b)->b_snap)
 
 /*======================================================
  * BLOCK -- Data structure for BTREE record file headers
  *  The constant NORECS above depends on this exact contents:
  * 12=4+2+4+2=sizeof(FKEY)+sizeof(SHORT)+sizeof(FKEY)+sizeof(SHORT)
  * 16=8+4+4=sizeof(RKEY)+sizeof(INT)+sizeof(INT)
+ *  As with INDEX, offs & lens follow rkeys at runtime offsets
  *====================================================*/
 typedef struct {
 	FKEY   ix_self;             /*fkey of this block*/
 	SHORT  ix_type;		/*block/file type*/
 	FKEY   ix_parent;           /*parent file's fkey*/
 	SHORT  ix_nkeys;            /*num of keys in block*/
-	RKEY   ix_rkeys[NORECS];    /*rkeys in block/file*/
-	INT    ix_offs[NORECS];     /*offsets for data in file*/
-	INT    ix_lens[NORECS];     /*lengths for data in file*/
+	RKEY   ix_rkeys[1];         /*rkeys in block/file (NORECS)*/
+	/* INT ix_offs[NORECS]; offsets for data in file */
+	/* INT ix_lens[NORECS]; lengths for data in file */
 } *BLOCK, BLOCKSTRUCT;
 
 /*============================================
@@ -141,9 +215,9 @@ typedef struct {
 #define ixparent(p)  ((p)->ix_parent)
 #define nkeys(p)   ((p)->ix_nkeys)
 #define rkeys(p,i) ((p)->ix_rkeys[i])
-#define fkeys(p,i) ((p)->ix_fkeys[i])
-#define offs(p,i)  ((p)->ix_offs[i])
-#define lens(p,i)  ((p)->ix_lens[i])
+#define fkeys(p,i) (((FKEY *)((char *)(p) + btgeom.g_fkeyoff))[i])
+#define offs(p,i)  (((INT *)((char *)(p) + btgeom.g_offsoff))[i])
+#define lens(p,i)  (((INT *)((char *)(p) + btgeom.g_lensoff))[i])
 
 /*============================================
  * Traversal function pointer typedefs
@@ -154,10 +228,38 @@ typedef BOOLEAN(*TRAV_BLOCK_FUNC)(BTREE, BLOCK, void*);
 typedef BOOLEAN(*TRAV_RECORD_FUNC_BYKEY)(RKEY, STRING, INT, void*);
 #define TRAV_RECORD_FUNC_BYKEY_ARGS(a,b,c,d) RKEY a, STRING b, INT c, void* d
 
+/*============================================
+ * BTSTATS -- Shape & size of BTREE (see bt_treestats)
+ *==========================================*/
+typedef struct {
+	INT s_levels;   /* levels of index above data blocks */
+	INT s_indexes;  /* index files */
+	INT s_blocks;   /* data block files */
+	INT s_records;  /* records (including DELE records) */
+	INT s_bytes;    /* size of all files (including dead space) */
+} BTSTATS;
+
 /*====================================
  * BTREE library function declarations 
  *==================================*/
 
+/* bloom.c */
+void bt_setfiltersize(BTREE, INT bytes);
+
+/* bulkload.c */
+INT bt_compactbtree(BTREE, TRAV_RECORD_FUNC_BYKEY keep, void *param);
+
+/* compress.c */
+void bt_setcompress(BTREE, BOOLEAN pack);
+
+/* cursor.c */
+BTCURSOR bt_cursor_open(BTREE, RKEY lo, RKEY hi);
+BOOLEAN bt_cursor_next(BTCURSOR, RKEY *prkey, STRING *prec, INT *plen);
+void bt_cursor_close(BTCURSOR);
+
+/* fdcache.c */
+void bt_setfilecache(BTREE, INT n);
+
 /* file.c */
 BOOLEAN addfile(BTREE, RKEY, STRING file);
 BOOLEAN addtextfile(BTREE, RKEY, CNSTRING file, TRANSLFNC);
@@ -167,12 +269,27 @@ RECORD_STATUS write_record_to_textfile(BTREE btree, RKEY rkey, STRING file, TRAN
 /* opnbtree.c */
 BOOLEAN closebtree(BTREE);
 void describe_dberror(INT dberr, STRING buffer, INT buflen);
-BTREE bt_openbtree(STRING dir, BOOLEAN cflag, INT writ, BOOLEAN immut, INT *lldberr);
+BTREE bt_openbtree(STRING dir, INT cflag, INT writ, BOOLEAN immut, INT *lldberr);
+BTREE bt_opensnapshot(STRING dir, INT *lldberr);
+BOOLEAN read_keyfile2(FILE *fp, KEYFILE2 * kfile2);
 BOOLEAN validate_keyfile2(KEYFILE2 * kfile2, INT *lldberr);
 
+/* pagefile.c */
+BOOLEAN bt_pagebtree(BTREE);
+
+/* shared.c */
+BOOLEAN bt_setshared(BTREE);
+
+/* stats.c */
+void bt_formatcounters(const BTCOUNTERS *, STRING buf, INT buflen);
+void bt_getcounters(BTREE, BTCOUNTERS *);
+void bt_resetcounters(BTREE);
+void bt_setstatslog(BTREE, CNSTRING path, INT every);
+
 /* index.c */
 void get_index_file(STRING path, BTREE btr, FKEY ikey);
 INDEX readindex(BTREE btr, FKEY ikey, BOOLEAN robust);
+void bt_setcachesize(BTREE btr, INT bytes);
 
 /* names.c */
 
@@ -182,9 +299,14 @@ RAWRECORD bt_getrecord(BTREE, const RKEY *, INT*);
 BOOLEAN isrecord(BTREE, RKEY);
 INT cmpkeys(const RKEY * rk1, const RKEY * rk2);
 
+/* wal.c */
+void bt_begin_batch(BTREE);
+void bt_commit_batch(BTREE);
+
 /* traverse.c */
 BOOLEAN traverse_index_blocks(BTREE, INDEX, void *, TRAV_INDEX_FUNC ifunc, TRAV_BLOCK_FUNC dfunc);
 void traverse_db_rec_rkeys(BTREE, RKEY lo, RKEY hi, TRAV_RECORD_FUNC_BYKEY func, void *param);
+void bt_treestats(BTREE, BTSTATS *stats);
 
 /* utils.c */
 STRING rkey2str(RKEY);
@@ -213,13 +335,20 @@ enum {
 , BTERR_EXISTS            /* previous database found (create was specified) */
 , BTERR_READERS           /* db locked by readers (string in custom string) */
 , BTERR_BADPROPS          /* new db properties invalid */
+, BTERR_PAGEFILE          /* problem with single paged file */
+, BTERR_PAGELEN           /* page length differs from btree already open */
+, BTERR_SNAPSHOT          /* snapshot not possible (eg, paged btree) */
 
 };
 
 
 #define BTINDEXTYPE 1
 #define BTBLOCKTYPE 2
+#define BTPACKTYPE 3 /* data block of compressed records (see compress.c) */
 
 #define BTFLGCRT (1<<0)
+#define BTFLGPAGED (1<<1) /* create btree as single paged file */
+/* create btree with headers of BUFLEN<<shift bytes (shift 0 to 4) */
+#define BTFLGPAGE(shift) ((shift)<<8)
 
 #endif
@@ -69,32 +69,45 @@
  fields n_parent, n_child, n_sibling which connect it into
  its NODE tree). (E.g., its parent might be a NODE representing
  "1 BIRT".)
+ To keep large caches small, the tag is held as its number in
+ tagtable (see fixtag), and a node read into an arena finds its
+ cache element through the arena, which all the nodes of the
+ record share, rather than holding its own (see ncel).
 */
 typedef struct tag_cacheel *CACHEEL;
+typedef struct tag_ndarena *NDARENA; /* block of nodes of one record (node.c) */
 typedef struct tag_node *NODE;
 struct tag_node {
 	/* a NODE is an OBJECT */
 	struct tag_vtable * vtable; /* generic object table (see vtable.h) */
 	int    n_refcnt;    /* refcount for temp nodes */
+	unsigned int n_tag : 24; /* number of tag (see tagnames) */
+	unsigned int n_flag : 8; /* eg, ND_TEMP */
 	STRING n_xref;      /* cross ref */
-	STRING n_tag;       /* tag */
 	STRING n_val;       /* value */
 	NODE   n_parent;    /* parent */
 	NODE   n_child;     /* first child */
 	NODE   n_sibling;   /* sibling */
-	INT    n_flag;      /* eg, ND_TEMP */
-	CACHEEL n_cel;      /* pointer to cacheel, if node is inside cache */
+	union {
+		CACHEEL u_cel;    /* pointer to cacheel, if node is inside cache */
+		NDARENA u_arena;  /* block holding node & its strings (ND_ARENA) */
+	} n_owner;
 };
 #define nxref(n)    ((n)->n_xref)
-#define ntag(n)     ((n)->n_tag)
+#define ntag(n)     (tagnames[(n)->n_tag])
 #define nval(n)     ((n)->n_val)
 #define nparent(n)  ((n)->n_parent)
-#define nchild(n)   ((n)->n_child)
+#define nchild(n)   (*(nlazy(n) ? expand_node(n) : &(n)->n_child))
 #define nsibling(n) ((n)->n_sibling)
 #define nflag(n)    ((n)->n_flag)
 #define nrefcnt(n)  ((n)->n_refcnt)
-#define ncel(n)     ((n)->n_cel)
-enum { ND_TEMP=1 };
+#define ncel(n)     node_cel(n)
+#define narena(n)   ((nflag(n) & ND_ARENA) ? (n)->n_owner.u_arena : NULL)
+enum { ND_TEMP=1, ND_LAZY=2, ND_ARENA=4 };
+/* children of a record read from the database are read in when first
+ followed (see keep_string_to_node); these do not read them in */
+#define nlazy(n)        (nflag(n) & ND_LAZY)
+#define nloadedchild(n) (nlazy(n) ? NULL : (n)->n_child)
 
 struct tag_nkey { char ntype; INT keynum; char key[MAXKEYWIDTH+1]; };
 typedef struct tag_nkey NKEY;
@@ -201,10 +214,12 @@ extern INT flineno;
 extern BOOLEAN keyflag;
 extern BOOLEAN readonly;
 extern BOOLEAN immutable;
+extern BOOLEAN snapshot;
 extern STRING editstr;
 extern STRING editfile;
 /* tabtable & placabbvs should be moved into LLDATABASE */
 extern TABLE tagtable;		/* table for GEDCOM tags */
+extern STRING *tagnames;	/* GEDCOM tags by number */
 extern TABLE placabbvs;		/* table for place abbrvs */
 extern LLDATABASE def_lldb;        /* default database */
 
@@ -229,7 +244,10 @@ void addxref(CNSTRING key);
 void addxxref(INT key);
 BOOLEAN add_refn(CNSTRING refn, CNSTRING key);
 BOOLEAN are_locales_supported(void);
+void begin_store_batch(void);
 void change_node_tag(NODE node, STRING newtag);
+void change_node_value(NODE node, CNSTRING newval);
+void change_node_xref(NODE node, CNSTRING newxref);
 RECORD choose_child(RECORD irec, RECORD frec, STRING msg0, STRING msgn, ASK1Q ask1);
 void choose_and_remove_family(void);
 RECORD choose_father(RECORD irec, RECORD frec, STRING msg0, STRING msgn, ASK1Q ask1);
@@ -242,12 +260,17 @@ RECORD choose_spouse(RECORD irec, STRING msg0, STRING msgn);
 void classify_nodes(NODE*, NODE*, NODE*);
 void closexref(void);
 void close_lifelines(void);
+void commit_store_batch(void);
 NODE convert_first_fp_to_node(FILE*, BOOLEAN, XLAT, STRING*, BOOLEAN*);
 NODE copy_node(NODE);
 NODE copy_node_subtree(NODE node);
 NODE copy_nodes(NODE node, BOOLEAN kids, BOOLEAN sibs);
 BOOLEAN create_database(STRING dbused, INT *lldberr);
+NODE create_arena_node(NDARENA arena, STRING xref, STRING tag, STRING val, NODE prnt);
+NODE create_arena_tagnum_node(NDARENA arena, STRING xref, INT tagnum, STRING val, NODE prnt);
 NODE create_node(STRING, STRING, STRING, NODE);
+NDARENA create_node_arena(STRING str, BOOLEAN keep);
+NDARENA create_sized_arena(STRING text, INT len, INT nodes, INT strbytes);
 NODE create_temp_node(STRING, STRING, STRING, NODE);
 void delete_metarec(STRING key);
 BOOLEAN edit_mapping(INT);
@@ -276,6 +299,7 @@ INT file_to_line(FILE*, XLAT, INT*, STRING*, STRING*, STRING*, STRING*);
 NODE find_node(NODE, STRING, STRING, NODE*);
 NODE find_tag(NODE, CNSTRING);
 void free_node(NODE);
+void free_node_tags(void);
 void free_nodes(NODE);
 void free_temp_node_tree(NODE);
 STRING full_value(NODE, STRING sep);
@@ -337,6 +361,7 @@ BOOLEAN iso_nodes(NODE, NODE, BOOLEAN, BOOLEAN);
 void join_fam(NODE, NODE, NODE, NODE, NODE, NODE);
 void join_indi(NODE, NODE, NODE, NODE, NODE, NODE, NODE);
 void join_othr(NODE root, NODE refn, NODE rest);
+RECORD keep_string_to_record(STRING str, CNSTRING key, INT len);
 STRING key_of_record(NODE);
 RECORD key_possible_to_record(STRING, INT let);
 NODE key_to_even(CNSTRING);
@@ -385,6 +410,8 @@ void nkey_load_key(NKEY * nkey);
 BOOLEAN nkey_to_node(NKEY * nkey, NODE * node);
 BOOLEAN nkey_to_record(NKEY * nkey, RECORD * prec);
 NKEY nkey_zero(void);
+size_t node_arena_bytes(NDARENA arena);
+CACHEEL node_cel(NODE node);
 void node_to_dbase(NODE, STRING);
 BOOLEAN node_to_file(INT, NODE, STRING, BOOLEAN, TRANTABLE);
 INT node_to_keynum(char ntype, NODE nod);
@@ -430,6 +457,7 @@ NODE record_to_first_event(RECORD record, CNSTRING tag);
 NODE refn_to_record(STRING, INT);
 void register_uicodeset_callback(CALLBACK_FNC fncptr, VPTR uparm);
 void register_uilang_callback(CALLBACK_FNC fncptr, VPTR uparm);
+void release_node_arena(NDARENA arena);
 void release_record(RECORD rec);
 BOOLEAN remove_child(NODE indi, NODE fam);
 BOOLEAN remove_empty_fam(NODE);
@@ -456,6 +484,7 @@ void rptlocale(void);
 void save_original_locales(void);
 BOOLEAN save_tt_to_file(INT ttnum, STRING filename);
 void set_displaykeys(BOOLEAN);
+void set_node_cel(NODE node, CACHEEL cel);
 void set_temp_node(NODE, BOOLEAN temp);
 STRING shorten_plac(STRING);
 void show_node(NODE node);
@@ -469,6 +498,8 @@ void split_othr(NODE node, NODE *prefn, NODE *prest);
 BOOLEAN store_file_to_db(STRING key, STRING file);
 BOOLEAN store_record(CNSTRING key, STRING rec, INT len);
 RECORD string_to_record(STRING str, CNSTRING key, INT len);
+void swap_node_values(NODE one, NODE two);
+INT tag_to_num(STRING tag);
 void termlocale(void);
 BOOLEAN traverse_nodes(NODE node, BOOLEAN (*func)(NODE, VPTR), VPTR param);
 void traverse_refns(TRAV_REFNS_FUNC func, void *param);
@@ -479,6 +510,7 @@ NODE unique_nodes(NODE, BOOLEAN);
 void unknown_node_to_dbase(NODE node);
 void unregister_uilang_callback(CALLBACK_FNC fncptr, VPTR uparm);
 void unregister_uicodeset_callback(CALLBACK_FNC fncptr, VPTR uparm);
+void update_cache_memory(void);
 void update_useropts(VPTR uparm);
 BOOLEAN valid_indi_tree(NODE, STRING*, NODE);
 BOOLEAN valid_fam_tree(NODE, STRING*, NODE);
@@ -560,6 +592,14 @@ INT fam_to_wife(RECORD frec, RECORD * prec);
 NODE fam_to_wife_node(NODE);
 NODE next_node_it_ptr(NODE_ITER nodeit);
 
+/* nodebin.c */
+NODE binary_to_node(STRING str, INT len, BOOLEAN keep);
+STRING binary_to_string(STRING str, INT len);
+void free_binary_tags(void);
+BOOLEAN is_binary_record(CNSTRING str);
+STRING node_to_binary(NODE node, INT *plen);
+BOOLEAN want_binary_records(void);
+
 /* nodechk.c */
 void nodechk(NODE node, CNSTRING scope);
 void nodechk_enable(BOOLEAN enable);
@@ -569,7 +609,9 @@ void prefix_file_for_edit(FILE *fp);
 void prefix_file_for_gedcom(FILE *fp);
 void prefix_file_for_report(FILE *fp);
 STRING node_to_string(NODE);
-NODE string_to_node(STRING);
+NODE * expand_node(NODE node);
+NODE keep_string_to_node(STRING str, INT len);
+NODE string_to_node(STRING str, INT len);
 void write_indi_to_file_for_edit(NODE indi, CNSTRING file, RFMT rfmt);
 void write_fam_to_file_for_edit(NODE fam, CNSTRING file, RFMT rfmt);
 void write_nodes(INT, FILE*, XLAT, NODE, BOOLEAN, BOOLEAN, BOOLEAN);
@@ -49,6 +49,7 @@
 #define LLWRITETEXT "wt"
 #define LLWRITEBINARY "wb"
 #define LLAPPENDTEXT "at"
+#define LLAPPENDBINARY "ab"
 
 #define LLFILERANDOM "R"
 #define LLFILETEMP "T"
@@ -66,6 +67,7 @@
 #define LLWRITETEXT "w"
 #define LLWRITEBINARY "w"
 #define LLAPPENDTEXT "a"
+#define LLAPPENDBINARY "a"
 
 #define LLFILERANDOM ""
 #define LLFILETEMP ""
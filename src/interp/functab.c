@@ -87,6 +87,7 @@ BUILTINS builtins[] = {
 	{"datepic",         1,    1,    llrpt_datepic },
 	{"dayformat",       1,    1,    llrpt_dayformat},
 	{"dayofweek",       1,    1,    llrpt_dayofweek},
+	{"dbstats",         0,    0,    llrpt_dbstats},
 	{"death",           1,    1,    llrpt_deat},
 	{"debug",           1,    1,    llrpt_debug},
 	{"decr",            1,    2,    llrpt_decr},
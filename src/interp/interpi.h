@@ -319,6 +319,7 @@ PVALUE llrpt_dateformat(PNODE, SYMTAB, BOOLEAN *);
 PVALUE llrpt_datepic(PNODE, SYMTAB, BOOLEAN *);
 PVALUE llrpt_dayformat(PNODE, SYMTAB, BOOLEAN *);
 PVALUE llrpt_dayofweek(PNODE, SYMTAB, BOOLEAN *);
+PVALUE llrpt_dbstats(PNODE, SYMTAB, BOOLEAN *);
 PVALUE llrpt_deat(PNODE, SYMTAB, BOOLEAN *);
 PVALUE llrpt_debug(PNODE, SYMTAB, BOOLEAN *);
 PVALUE llrpt_decr(PNODE, SYMTAB, BOOLEAN *);
@@ -40,12 +40,14 @@
 #include "feedback.h" /* call_system_cmd */
 #include "zstr.h"
 #include "version.h"
+#include "btree.h"
 
 /*********************************************
  * external/imported variables
  *********************************************/
 
 extern STRING qSnotonei, qSifonei;
+extern BTREE BTR;
 
 /*********************************************
  * local function prototypes
@@ -275,6 +277,23 @@ llrpt_database (PNODE node, SYMTAB stab, BOOLEAN *eflg)
 	return create_pvalue_from_string(
 	    (full ? readpath : lastpathname(readpath)));
 }
+/*===================================+
+ * llrpt_dbstats -- Return counters of database I/O
+ * usage: dbstats() -> STRING
+ *  eg, "gets=120 adds=0 hits=340 misses=12 ..."
+ *==================================*/
+PVALUE
+llrpt_dbstats (PNODE node, SYMTAB stab, BOOLEAN *eflg)
+{
+	BTCOUNTERS cnts;
+	char buffer[256];
+	node=node; /* unused */
+	stab=stab; /* unused */
+	*eflg = FALSE;
+	bt_getcounters(BTR, &cnts);
+	bt_formatcounters(&cnts, buffer, sizeof(buffer));
+	return create_pvalue_from_string(buffer);
+}
 /*===========================================+
  * llrpt_index -- Find nth occurrence of substring
  * usage: index(STRING, STRING, INT) -> INT
@@ -925,7 +944,7 @@ llrpt_dereference (PNODE node, SYMTAB stab, BOOLEAN *eflg)
 	    *key == 'E' || *key == 'X') {
 		rawrec = retrieve_raw_record(key, &len);
 		if (rawrec)
-			node2 = string_to_node(rawrec);
+			node2 = string_to_node(rawrec, len);
 	}
 	delete_pvalue_ptr(&val);
 	val = create_pvalue_from_node(node2);
@@ -129,7 +129,7 @@ llrpt_addnode (PNODE node, SYMTAB stab, BOOLEAN *eflg)
 	/* reparent node, but ensure its locking is only relative to new parent */
 	dolock_node_in_cache(newchild, FALSE);
 	nparent(newchild) = prnt;
-	newchild->n_cel = prnt->n_cel;
+	set_node_cel(newchild, ncel(prnt));
 	set_temp_node(newchild, is_temp_node(prnt));
 	dolock_node_in_cache(newchild, TRUE);
 	if (prev == NULL) {
@@ -213,7 +213,7 @@ llrpt_writeindi (PNODE node, SYMTAB stab, BOOLEAN *eflg)
 		*/
 		goto end_writeindi;
 	}
-	ASSERT(indi1 = string_to_node(rawrec));
+	ASSERT(indi1 = string_to_node(rawrec, len));
  
 	cnt = resolve_refn_links(indi2);
 	/* validate for showstopper errors */
@@ -274,7 +274,7 @@ llrpt_writefam (PNODE node, SYMTAB stab, BOOLEAN *eflg)
 		*/
 		goto end_writefam;
 	}
-	ASSERT(fam1 = string_to_node(rawrec));
+	ASSERT(fam1 = string_to_node(rawrec, len));
 
 	cnt = resolve_refn_links(fam2);
 	/* validate for showstopper errors */
@@ -176,6 +176,7 @@ add_new_indi_to_db (RECORD indi0)
 	keynum = getixrefnum();
 	sprintf(key, "I%ld", keynum);
 	init_new_record(indi0, key);
+	begin_store_batch();
 	for (node = name; node; node = nsibling(node)) {
 		add_name(nval(node), key);
 	}
@@ -186,6 +187,7 @@ add_new_indi_to_db (RECORD indi0)
 	join_indi(indi, name, refn, sex, body, NULL, NULL);
 	resolve_refn_links(indi);
 	indi_to_dbase(indi);
+	commit_store_batch();
 	add_new_indi_to_cache(indi0);
 }
 /*================================================================
@@ -198,7 +200,7 @@ BOOLEAN
 add_indi_no_cache (NODE indi)
 {
 	NODE node, name, refn, sex, body, famc, fams;
-	STRING str, key;
+	STRING key;
 
 	split_indi_old(indi, &name, &refn, &sex, &body, &famc, &fams);
 	key = rmvat(nxref(indi));
@@ -208,9 +210,7 @@ add_indi_no_cache (NODE indi)
 		if (nval(node)) add_refn(nval(node), key);
 	join_indi(indi, name, refn, sex, body, famc, fams);
 	resolve_refn_links(indi);
-	str = node_to_string(indi);
-	store_record(key, str, strlen(str));
-	stdfree(str);
+	node_to_dbase(indi, NULL);
 	return TRUE;
 }
 /*========================================================
@@ -339,8 +339,10 @@ add_child_to_fam (NODE child, NODE fam, INT i)
 
 	resolve_refn_links(child);
 	resolve_refn_links(fam);
+	begin_store_batch();
 	fam_to_dbase(fam);
 	indi_to_dbase(child);
+	commit_store_batch();
 }
 /*===================================
  * prompt_add_spouse -- Add spouse to family
@@ -454,8 +456,10 @@ add_spouse_to_fam (NODE spouse, NODE fam, INT sex)
 
 	resolve_refn_links(spouse);
 	resolve_refn_links(fam);
+	begin_store_batch();
 	indi_to_dbase(spouse);
 	fam_to_dbase(fam);
+	commit_store_batch();
 }
 /*=========================================
  * add_members_to_family -- Add members to new family
@@ -685,6 +689,7 @@ add_new_fam_to_db (NODE fam2, NODE spouse1, NODE spouse2, NODE child)
 
 	split_fam(fam2, &refn, &husb, &wife, &chil, &body);
 	key = rmvat(nxref(fam2));
+	begin_store_batch();
 	for (node = refn; node; node = nsibling(node))
 		if (nval(node)) add_refn(nval(node), key);
 	join_fam(fam2, refn, husb, wife, chil, body);
@@ -697,6 +702,7 @@ add_new_fam_to_db (NODE fam2, NODE spouse1, NODE spouse2, NODE child)
 	if (spouse1) indi_to_dbase(spouse1);
 	if (spouse2) indi_to_dbase(spouse2);
 	if (child) indi_to_dbase(child);
+	commit_store_batch();
 }
 #ifdef ETHEL
 /*=========================================
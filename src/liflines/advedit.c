@@ -78,7 +78,7 @@ expand_tree (NODE root0)
 		if ((sub = nztop(key_possible_to_record(key, *key)))) {
 			copy = copy_node_subtree(sub);
 			nxref(node)    = nxref(copy);
-			ntag(node)     = ntag(copy);
+			change_node_tag(node, ntag(copy));
 			nchild(node)   = nchild(copy);
 			nparent(node)  = nparent(copy);
 /*MEMORY LEAK; MEMORY LEAK; MEMORY LEAK: node not removed (because its
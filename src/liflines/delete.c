@@ -93,6 +93,8 @@ choose_and_remove_family (void)
 
 	if (ask_yes_or_no(confirm)) {
 
+		/* family goes as one transaction */
+		begin_store_batch();
 		if (ISize(spseq)+ISize(chseq) == 0) {
 			/* handle empty family */
 			remove_empty_fam(fam);
@@ -109,6 +111,7 @@ choose_and_remove_family (void)
 				remove_child(indi, fam);
 			ENDINDISEQ
 		}
+		commit_store_batch();
 	}
 	
 	remove_indiseq(spseq);
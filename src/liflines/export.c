@@ -63,8 +63,7 @@ struct tag_trav_parm {
  *********************************************/
 
 /* alphabetical */
-static BOOLEAN archive(BTREE btree, BLOCK block, void * param);
-static void copy_and_translate(FILE *fo, INT len, struct tag_trav_parm * travparm, char ctype, XLAT xlat);
+static void copy_and_translate(STRING rec, INT len, struct tag_trav_parm * travparm, char ctype, XLAT xlat);
 
 /*********************************************
  * local variables
@@ -95,6 +94,10 @@ archive_in_file (struct tag_export_feedback * efeed, FILE *fp)
 	time_t curtime;
 	STRING str=0;
 	struct tag_trav_parm travparm;
+	BTCURSOR cursor;
+	RKEY lo, hi, rkey;
+	STRING rec;
+	INT len;
 	xlat_gedout = transl_get_predefined_xlat(MINGD); /* internal to GEDCOM */
 
 	curtime = time(NULL);
@@ -129,64 +132,44 @@ archive_in_file (struct tag_export_feedback * efeed, FILE *fp)
 	memset(&travparm, 0, sizeof(travparm));
 	travparm.efeed = efeed;
 	travparm.fp = fp;
-	traverse_index_blocks(BTR, bmaster(BTR), &travparm, NULL, archive);
-	fprintf(fp, "0 TRLR\n");
-	return TRUE;
-}
-/*========================================================
- * archive -- Traverse function called on each btree block
- *======================================================*/
-static BOOLEAN
-archive (BTREE btree, BLOCK block, void * param)
-{
-	INT i, n, l;
-	char scratch[100];
-	FILE *fo=0;
-	struct tag_trav_parm * travparm = (struct tag_trav_parm *)param;
-
-	sprintf(scratch, "%s/%s", bbasedir(btree), fkey2path(ixself(block)));
-	fo = fopen(scratch, LLREADBINARY);
-	ASSERT(fo);
-	n = nkeys(block);
-	for (i = 0; i < n; i++) {
-		STRING key = rkey2str(rkeys(block, i));
+	lo.r_rkey[0] = hi.r_rkey[0] = 0; /* all records */
+	cursor = bt_cursor_open(BTR, lo, hi);
+	while (bt_cursor_next(cursor, &rkey, &rec, &len)) {
+		STRING key = rkey2str(rkey);
 		if (*key != 'I' && *key != 'F' && *key != 'E' &&
 		    *key != 'S' && *key != 'X')
 			continue;
-		if (fseek(fo, (long)(offs(block, i) + BUFLEN), 0))
-			FATAL();
-		if ((l = lens(block, i)) > 6)	/* filter deleted records */
-			copy_and_translate(fo, l, travparm, *key, xlat_gedout);
+		if (len > 6)	/* filter deleted records */
+			copy_and_translate(rec, len, &travparm, *key, xlat_gedout);
 	}
-	fclose(fo);
+	bt_cursor_close(cursor);
+	fprintf(fp, "0 TRLR\n");
 	return TRUE;
 }
 /*===================================================
  * copy_and_translate -- Copy record with translation
  *=================================================*/
 static void
-copy_and_translate (FILE *fo, INT len, struct tag_trav_parm * travparm, char ctype, XLAT xlat)
+copy_and_translate (STRING rec, INT len, struct tag_trav_parm * travparm, char ctype, XLAT xlat)
 {
-	char in[BUFLEN]="";
-	char *inp=0;
-	int remlen=0, num=0;
+	int num=0;
+	BOOLEAN ok=FALSE;
 	FILE * fn = travparm->fp;
 	struct tag_export_feedback * efeed = travparm->efeed;
-	
-	inp = in;		/* location for next read */
-	remlen = BUFLEN;	/* max for next read */
-	while (len > 0) {
-		BOOLEAN last=FALSE, ok=FALSE;
-		if(len < remlen) remlen = len;
-		ASSERT(fread(inp, remlen, 1, fo) == 1);
-		len -= remlen;
-		remlen = (inp + remlen) - in;	/* amount in current buffer */
-		last = (len <= 0);
-		ok = translate_write(xlat, in, &remlen, fn, last);
-		ASSERT(ok);
-		inp = in + remlen;		/* position for next read */
-		remlen = BUFLEN - remlen;	/* max for next read */
+	STRING text=0;
+
+	/* binary records (see nodebin.c) are written as GEDCOM text */
+	if (is_binary_record(rec)) {
+		if (!(text = binary_to_string(rec, len)))
+			return;
+		rec = text;
+		len = strlen(text);
 	}
+	/* whole record is in memory, so it is all translated at once */
+	ok = translate_write(xlat, rec, &len, fn, TRUE);
+	ASSERT(ok);
+	if (text)
+		stdfree(text);
 	num = 0;
 	switch (ctype) {
 	case 'I': num = ++nindi; break;
@@ -294,6 +294,8 @@ TODO: why were these here ?
 
 
 /* Add records to database */
+	/* stored as one batch, so each block is rewritten once per checkpoint */
+	begin_store_batch();
 	node = convert_first_fp_to_node(fp, FALSE, ttm, &msg, &emp);
 	while (node) {
 		if (!(conv = node_to_node(node, &type))) {
@@ -327,6 +329,7 @@ TODO: why were these here ?
 		addmissingkeys(SOUR_REC);
 		addmissingkeys(OTHR_REC);
 	}
+	commit_store_batch();
 	succeeded = TRUE;
 
 end_import:
@@ -342,7 +345,7 @@ end_import:
 static void
 restore_record (NODE node, INT type, INT num)
 {
-	STRING old, new, str, key;
+	STRING old, new, key;
 	char scratch[10];
 
 	if (!node) return;
@@ -367,11 +370,9 @@ restore_record (NODE node, INT type, INT num)
 		return;
 	}
 	resolve_refn_links(node);
-	ASSERT(str = node_to_string(node));
+	node_to_dbase(node, NULL);
 	key = rmvat(nxref(node));
-	ASSERT(store_record(key, str, strlen(str)));
 	index_by_refn(node, key);
-	stdfree(str);
 }
 /*==============================================================
  * translate_key -- Translate key from external to internal form
@@ -416,8 +417,7 @@ translate_values (NODE node, VPTR param)
 	param=param; /* unused */
 	if (!pointer_value(nval(node))) return TRUE;
 	new = translate_key(rmvat(nval(node)));
-	stdfree(nval(node));
-	nval(node) = strsave(new);
+	change_node_value(node, new);
 	return TRUE;
 }
 /*============================================================
@@ -72,6 +72,11 @@ print_lines_usage (CNSTRING exename)
 	printf("\n\t-r\n\t\t");
 	printf(_("open database with read-only access (prohibiting other\n"
 		"\t\twrite access)"));
+	if (0 == strcmp(exename, "llexec")) {
+		printf("\n\t-s\n\t\t");
+		printf(_("read a snapshot of the database, without locking out\n"
+			"\t\ta writer (changes made meanwhile are not seen)"));
+	}
 	printf("\n\t-t\n\t\t");
 	printf(_("trace function calls in report programs (for debugging)"));
 	printf("\n\t");
@@ -48,6 +48,7 @@ extern INT csz_fam;
 extern INT csz_sour;
 extern INT csz_even;
 extern INT csz_othr;
+extern BOOLEAN csz_set;
 
 extern int opterr;
 
@@ -64,6 +65,7 @@ BOOLEAN keyflag   = TRUE;      /* show key values */
 BOOLEAN readonly  = FALSE;     /* database is read only */
 BOOLEAN writeable = FALSE;     /* database must be writeable */
 BOOLEAN immutable = FALSE;     /* make no changes at all to database, for access to truly read-only medium */
+BOOLEAN snapshot  = FALSE;     /* read snapshot of database, as editing goes on */
 INT alldone       = 0;         /* completion flag */
 BOOLEAN progrunning = FALSE;   /* program is running */
 BOOLEAN progparsing = FALSE;   /* program is being parsed */
@@ -155,9 +157,10 @@ main (int argc, char **argv)
 
 	/* Parse Command-Line Arguments */
 	opterr = 0;	/* turn off getopt's error message */
-	while ((c = getopt(argc, argv, "adkrwil:fntc:Fu:x:o:zC:I:vh?")) != -1) {
+	while ((c = getopt(argc, argv, "adkrwisl:fntc:Fu:x:o:zC:I:vh?")) != -1) {
 		switch (c) {
 		case 'c':	/* adjust cache sizes */
+			csz_set = TRUE; /* fixed sizes, not CacheMemoryMB */
 			while(optarg && *optarg) {
 				if(isasciiletter((uchar)*optarg) && isupper((uchar)*optarg))
 					*optarg = tolower((uchar)*optarg);
@@ -219,6 +222,10 @@ main (int argc, char **argv)
 			immutable = TRUE;
 			readonly = TRUE;
 			break;
+		case 's': /* snapshot, alongside a writer */
+			snapshot = TRUE;
+			readonly = TRUE;
+			break;
 		case 'l': /* locking switch */
 			lockchange = TRUE;
 			lockarg = *optarg;
@@ -297,7 +304,7 @@ prompt_for_db:
 	init_interpreter(); /* give interpreter its turn at initialization */
 
 	/* Validate Command-Line Arguments */
-	if ((readonly || immutable) && writeable) {
+	if ((readonly || immutable || snapshot) && writeable) {
 		llwprintf(_(qSnorwandro));
 		goto finish;
 	}
@@ -70,6 +70,7 @@ extern INT csz_fam;
 extern INT csz_sour;
 extern INT csz_even;
 extern INT csz_othr;
+extern BOOLEAN csz_set;
 extern INT winx, winy;
 
 extern int opterr;
@@ -88,6 +89,7 @@ BOOLEAN keyflag   = TRUE;      /* show key values */
 BOOLEAN readonly  = FALSE;     /* database is read only */
 BOOLEAN writeable = FALSE;     /* database must be writeable */
 BOOLEAN immutable = FALSE;     /* make no changes at all to database, for access to truly read-only medium */
+BOOLEAN snapshot  = FALSE;     /* read snapshot of database (llexec only) */
 INT alldone       = 0;         /* completion flag */
 BOOLEAN progrunning = FALSE;   /* program is running */
 BOOLEAN progparsing = FALSE;   /* program is being parsed */
@@ -177,6 +179,7 @@ main (int argc, char **argv)
 	while ((c = getopt(argc, argv, "adkrwil:fntc:Fu:x:o:zC:I:vh?")) != -1) {
 		switch (c) {
 		case 'c':	/* adjust cache sizes */
+			csz_set = TRUE; /* fixed sizes, not CacheMemoryMB */
 			while(optarg && *optarg) {
 				if(isasciiletter((uchar)*optarg) && isupper((uchar)*optarg))
 					*optarg = tolower((uchar)*optarg);
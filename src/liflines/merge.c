@@ -222,7 +222,9 @@ merge_two_indis (NODE indi1, NODE indi2, BOOLEAN conf)
 	}
 
 /* Modify families that have persons as children */
+/* (all database updates of merge are stored as one batch) */
 
+	begin_store_batch();
 	classify_nodes(&famc1, &famc2, &fam12);
 
 /*
@@ -278,8 +280,7 @@ merge_two_indis (NODE indi1, NODE indi2, BOOLEAN conf)
 		that = chil;
 		while (that) {
 			if (eqstr(nval(that), nxref(indi1))) {
-				stdfree(nval(that));
-				nval(that) = strsave(nxref(indi2));
+				change_node_value(that, nxref(indi2));
 			}
 			prev = that;
 			that = nsibling(that);
@@ -346,8 +347,7 @@ merge_two_indis (NODE indi1, NODE indi2, BOOLEAN conf)
 		that = (sx2 == SEX_MALE) ? husb : wife;
 		while (that) {
 			if (eqstr(nval(that), nxref(indi1))) {
-				stdfree(nval(that));
-				nval(that) = strsave(nxref(indi2));
+				change_node_value(that, nxref(indi2));
 			}
 			prev = that;
 			that = nsibling(that);
@@ -415,6 +415,7 @@ merge_two_indis (NODE indi1, NODE indi2, BOOLEAN conf)
 	free_nodes(indi4);
 
 	remove_indi_by_root(indi01);	/* this is the original indi1 */
+	commit_store_batch();
 
 /* sanity check lineage links */
 	check_indi_lineage_links(indi02);
@@ -534,6 +535,7 @@ merge_two_fams (NODE fam1, NODE fam2)
 		return NULL;
 	}
 	split_fam(fam4, &fref4, &husb4, &wife4, &chil4, &rest4);
+	begin_store_batch();
 
  /* Modify links between persons and families */
 #define CHUSB 1
@@ -555,7 +557,7 @@ merge_two_fams (NODE fam1, NODE fam2)
 	join_fam(fam2, fref4, husb4, wife4, chil4, rest4);
 	resolve_refn_links(fam2);
 	fam_to_dbase(fam2);
-
+	commit_store_batch();
 
 /* sanity check lineage links */
 	check_fam_lineage_links(fam2);
@@ -626,8 +628,7 @@ merge_fam_links (NODE fam1, NODE fam2, NODE list1, NODE list2, INT code)
 		} else {
 			while (this) {
 				if (eqstr(nval(this), nxref(fam1))) {
-					stdfree(nval(this));
-					nval(this) = strsave(nxref(fam2));
+					change_node_value(this, nxref(fam2));
 				}
 				prev = this;
 				this = nsibling(this);
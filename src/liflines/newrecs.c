@@ -200,11 +200,13 @@ edit_add_record (STRING recstr, STRING redt, STRING redtopt, char ntype, STRING
 	}
 	nxref(node) = strsave((STRING)(*getreffnc)());
 	key = rmvat(nxref(node));
+	begin_store_batch();
 	for (refn = nchild(node); refn; refn = nsibling(refn)) {
 		if (eqstr("REFN", ntag(refn)) && nval(refn))
 			add_refn(nval(refn), key);
 	}
 	(*todbasefnc)(node);
+	commit_store_batch();
 	(*tocachefnc)(node);
 	return key_to_record(key);
 }
@@ -379,8 +381,9 @@ edit_record (RECORD rec1, STRING idedt, INT letr, STRING redt, STRING redtopt
 	/* now root2 is solitary node, delete it */
 	free_node(root2); root2 = 0;
 
-/* Change the database */
+/* Change the database (as one transaction) */
 
+	begin_store_batch();
 	(*todbase)(root1);
 	key = rmvat(nxref(root1));
 	/* remove deleted refns & add new ones */
@@ -389,6 +392,7 @@ edit_record (RECORD rec1, STRING idedt, INT letr, STRING redt, STRING redtopt
 		if (nval(node)) remove_refn(nval(node), key);
 	for (node = refnn; node; node = nsibling(node))
 		if (nval(node)) add_refn(nval(node), key);
+	commit_store_batch();
 	free_nodes(refn1);
 	free_nodes(refnn);
 	free_nodes(refn1n);
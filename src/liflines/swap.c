@@ -154,14 +154,11 @@ confirm_and_swap_children_impl (NODE fam, NODE one, NODE two)
 static void
 swap_children_impl (NODE fam, NODE one, NODE two)
 {
-	STRING str;
 	NODE tmp;
 	ASSERT(one);
 	ASSERT(two);
    /* Swap CHIL nodes and update database */
-	str = nval(one);
-	nval(one) = nval(two);
-	nval(two) = str;
+	swap_node_values(one, two);
 	tmp = nchild(one);
 	nchild(one) = nchild(two);
 	nchild(two) = tmp;
@@ -226,13 +223,16 @@ gotfam:
 
 	prevorder = child_index(child, fam);
 
-	/* first remove child, so can list others & add back */
+	/* first remove child, so can list others & add back
+	 (in one transaction, so child is never left out of family) */
+	begin_store_batch();
 	remove_child(child, fam);
 
 	i = ask_child_order(fam, ALWAYS_PROMPT, rfmt);
 	if (i == -1 || !ask_yes_or_no(_(qScfchswp))) {
 		/* must put child back if cancel */
 		add_child_to_fam(child, fam, prevorder);
+		commit_store_batch();
 		return FALSE;
 	}
 
@@ -241,6 +241,7 @@ gotfam:
 	add_child_to_fam(child, fam, i);
 
 	fam_to_dbase(fam);
+	commit_store_batch();
 	return TRUE;
 }
 /*=============================================
@@ -276,7 +277,6 @@ swap_families (RECORD irec)
 {
 	NODE indi, fams, one, two, tmp;
 	INT nfam;
-	STRING str;
 
 	if (readonly) {
 		message(_(qSronlye));
@@ -332,9 +332,7 @@ swap_families (RECORD irec)
 		return FALSE;
 
 /* Swap FAMS nodes and update database */
-	str = nval(one);
-	nval(one) = nval(two);
-	nval(two) = str;
+	swap_node_values(one, two);
 	tmp = nchild(one);
 	nchild(one) = nchild(two);
 	nchild(two) = tmp;
@@ -51,6 +51,13 @@ static FILE *logfp = NULL;
 static char scratch[80];
 static INT live_allocs = 0;
 
+/* threads of a shared btree (bt_setshared) allocate at once */
+#ifdef __GNUC__
+#define countalloc(n) __sync_fetch_and_add(&live_allocs, (n))
+#else
+#define countalloc(n) (live_allocs += (n))
+#endif
+
 /*********************************************
  * local function definitions
  * body of module
@@ -75,7 +82,7 @@ __allocate (int len, STRING file, int line)
 		alloc_out(scratch);
 	}
 	ASSERT(p);
-	live_allocs++;
+	countalloc(1);
 	for(i = 0; i <len; i++) p[i] = '\0';
 	if (alloclog) {
 		sprintf(scratch, "%8p A %s\t%d\t%d", p, file, line, len);
@@ -92,7 +99,7 @@ __allocate (int len, STRING file, int line)
 void
 __deallocate (const void *ptr, STRING file, int line)
 {
-	if (ptr) live_allocs--;
+	if (ptr) countalloc(-1);
 	if (alloclog) {
 		sprintf(scratch, "%8p F %s\t%d", ptr, file, line);
 		alloc_out(scratch);
@@ -0,0 +1,226 @@
+/*
+   Copyright (c) 2026 The LifeLines developers
+   "The MIT license"
+   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+/*=================================================================
+ * btbench.c -- Command that times BTREE record lookups
+ *   (bt_getrecord) on a btree it generates, to compare the
+ *   lookup throughput of two builds
+ *   Created: 2026/10
+ *===============================================================*/
+
+#include "llstdlib.h"
+/* llstdlib.h pulls in standard.h, config.h, sys_inc.h */
+#include "btree.h"
+#include <time.h>
+
+/*********************************************
+ * required global variables
+ *********************************************/
+/* defined in liflines/main.c */
+STRING readpath_file = NULL;
+STRING readpath = NULL;
+int opt_finnish = 0;
+int opt_mychar = 0;
+/* defined in gedlib/codesets.c */
+BOOLEAN uu8=0;            /* flag if internal codeset is UTF-8 */
+STRING int_codeset=0;     /* internal codeset */
+
+/*********************************************
+ * local function prototypes
+ *********************************************/
+
+/* alphabetical */
+static RKEY benchkey(INT num);
+static void benchrecord(STRING buf, INT num);
+static INT lookups(BTREE btree, INT nrecs, INT n, BOOLEAN missing);
+static void print_usage(void);
+
+/*********************************************
+ * local variables
+ *********************************************/
+
+static unsigned long seed = 1; /* same lookups every run */
+
+/*********************************************
+ * local function definitions
+ * body of module
+ *********************************************/
+
+/*=========================================
+ * main -- Main procedure of btbench command
+ *=======================================*/
+int
+main (int argc,
+      char **argv)
+{
+	BTREE btree;
+	char *dbname;
+	char rec[200];
+	INT nrecs = 100000, nlooks = 1000000, cachekb = 0, i, bad;
+	INT lldberrnum=0;
+	BOOLEAN immut=FALSE;
+	clock_t start;
+	double secs;
+	BTCOUNTERS counts;
+	char buf[400];
+
+	for (i=1; i<argc; ++i) {
+		if (!strcmp(argv[i], "--help")
+			|| !strcmp(argv[i], "-h")
+			|| !strcmp(argv[i], "-?")) {
+			print_usage();
+			return 0;
+		}
+	}
+	if (argc < 2 || argc > 5
+		|| (argc > 2 && (nrecs = atoi(argv[2])) <= 0)
+		|| (argc > 3 && (nlooks = atoi(argv[3])) <= 0)
+		|| (argc > 4 && (cachekb = atoi(argv[4])) <= 0)) {
+		print_usage();
+		return 10;
+	}
+	dbname = argv[1];
+
+	/* build btree, as import would (one batch, into an empty btree) */
+	if (!(btree = bt_openbtree(dbname, BTFLGCRT, 2, immut, &lldberrnum))) {
+		printf("Failed to create btree: %s\n", dbname);
+		return 20;
+	}
+	start = clock();
+	bt_begin_batch(btree);
+	for (i = 1; i <= nrecs; ++i) {
+		benchrecord(rec, i);
+		bt_addrecord(btree, benchkey(i), rec, strlen(rec));
+	}
+	bt_commit_batch(btree);
+	closebtree(btree);
+	secs = (double)(clock() - start)/CLOCKS_PER_SEC;
+	printf("built %ld records in %.2fs\n", (long)nrecs, secs);
+
+	/* time lookups in btree opened read only, as a report would */
+	if (!(btree = bt_openbtree(dbname, 0, 0, immut, &lldberrnum))) {
+		printf("Failed to open btree: %s\n", dbname);
+		return 20;
+	}
+	if (cachekb)
+		bt_setcachesize(btree, cachekb*1024);
+	start = clock();
+	bad = lookups(btree, nrecs, nlooks, FALSE);
+	secs = (double)(clock() - start)/CLOCKS_PER_SEC;
+	printf("%ld lookups in %.2fs: %.0f lookups/s\n", (long)nlooks
+		, secs, secs > 0 ? nlooks/secs : 0.0);
+	start = clock();
+	bad += lookups(btree, nrecs, nlooks, TRUE);
+	secs = (double)(clock() - start)/CLOCKS_PER_SEC;
+	printf("%ld lookups of missing records in %.2fs: %.0f lookups/s\n"
+		, (long)nlooks, secs, secs > 0 ? nlooks/secs : 0.0);
+	bt_getcounters(btree, &counts);
+	bt_formatcounters(&counts, buf, sizeof(buf));
+	printf("%s\n", buf);
+	closebtree(btree);
+	if (bad) {
+		printf("%ld lookups found wrong record\n", (long)bad);
+		return 30;
+	}
+	return 0;
+}
+/*=========================================
+ * lookups -- Look up records at random
+ *  btree:   [IN]  btree made by main
+ *  nrecs:   [IN]  records in btree
+ *  n:       [IN]  lookups to do
+ *  missing: [IN]  look up keys not in btree instead ?
+ * returns number of lookups with wrong result
+ *=======================================*/
+static INT
+lookups (BTREE btree, INT nrecs, INT n, BOOLEAN missing)
+{
+	char want[200];
+	RAWRECORD rec;
+	RKEY rkey;
+	INT i, num, len, bad = 0;
+
+	for (i = 0; i < n; ++i) {
+		seed = seed*1103515245 + 12345;
+		num = 1 + (INT)((seed >> 8) % (unsigned long)nrecs);
+		rkey = benchkey(missing ? nrecs + num : num);
+		rec = bt_getrecord(btree, &rkey, &len);
+		if (missing) {
+			if (rec) ++bad;
+		} else {
+			benchrecord(want, num);
+			if (!rec || len != (INT)strlen(want) || memcmp(rec, want, len))
+				++bad;
+		}
+		if (rec) stdfree(rec);
+	}
+	return bad;
+}
+/*=========================================
+ * benchkey -- Key of generated record
+ *=======================================*/
+static RKEY
+benchkey (INT num)
+{
+	char key[20];
+	sprintf(key, "I%ld", (long)num);
+	return str2rkey(key);
+}
+/*=========================================
+ * benchrecord -- Text of generated record
+ *  (a small person, as in a typical database)
+ *=======================================*/
+static void
+benchrecord (STRING buf, INT num)
+{
+	sprintf(buf, "0 @I%ld@ INDI\n1 NAME Person /Number%ld/\n1 SEX %c\n"
+		"1 BIRT\n2 DATE %ld\n", (long)num, (long)num
+		, (num % 2) ? 'M' : 'F', (long)(1700 + num % 300));
+}
+/*=============================
+ * __fatal -- Fatal error routine
+ *  handles null or empty details input
+ *===========================*/
+void
+__fatal (STRING file, int line, CNSTRING details)
+{
+	printf("FATAL ERROR: ");
+	if (details && details[0]) {
+		printf("%s", details);
+		printf("\nAT: ");
+	}
+	printf("%s: line %d\n", file, line);
+	exit(1);
+}
+/*===============================================
+ * print_usage -- display program help/usage
+ *  displays to stdout
+ *=============================================*/
+static void
+print_usage (void)
+{
+	printf("lifelines `btbench' creates a new btree of generated\n"
+		"records, then times looking them up at random (and looking\n"
+		"up records that are not there). Run it with the same\n"
+		"arguments from two builds to compare them.");
+	printf("\n\n");
+	printf("Usage btbench [new database] [records] [lookups] [cacheKB]");
+	printf("\n");
+	printf("Default is 100000 records, 1000000 lookups, and the\n"
+		"default index cache (cacheKB is as BtreeCacheKB in lines.cfg)");
+	printf("\n\n");
+	printf("Examples:");
+	printf("\n");
+	printf("\tbtbench /tmp/benchdb 200000");
+	printf("\n\t\t");
+	printf("time lookups in 200000 records");
+	printf("\n");
+	printf("\tbtbench /tmp/benchdb 200000 1000000 65536");
+	printf("\n\t\t");
+	printf("the same, with the whole index cached");
+	printf("\n\n");
+}
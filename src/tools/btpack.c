@@ -0,0 +1,159 @@
+/*
+   Copyright (c) 2026 The LifeLines developers
+   "The MIT license"
+   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+/*=================================================================
+ * btpack.c -- Command that converts a BTREE database kept as a
+ *   directory tree of index & block files into one paged file
+ *   (see btree/pagefile.c)
+ *   Created: 2026/10
+ *===============================================================*/
+
+#include "llstdlib.h"
+/* llstdlib.h pulls in standard.h, config.h, sys_inc.h */
+#include "btree.h"
+#include "version.h"
+
+/*********************************************
+ * required global variables
+ *********************************************/
+/* defined in liflines/main.c */
+STRING readpath_file = NULL;
+STRING readpath = NULL;
+int opt_finnish = 0;
+int opt_mychar = 0;
+/* defined in gedlib/codesets.c */
+BOOLEAN uu8=0;            /* flag if internal codeset is UTF-8 */
+STRING int_codeset=0;     /* internal codeset */
+
+/*********************************************
+ * local function prototypes
+ *********************************************/
+
+/* alphabetical */
+static void print_usage(void);
+
+/*********************************************
+ * local function definitions
+ * body of module
+ *********************************************/
+
+/*=========================================
+ * main -- Main procedure of btpack command
+ *=======================================*/
+int
+main (int argc,
+      char **argv)
+{
+	BTREE btree;
+	char *dbname;
+	BOOLEAN cflag=FALSE; /* create new db if not found */
+	INT writ=2; /* require write access to database */
+	BOOLEAN immut=FALSE; /* immutable access to database */
+	INT lldberrnum=0;
+	int rtn=0;
+	int i=0;
+
+	/* handle conventional arguments --version and --help */
+	/* needed for help2man to synthesize manual pages */
+	for (i=1; i<argc; ++i) {
+		if (!strcmp(argv[i], "--version")
+			|| !strcmp(argv[i], "-v")) {
+			print_version("btpack");
+			return 0;
+		}
+		if (!strcmp(argv[i], "--help")
+			|| !strcmp(argv[i], "-h")
+			|| !strcmp(argv[i], "-?")) {
+			print_usage();
+			return 0;
+		}
+	}
+
+	/* Parse Command-Line Arguments */
+	if (argc != 2) {
+		printf(_("btpack requires 1 argument (btree)."));
+		puts("");
+		printf(_("See `btpack --help' for more information."));
+		puts("");
+		return 10;
+	}
+	dbname = argv[1];
+	if (!(btree = bt_openbtree(dbname, cflag, writ, immut, &lldberrnum))) {
+		printf(_("Failed to open btree: %s."), dbname);
+		puts("");
+		return 20;
+	}
+	if (bpagefile(btree)) {
+		printf(_("Database is already a paged file: %s"), dbname);
+		puts("");
+		rtn = 30;
+		goto finish;
+	}
+	if (!bt_pagebtree(btree)) {
+		printf(_("Failed to convert database: %s"), dbname);
+		puts("");
+		rtn = 40;
+		goto finish;
+	}
+	printf(_("Database converted to paged file: %s"), dbname);
+	puts("");
+	rtn = 0;
+
+finish:
+	closebtree(btree);
+	btree = 0;
+	return rtn;
+}
+/*=============================
+ * __fatal -- Fatal error routine
+ *  handles null or empty details input
+ *===========================*/
+void
+__fatal (STRING file, int line, CNSTRING details)
+{
+	printf("FATAL ERROR: ");
+	if (details && details[0]) {
+		printf("%s", details);
+		printf("\nAT: ");
+	}
+	printf("%s: line %d\n", file, line);
+	exit(1);
+}
+/*===============================================
+ * print_usage -- display program help/usage
+ *  displays to stdout
+ *=============================================*/
+static void
+print_usage (void)
+{
+#ifdef WIN32
+	char * fname = _("\"\\My Documents\\LifeLines\\Databases\\MyFamily\"");
+#else
+	char * fname = _("/home/users/myname/lifelines/databases/myfamily");
+#endif
+
+	printf(_("lifelines `btpack' converts a database kept as a\n"
+		"directory tree of many small files into a database\n"
+		"kept in one paged file. Back up your database first."));
+	printf("\n\n");
+	printf(_("Usage btpack [database]"));
+	printf("\n\n");
+	printf(_("Options:"));
+	printf("\n");
+	printf(_("\t--help\tdisplay this help and exit"));
+	printf("\n");
+	printf(_("\t--version\toutput version information and exit"));
+	printf("\n\n");
+	printf(_("Examples:"));
+	printf("\n");
+	printf(_("\tbtpack %s"), fname);
+	printf("\n\t\t");
+	printf(_("convert database to a single paged file"));
+	printf("\n\n");
+	printf(_("Report bugs to https://github.com/MarcNo/lifelines/issues"));
+	printf("\n");
+}
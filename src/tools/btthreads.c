@@ -0,0 +1,356 @@
+/*
+   Copyright (c) 2026 The LifeLines developers
+   "The MIT license"
+   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+/*=================================================================
+ * btthreads.c -- Command that checks a shared btree (bt_setshared)
+ *   by looking up and scanning records of a btree it generates
+ *   from many threads at once
+ *   Created: 2026/10
+ *===============================================================*/
+
+#include "llstdlib.h"
+/* llstdlib.h pulls in standard.h, config.h, sys_inc.h */
+#include "btree.h"
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+/*********************************************
+ * required global variables
+ *********************************************/
+/* defined in liflines/main.c */
+STRING readpath_file = NULL;
+STRING readpath = NULL;
+int opt_finnish = 0;
+int opt_mychar = 0;
+/* defined in gedlib/codesets.c */
+BOOLEAN uu8=0;            /* flag if internal codeset is UTF-8 */
+STRING int_codeset=0;     /* internal codeset */
+
+/*********************************************
+ * local types
+ *********************************************/
+
+/* work & results of one thread */
+typedef struct {
+	BTREE t_btree;
+	INT t_nrecs;         /* records in btree */
+	INT t_passes;        /* passes to make */
+	unsigned long t_seed;
+	INT t_lookups;       /* [OUT] lookups done */
+	INT t_scans;         /* [OUT] scans done */
+	INT t_bad;           /* [OUT] lookups & scans with wrong result */
+} WORKER;
+
+/*********************************************
+ * local function prototypes
+ *********************************************/
+
+/* alphabetical */
+static INT keynum(const RKEY *rkey);
+static INT lookups(WORKER *w, INT n, BOOLEAN missing);
+static void print_usage(void);
+static INT scan(WORKER *w, INT lo, INT hi);
+static RKEY testkey(INT num);
+static void testrecord(STRING buf, INT num);
+static void *work(void *arg);
+
+/*********************************************
+ * local variables
+ *********************************************/
+
+/* lookups of each kind in each pass */
+#define LOOKUPS 2000
+/* records in each ranged scan */
+#define RANGE 300
+/* most threads */
+#define MAXTHREADS 64
+
+/*********************************************
+ * local function definitions
+ * body of module
+ *********************************************/
+
+/*=========================================
+ * main -- Main procedure of btthreads command
+ *=======================================*/
+int
+main (int argc,
+      char **argv)
+{
+	BTREE btree;
+	char *dbname;
+	char rec[200];
+	INT nrecs = 20000, nthreads = 8, npasses = 4, i, arg = 1;
+	INT lldberrnum=0;
+	INT nlooks = 0, nscans = 0, bad = 0;
+	BOOLEAN immut=FALSE, paged=FALSE;
+	WORKER workers[MAXTHREADS];
+#ifdef HAVE_PTHREAD_H
+	pthread_t threads[MAXTHREADS];
+#endif
+
+	for (i=1; i<argc; ++i) {
+		if (!strcmp(argv[i], "--help")
+			|| !strcmp(argv[i], "-h")
+			|| !strcmp(argv[i], "-?")) {
+			print_usage();
+			return 0;
+		}
+	}
+	if (arg < argc && !strcmp(argv[arg], "-p")) {
+		paged = TRUE;
+		++arg;
+	}
+	if (argc - arg < 1 || argc - arg > 4
+		|| (argc - arg > 1 && (nrecs = atoi(argv[arg+1])) <= RANGE)
+		|| (argc - arg > 2 && ((nthreads = atoi(argv[arg+2])) <= 0
+			|| nthreads > MAXTHREADS))
+		|| (argc - arg > 3 && (npasses = atoi(argv[arg+3])) <= 0)) {
+		print_usage();
+		return 10;
+	}
+	dbname = argv[arg];
+
+	/* build btree, as import would (one batch, into an empty btree) */
+	if (!(btree = bt_openbtree(dbname, BTFLGCRT, 2, immut, &lldberrnum))) {
+		printf("Failed to create btree: %s\n", dbname);
+		return 20;
+	}
+	bt_begin_batch(btree);
+	for (i = 1; i <= nrecs; ++i) {
+		testrecord(rec, i);
+		bt_addrecord(btree, testkey(i), rec, strlen(rec));
+	}
+	bt_commit_batch(btree);
+	if (paged && !bt_pagebtree(btree)) {
+		printf("Failed to convert btree to paged format: %s\n", dbname);
+		return 20;
+	}
+	closebtree(btree);
+	printf("built %ld records%s\n", (long)nrecs, paged ? " (paged)" : "");
+
+	/* open read only, with a small index cache, so that the threads
+	 are often reading headers into the shards & dropping them */
+	if (!(btree = bt_openbtree(dbname, 0, 0, immut, &lldberrnum))) {
+		printf("Failed to open btree: %s\n", dbname);
+		return 20;
+	}
+	bt_setcachesize(btree, 64*1024);
+	if (!bt_setshared(btree)) {
+		printf("shared btrees are not supported on this platform\n");
+		closebtree(btree);
+		return 0;
+	}
+	for (i = 0; i < nthreads; ++i) {
+		workers[i].t_btree = btree;
+		workers[i].t_nrecs = nrecs;
+		workers[i].t_passes = npasses;
+		workers[i].t_seed = 1 + i;
+		workers[i].t_lookups = workers[i].t_scans = workers[i].t_bad = 0;
+	}
+#ifdef HAVE_PTHREAD_H
+	for (i = 0; i < nthreads; ++i) {
+		if (pthread_create(&threads[i], NULL, work, &workers[i])) {
+			printf("Failed to start thread %ld\n", (long)i);
+			return 20;
+		}
+	}
+	for (i = 0; i < nthreads; ++i)
+		pthread_join(threads[i], NULL);
+#else
+	for (i = 0; i < nthreads; ++i)
+		work(&workers[i]);
+#endif
+	closebtree(btree);
+	for (i = 0; i < nthreads; ++i) {
+		nlooks += workers[i].t_lookups;
+		nscans += workers[i].t_scans;
+		bad += workers[i].t_bad;
+	}
+	printf("%ld threads did %ld lookups and %ld scans\n", (long)nthreads
+		, (long)nlooks, (long)nscans);
+	if (bad) {
+		printf("%ld lookups or scans found wrong records\n", (long)bad);
+		return 30;
+	}
+	printf("all records found as stored\n");
+	return 0;
+}
+/*=========================================
+ * work -- Body of thread: look up records at random, and scan
+ *  all records & random ranges of them
+ *  arg: [I/O] WORKER of thread
+ *=======================================*/
+static void *
+work (void *arg)
+{
+	WORKER *w = (WORKER *)arg;
+	INT i, lo;
+
+	for (i = 0; i < w->t_passes; ++i) {
+		w->t_bad += lookups(w, LOOKUPS, FALSE);
+		w->t_bad += lookups(w, LOOKUPS, TRUE);
+		w->t_seed = w->t_seed*1103515245 + 12345;
+		lo = 2 + (INT)((w->t_seed >> 8) % (unsigned long)(w->t_nrecs - RANGE));
+		w->t_bad += scan(w, lo, lo + RANGE - 1);
+		w->t_bad += scan(w, 0, 0);
+	}
+	return NULL;
+}
+/*=========================================
+ * lookups -- Look up records at random
+ *  w:       [I/O] thread doing lookups
+ *  n:       [IN]  lookups to do
+ *  missing: [IN]  look up keys not in btree instead ?
+ * returns number of lookups with wrong result
+ *=======================================*/
+static INT
+lookups (WORKER *w, INT n, BOOLEAN missing)
+{
+	char want[200];
+	RAWRECORD rec;
+	RKEY rkey;
+	INT i, num, len, bad = 0;
+
+	for (i = 0; i < n; ++i) {
+		w->t_seed = w->t_seed*1103515245 + 12345;
+		num = 1 + (INT)((w->t_seed >> 8) % (unsigned long)w->t_nrecs);
+		rkey = testkey(missing ? w->t_nrecs + num : num);
+		rec = bt_getrecord(w->t_btree, &rkey, &len);
+		if (missing) {
+			if (rec) ++bad;
+		} else {
+			testrecord(want, num);
+			if (!rec || len != (INT)strlen(want) || memcmp(rec, want, len))
+				++bad;
+		}
+		if (rec) stdfree(rec);
+		++w->t_lookups;
+	}
+	return bad;
+}
+/*=========================================
+ * scan -- Scan range of records with cursor
+ *  w:  [I/O] thread doing scan
+ *  lo: [IN]  number of first record (0 for all records)
+ *  hi: [IN]  number of last record (0 for all records)
+ * returns 1 if any record is missing, out of order or wrong
+ *=======================================*/
+static INT
+scan (WORKER *w, INT lo, INT hi)
+{
+	char want[200];
+	BTCURSOR cursor;
+	RKEY rlo, rhi, rkey;
+	STRING rec;
+	INT len, num, expect;
+	BOOLEAN ok = TRUE;
+
+	if (lo) {
+		rlo = testkey(lo - 1); /* cursor starts above lo */
+		rhi = testkey(hi);
+	} else {
+		rlo.r_rkey[0] = rhi.r_rkey[0] = 0; /* unbounded */
+		lo = 1;
+		hi = w->t_nrecs;
+	}
+	/* keys are right aligned, so I9 sorts before I10 */
+	expect = lo;
+	cursor = bt_cursor_open(w->t_btree, rlo, rhi);
+	while (ok && bt_cursor_next(cursor, &rkey, &rec, &len)) {
+		num = keynum(&rkey);
+		testrecord(want, expect);
+		ok = (num == expect++)
+			&& len == (INT)strlen(want) && !memcmp(rec, want, len);
+	}
+	bt_cursor_close(cursor);
+	++w->t_scans;
+	return (ok && expect == hi + 1) ? 0 : 1;
+}
+/*=========================================
+ * testkey -- Key of generated record
+ *=======================================*/
+static RKEY
+testkey (INT num)
+{
+	char key[20];
+	sprintf(key, "I%ld", (long)num);
+	return str2rkey(key);
+}
+/*=========================================
+ * keynum -- Number of generated record from its key
+ *  (not rkey2str, whose buffer is shared by all threads)
+ * returns 0 if key is not of a generated record
+ *=======================================*/
+static INT
+keynum (const RKEY *rkey)
+{
+	INT i = 0, num = 0;
+	while (i < RKEYLEN && rkey->r_rkey[i] == ' ')
+		++i;
+	if (i == RKEYLEN || rkey->r_rkey[i++] != 'I')
+		return 0;
+	for (; i < RKEYLEN; ++i) {
+		if (rkey->r_rkey[i] < '0' || rkey->r_rkey[i] > '9')
+			return 0;
+		num = num*10 + rkey->r_rkey[i] - '0';
+	}
+	return num;
+}
+/*=========================================
+ * testrecord -- Text of generated record
+ *  (a small person, as in a typical database)
+ *=======================================*/
+static void
+testrecord (STRING buf, INT num)
+{
+	sprintf(buf, "0 @I%ld@ INDI\n1 NAME Person /Number%ld/\n1 SEX %c\n"
+		"1 BIRT\n2 DATE %ld\n", (long)num, (long)num
+		, (num % 2) ? 'M' : 'F', (long)(1700 + num % 300));
+}
+/*=============================
+ * __fatal -- Fatal error routine
+ *  handles null or empty details input
+ *===========================*/
+void
+__fatal (STRING file, int line, CNSTRING details)
+{
+	printf("FATAL ERROR: ");
+	if (details && details[0]) {
+		printf("%s", details);
+		printf("\nAT: ");
+	}
+	printf("%s: line %d\n", file, line);
+	exit(1);
+}
+/*===============================================
+ * print_usage -- display program help/usage
+ *  displays to stdout
+ *=============================================*/
+static void
+print_usage (void)
+{
+	printf("lifelines `btthreads' creates a new btree of generated\n"
+		"records, opens it read only & shared (bt_setshared), and\n"
+		"checks that threads looking up and scanning records at the\n"
+		"same time all find the records as they were stored.");
+	printf("\n\n");
+	printf("Usage btthreads [-p] [new database] [records] [threads] [passes]");
+	printf("\n");
+	printf("-p converts the btree to the paged format before it is shared.\n"
+		"Default is 20000 records, 8 threads, and 4 passes, each of\n"
+		"%d lookups, %d lookups of missing records, a scan of %d\n"
+		"records and a scan of all records", LOOKUPS, LOOKUPS, RANGE);
+	printf("\n\n");
+	printf("Examples:");
+	printf("\n");
+	printf("\tbtthreads -p /tmp/threaddb 100000 16");
+	printf("\n\t\t");
+	printf("check 16 threads on a paged btree of 100000 records");
+	printf("\n\n");
+}
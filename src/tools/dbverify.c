@@ -67,6 +67,7 @@ STRING readpath = NULL;		/* normally defined in liflines/main.c */
 BOOLEAN readonly = FALSE;	/* normally defined in liflines/main.c */
 BOOLEAN writeable = FALSE;	/* normally defined in liflines/main.c */
 BOOLEAN immutable = FALSE;  /* normally defined in liflines/main.c */
+BOOLEAN snapshot = FALSE;  /* normally defined in liflines/main.c */
 int opt_finnish = 0;
 int opt_mychar = 0;
 
@@ -99,6 +100,9 @@ struct work {
 	INT fix_alter_pointers;
 	INT check_missing_data_records; /* record in index, but no data */
 	INT fix_missing_data_records;
+	INT rewrite_records; /* rewrite records in encoding of BinaryRecords */
+	INT compact_btree; /* rebuild btree full, dropping deleted records */
+	INT print_counters; /* show btree I/O done by the run */
 	INT pass; /* =1 is checking, =2 is fixing */
 };
 /*=======================================
@@ -137,6 +141,8 @@ static void check_set(INDISEQ seq, char ctype);
 static BOOLEAN check_sour(CNSTRING key, RECORD rec);
 static void check_typed_missing_data_records(char ntype);
 static BOOLEAN check_othe(CNSTRING key, RECORD rec);
+static void compact_btree(void);
+static BOOLEAN compact_callback(TRAV_RECORD_FUNC_BYKEY_ARGS(rkey, data, len, param));
 static BOOLEAN find_xref(CNSTRING key, NODE node, CNSTRING tag1, CNSTRING tag2);
 static void finish_and_delete_nameset(void);
 static void finish_and_delete_refnset(void);
@@ -146,12 +152,15 @@ static BOOLEAN fix_bad_pointer(CNSTRING key, RECORD rec, NODE node);
 static BOOLEAN nodes_callback(TRAV_RECORDS_FUNC_ARGS(key, rec, param));
 static void printblock(BLOCK block);
 static CNSTRING printkey(CNSTRING key);
+static void print_counters(void);
 static void print_usage(void);
 static void process_fam(RECORD rec);
 static void process_indi(RECORD rec);
 static void process_record(RECORD rec);
 static void report_error(INT err, STRING fmt, ...);
 static void report_fix(INT err, STRING fmt, ...);
+static BOOLEAN rewrite_callback(TRAV_RAWRECORDS_FUNC_ARGS(key, data, len, param));
+static void rewrite_records(void);
 static void report_progress(STRING fmt, ...);
 static void report_results(void);
 static void validate_errs(void);
@@ -251,6 +260,9 @@ print_usage (void)
 	printf(_("\t-m = Check for records missing data entries\n"));
 	printf(_("\t-M = Fix records missing data entries\n"));
 	printf(_("\t-D = Fix bad delete entries\n"));
+	printf(_("\t-R = Rewrite records as text (or binary, if BinaryRecords is set)\n"));
+	printf(_("\t-C = Compact database (drop deleted records, refill btree)\n"));
+	printf(_("\t-S = Show database I/O counters at end\n"));
 	printf(_("\t-n = Noisy (echo every record processed)\n"));
 	printf(_("example: dbverify -ifsex \"%s\"\n"), fname);
 	printf("%s\n", verstr);
@@ -1370,6 +1382,9 @@ main (int argc, char **argv)
 		case 'm': todo.check_missing_data_records=TRUE; break;
 		case 'M': todo.fix_missing_data_records=TRUE; break;
 		case 'D': todo.fix_deletes=TRUE; break;
+		case 'R': todo.rewrite_records=TRUE; break;
+		case 'C': todo.compact_btree=TRUE; break;
+		case 'S': todo.print_counters=TRUE; break;
 		case 'v': print_version("llexec"); goto done;
 		case 'h':
 		default: print_usage(); goto done;
@@ -1450,8 +1465,20 @@ main (int argc, char **argv)
 		check_missing_data_records();
 	}
 
+	if (todo.rewrite_records) {
+		rewrite_records();
+	}
+
+	if (todo.compact_btree) {
+		compact_btree();
+	}
+
 	report_results();
 
+	if (todo.print_counters) {
+		print_counters();
+	}
+
 	closebtree(BTR);
 
 	/* TODO: probably should call lldb_close, Perry 2005-10-07 */
@@ -1489,6 +1516,119 @@ report_results (void)
 		printf("%s\n", _("No errors found"));
 	}
 }
+/*===============================================
+ * compact_btree -- Rebuild btree with full blocks & indices
+ *  dropping records of deleted keys, & report savings
+ *=============================================*/
+static void
+compact_btree (void)
+{
+	BTSTATS before, after;
+	INT dropped;
+
+	if (!bwrite(BTR)) {
+		printf("%s\n", _("Cannot compact database without write access"));
+		return;
+	}
+	printf("%s\n", _("Compacting database"));
+	/* blocks are rewritten in the format llines would use */
+	bt_setcompress(BTR, getlloptint("BtreeCompress", 0) != 0);
+	bt_treestats(BTR, &before);
+	dropped = bt_compactbtree(BTR, compact_callback, NULL);
+	bt_treestats(BTR, &after);
+	printf(_("Before: %d levels, %d indices, %d blocks, %d records, %d bytes\n")
+		, before.s_levels, before.s_indexes, before.s_blocks
+		, before.s_records, before.s_bytes);
+	printf(_("After: %d levels, %d indices, %d blocks, %d records, %d bytes\n")
+		, after.s_levels, after.s_indexes, after.s_blocks
+		, after.s_records, after.s_bytes);
+	printf(_("Dropped %d deleted records, saved %d bytes & %d levels\n")
+		, dropped, before.s_bytes - after.s_bytes
+		, before.s_levels - after.s_levels);
+}
+/*===============================================
+ * compact_callback -- Keep record in compacted btree ?
+ *  only DELE records of keys in their delete set are dropped
+ *=============================================*/
+static BOOLEAN
+compact_callback (TRAV_RECORD_FUNC_BYKEY_ARGS(rkey, data, len, param))
+{
+	CNSTRING key;
+	param=param; /* unused */
+	if (len != 5 || strncmp(data, "DELE\n", 5))
+		return TRUE;
+	key = rkey2str(rkey);
+	if (!key[0] || !strchr("IFSEX", key[0]) || atoi(key+1) <= 0)
+		return TRUE;
+	return is_key_in_use(key);
+}
+/*===============================================
+ * rewrite_records -- Rewrite records not in encoding set by
+ *  BinaryRecords (text, unless set), eg, to use tools that
+ *  expect records as text (see nodebin.c)
+ *=============================================*/
+static void
+rewrite_records (void)
+{
+	LIST keys;
+	INT count = 0;
+	BOOLEAN binary = want_binary_records();
+
+	if (!bwrite(BTR)) {
+		printf("%s\n", _("Cannot rewrite records without write access"));
+		return;
+	}
+	/* records are found first, as rewriting may move them */
+	keys = create_list2(LISTDOFREE);
+	traverse_db_rec_keys(NULL, NULL, rewrite_callback, keys);
+	FORLIST(keys, el)
+		STRING key = (STRING) el;
+		INT len;
+		STRING rawrec = retrieve_raw_record(key, &len);
+		NODE node = rawrec ? string_to_node(rawrec, len) : NULL;
+		if (node) {
+			node_to_dbase(node, NULL);
+			free_nodes(node);
+			++count;
+		} else {
+			printf(_("Bad record %s not rewritten\n"), key);
+		}
+		if (rawrec)
+			stdfree(rawrec);
+	ENDLIST
+	destroy_list(keys);
+	if (binary)
+		printf(_("Rewrote %d records as binary\n"), count);
+	else
+		printf(_("Rewrote %d records as text\n"), count);
+}
+/*===============================================
+ * rewrite_callback -- Note record to rewrite ?
+ *  param: [IN]  list of keys
+ *=============================================*/
+static BOOLEAN
+rewrite_callback (TRAV_RAWRECORDS_FUNC_ARGS(key, data, len, param))
+{
+	LIST keys = (LIST) param;
+	if (!key[0] || !strchr("IFSEX", key[0]) || !strcmp(data, "DELE\n"))
+		return TRUE;
+	len=len; /* unused */
+	if (is_binary_record(data) != want_binary_records())
+		enqueue_list(keys, strsave(key));
+	return TRUE;
+}
+/*===============================================
+ * print_counters -- Show I/O done on btree by this run
+ *=============================================*/
+static void
+print_counters (void)
+{
+	BTCOUNTERS cnts;
+	char buffer[256];
+	bt_getcounters(BTR, &cnts);
+	bt_formatcounters(&cnts, buffer, sizeof(buffer));
+	printf(_("Database I/O: %s\n"), buffer);
+}
 /*=============================
  * fatal -- Fatal error routine
  * Created: 2001/01/01, Perry Rapp
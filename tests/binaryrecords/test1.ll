@@ -0,0 +1,22 @@
+/*
+ * test1.ll -- Print every record, as read back from the database,
+ *  in key order (as llines exports them; see test1.sh)
+ */
+proc main ()
+{
+	foreven (even, n) { call show(even) }
+	forfam (fam, n) { call show(fam) }
+	forindi (indi, n) { call show(indi) }
+	forsour (sour, n) { call show(sour) }
+	forothr (othr, n) { call show(othr) }
+}
+proc show (rec)
+{
+	traverse (root(rec), node, lev) {
+		d(lev) " "
+		if (xref(node)) { xref(node) " " }
+		tag(node)
+		if (value(node)) { " " value(node) }
+		"\n"
+	}
+}
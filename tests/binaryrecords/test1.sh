@@ -0,0 +1,41 @@
+#!/bin/sh
+#
+# Records written in binary encoding (BinaryRecords=1 in .linesrc)
+# read back as imported, and still do once dbverify -R has rewritten
+# them as text. part2.ged has tags that part1.ged does not, which the
+# second import adds to the tag list of the database (VTAGS).
+
+llines="$LLBIN/liflines/llines testdb"
+dbverify=$LLBIN/tools/dbverify
+
+# records of GEDCOM file (without header & trailer)
+records ()
+{
+  sed -n '/^0 @/,$p' $1 | grep -v '^0 TRLR'
+}
+
+# same as records imported ?
+compare ()
+{
+  if records $2 | diff orig.tmp -
+  then
+    echo "$1 matches original"
+  fi
+}
+
+records part1.ged > orig.tmp
+records part2.ged >> orig.tmp
+
+printf 'y\nyurpart1.ged\ny\nqqq\n' | $llines > /dev/null 2>&1
+printf 'urpart2.ged\ny\nrtest1.ll\nreport.tmp\nqqq\n' | $llines > /dev/null 2>&1
+compare report report.tmp
+printf 'usexport1.ged\nqqq\n' | $llines > /dev/null 2>&1
+compare export export1.ged
+
+# rewrite as text (second time finds none left to rewrite)
+LLCONFIGFILE=text.cfg $dbverify -R testdb
+LLCONFIGFILE=text.cfg $dbverify -R testdb
+printf 'usexport2.ged\nqqq\n' | LLCONFIGFILE=text.cfg $llines > /dev/null 2>&1
+compare "export of text records" export2.ged
+
+rm -f orig.tmp report.tmp export1.ged export2.ged
@@ -0,0 +1,73 @@
+#!/bin/sh
+#
+# btpack converts a database kept as a directory of index and block
+# files into one paged file, and the database exports just as it did
+# before, and still takes changes. Persons are imported in two parts,
+# so that the second splits blocks, and some are changed (see
+# edit.sh) and deleted before it is converted.
+
+llines="$LLBIN/liflines/llines testdb"
+btpack=$LLBIN/tools/btpack
+dbverify=$LLBIN/tools/dbverify
+LLEDITOR="sh `pwd`/edit.sh"
+export LLEDITOR
+
+# persons first..last
+persons ()
+{
+  printf '0 HEAD\n1 SOUR LIFELINES 3.1.2\n1 DEST ANY\n'
+  awk -v lo=$1 -v hi=$2 'BEGIN { for (i = lo; i <= hi; ++i)
+    printf "0 @I%d@ INDI\n1 NAME Person /Number%d/\n1 SEX M\n", i, i }'
+  printf '0 TRLR\n'
+}
+
+# records of GEDCOM file (without header & trailer)
+records ()
+{
+  sed -n '/^0 @/,$p' $1 | grep -v '^0 TRLR'
+}
+
+# btree index and block files
+blocks ()
+{
+  ls -d testdb/[a-z][a-z]/[a-z][a-z] 2> /dev/null | wc -l
+}
+
+persons 1 600 > part1.ged
+persons 601 1200 > part2.ged
+persons 1201 1500 > part3.ged
+printf 'y\nyurpart1.ged\ny\nqqq\n' | $llines > /dev/null 2>&1
+printf 'urpart2.ged\ny\nqqq\n' | $llines > /dev/null 2>&1
+printf 'bI6\neyqqq\n' | $llines > /dev/null 2>&1
+printf 'bI906\neyqqq\n' | $llines > /dev/null 2>&1
+printf 'diI700\niyqqq\n' | $llines > /dev/null 2>&1
+printf 'usbefore.ged\nqqq\n' | $llines > /dev/null 2>&1
+
+$btpack testdb
+if [ -f testdb/pages ] && [ `blocks` -eq 0 ]
+then
+  echo "index and block files replaced by paged file"
+fi
+$btpack testdb
+printf 'usafter.ged\nqqq\n' | $llines > /dev/null 2>&1
+records before.ged > before.tmp
+if records after.ged | diff before.tmp -
+then
+  echo "export after packing matches export before"
+fi
+echo "persons exported: `grep -c ' INDI$' after.ged`"
+grep 'NAME Person /Changed' after.ged
+$dbverify -a testdb
+
+# paged btree takes changes as before
+printf 'bI7\neyqqq\n' | $llines > /dev/null 2>&1
+printf 'urpart3.ged\ny\nqqq\n' | $llines > /dev/null 2>&1
+printf 'usafter.ged\nqqq\n' | $llines > /dev/null 2>&1
+grep 'NAME Person /Changed7/' after.ged
+echo "persons exported: `grep -c ' INDI$' after.ged`"
+if [ `blocks` -eq 0 ]
+then
+  echo "no index or block files made"
+fi
+
+rm -f part1.ged part2.ged part3.ged before.ged after.ged before.tmp
@@ -0,0 +1,5 @@
+#!/bin/sh
+#
+# Editor for test1.sh: changes name of person
+
+sed -i 's/Number\([0-9]*\)/Changed\1/' "$1"
@@ -1,7 +1,7 @@
 #!/bin/sh
 
-# find all test programs
-PROGS=`find . -type f -name \*.llscr`
+# find all test programs (llines keystrokes, or test scripts)
+PROGS=`find . -type f \( -name \*.llscr -o -name test\*.sh \)`
 
 # counters
 TOTALCNT=0
@@ -13,7 +13,7 @@ for i in $PROGS
 do
   TESTDIR=`dirname $i`
   TESTSCR=`basename $i`
-  TESTNAME=`echo $TESTSCR | sed -e 's/.llscr//g'`
+  TESTNAME=`echo $TESTSCR | sed -e 's/.llscr//g' -e 's/.sh$//'`
   ((TOTALCNT++))
   echo "Running test $i..."
   ./runtest.sh $TESTDIR $TESTSCR
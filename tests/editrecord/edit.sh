@@ -0,0 +1,12 @@
+#!/bin/sh
+#
+# Editor for test1.sh: keeps what llines gives it to edit (edit.tmp),
+# then changes lines at several levels of the record
+
+cp "$1" edit.tmp
+sed -i -e 's/^        5 CONT and Ann Smith$/        5 CONT and Anne Smith\
+        5 CONT in the front room/' \
+ -e 's/^      4 CONT the clerk$/      4 CONT the parish clerk/' \
+ -e 's/^1 OCCU Clerk$/1 OCCU Scrivener/' \
+ -e 's/^    3 PAGE 20$/    3 PAGE 21\
+    3 NOTE Margin/' "$1"
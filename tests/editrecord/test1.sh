@@ -0,0 +1,28 @@
+#!/bin/sh
+#
+# A person read into the record cache, where the lines below its
+# level 1 lines are only read in when first used (see expand_node),
+# is edited and saved. The editor must get the whole record, and the
+# export must have every line of it, as edited (see edit.sh).
+
+llines="$LLBIN/liflines/llines testdb"
+LLEDITOR="sh `pwd`/edit.sh"
+export LLEDITOR
+
+printf 'y\nyurtest1.ged\ny\nqqq\n' | $llines > /dev/null 2>&1
+# browse to person (which shows it), then edit it
+printf 'bI1\neyqqq\n' | $llines > /dev/null 2>&1
+
+sed -n '/^0 @I1@/,/^0 @S1@/p' test1.ged | sed '$d' > orig.tmp
+if sed 's/^ *//' edit.tmp | diff orig.tmp -
+then
+  echo "editor got whole record"
+fi
+
+printf 'usexport.ged\nqqq\n' | $llines > /dev/null 2>&1
+if sed -n '/^0 @/,$p' export.ged | grep -v '^0 TRLR' | diff edited.ged -
+then
+  echo "export matches edited records"
+fi
+
+rm -f orig.tmp edit.tmp export.ged
@@ -2,13 +2,18 @@
 #
 # Generic Test Runner
 #
-# Using $1, run test $2 in directory $3.
+# Run test $2 in directory $1.
+# A .llscr test is keystrokes for llines, whose report writes the log.
+# A .sh test is a script that runs the programs (under $LLBIN) itself,
+# and whose output is the log.
 
-testprog=`pwd`/../src/liflines/llines
+LLBIN=`pwd`/../src
+export LLBIN
+testprog=$LLBIN/liflines/llines
 testdir=$1
 testscr=$2
 origdir=`pwd`
-testname=`echo $testscr | sed -e 's/.llscr//g'`
+testname=`echo $testscr | sed -e 's/.llscr//g' -e 's/.sh$//'`
  
 # change to test directory
 cd $testdir
@@ -17,7 +22,10 @@ cd $testdir
 rm -rf testdb
 
 # run test
-$testprog testdb < $testscr
+case $testscr in
+*.sh) sh $testscr > $testname.log 2>&1 ;;
+*) $testprog testdb < $testscr ;;
+esac
 
 # remove test database
 rm -rf testdb
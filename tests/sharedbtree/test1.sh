@@ -0,0 +1,12 @@
+#!/bin/sh
+#
+# A btree opened read only and shared (bt_setshared) gives the
+# records as stored to threads looking them up and scanning them
+# at the same time, whether the btree is a directory of files or
+# paged (one file).
+
+btthreads=$LLBIN/tools/btthreads
+
+$btthreads testdb 20000 8 4
+rm -rf testdb
+$btthreads -p testdb 20000 8 4
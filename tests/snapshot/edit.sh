@@ -0,0 +1,5 @@
+#!/bin/sh
+#
+# Editor for writer.sh: changes name of person
+
+sed -i 's/Number6/Changed/' "$1"
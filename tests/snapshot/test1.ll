@@ -0,0 +1,18 @@
+/*
+ * Run by test1.sh with llexec -s: reads persons before and after
+ * writer.sh changes the database, which it must not see
+ */
+proc main ()
+{
+	"before: " name(indi("I1")) nl()
+	system("sh writer.sh")
+	"after: " name(indi("I6")) nl()
+	if (indi("I401")) {
+		"I401 seen" nl()
+	}
+	set(c, 0)
+	forindi (p, n) {
+		incr(c)
+	}
+	"persons: " d(c) nl()
+}
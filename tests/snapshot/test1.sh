@@ -0,0 +1,52 @@
+#!/bin/sh
+#
+# A report run with llexec -s (snapshot) sees the database as it was
+# when it started, while llines, run from the report (see writer.sh),
+# changes a person and imports more persons, splitting blocks. The
+# versions of files kept for the report are removed once it is done.
+
+llines="$LLBIN/liflines/llines testdb"
+llexec=$LLBIN/liflines/llexec
+
+# persons first..last
+persons ()
+{
+  printf '0 HEAD\n1 SOUR LIFELINES 3.1.2\n1 DEST ANY\n'
+  awk -v lo=$1 -v hi=$2 'BEGIN { for (i = lo; i <= hi; ++i)
+    printf "0 @I%d@ INDI\n1 NAME Person /Number%d/\n1 SEX M\n", i, i }'
+  printf '0 TRLR\n'
+}
+
+# btree index and block files
+blocks ()
+{
+  ls -d testdb/[a-z][a-z]/[a-z][a-z] | wc -l
+}
+
+persons 1 400 > part1.ged
+persons 401 800 > part2.ged
+printf 'y\nyurpart1.ged\ny\nqqq\n' | $llines > /dev/null 2>&1
+blocks > blocks.tmp
+
+echo report.tmp | $llexec -s -x test1.ll testdb > /dev/null 2>&1
+cat report.tmp
+if [ `blocks` -gt `cat blocks.tmp` ]
+then
+  echo "writer split blocks"
+fi
+if [ `cat kept.tmp` -gt 0 ]
+then
+  echo "versions kept while report ran"
+fi
+
+# writer removes versions no reader needs as it opens (and as each
+# of its operations ends)
+printf 'usexport.ged\nqqq\n' | $llines > /dev/null 2>&1
+if [ `ls testdb/snap/v | wc -l` -eq 0 ]
+then
+  echo "versions removed after report"
+fi
+echo "persons exported: `grep -c ' INDI$' export.ged`"
+grep 'NAME Person /Changed/' export.ged
+
+rm -f part1.ged part2.ged blocks.tmp kept.tmp report.tmp export.ged
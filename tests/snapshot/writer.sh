@@ -0,0 +1,13 @@
+#!/bin/sh
+#
+# Run by report of test1.sh while it has its snapshot open: llines
+# imports more persons, and changes one (see edit.sh), then the
+# versions of files kept for the report are counted
+
+llines="$LLBIN/liflines/llines testdb"
+LLEDITOR="sh `pwd`/edit.sh"
+export LLEDITOR
+
+printf 'urpart2.ged\ny\nqqq\n' | $llines > /dev/null 2>&1
+printf 'bI6\neyqqq\n' | $llines > /dev/null 2>&1
+ls testdb/snap/v | wc -l > kept.tmp
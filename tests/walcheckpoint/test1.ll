@@ -0,0 +1,19 @@
+/*
+@progname test1.ll
+@description Check records added by WAL checkpoint with smallest index cache
+*/
+proc main ()
+{
+	set(n, 0)
+	forindi(indi, i) {
+		set(last, key(indi))
+		incr(n)
+	}
+	"persons " d(n) " last " last "\n"
+	set(n, 0)
+	foreven(even, i) {
+		set(last, key(even))
+		incr(n)
+	}
+	"events " d(n) " last " last "\n"
+}